@@ -11,7 +11,8 @@ extern "C" {
 int trik_init_arm_server(uint16_t rproc_id);
 int trik_destroy_arm_server(void);
 
-int trik_start_arm_server(enum trik_cv_algorithm cv_algorithm, char* dev_name, char* config_filename);
+// cv_algorithms is a TRIK_CV_ALGORITHM_BIT mask, its sensors run at the rates the config file schedules
+int trik_start_arm_server(uint32_t cv_algorithms, char* dev_name, char* fb_name, char* config_filename);
 
 #ifdef __cplusplus
 }
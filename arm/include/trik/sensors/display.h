@@ -0,0 +1,25 @@
+#ifndef TRIK_SENSORS_DISPLAY_
+#define TRIK_SENSORS_DISPLAY_
+
+#include <stdint.h>
+
+#define TRIK_DISPLAY_ROTATE_DEVICE (-1) // rotation reported by the framebuffer device
+
+struct trik_display_config {
+  char* dev_name;    // fbdev, or a regular file standing in for one
+  uint32_t fps;      // screen updates per second, whatever the sensor rate is
+  int32_t rotate;    // quarter turns clockwise, FB_ROTATE_* or TRIK_DISPLAY_ROTATE_DEVICE
+  uint32_t width;    // geometry of a file stand-in, fbdevs report their own
+  uint32_t height;
+  uint32_t bpp;
+};
+
+void trik_default_display_config(struct trik_display_config* config);
+
+int trik_init_display(const struct trik_display_config* config);
+int trik_destroy_display(void);
+
+// RGB565 image of width x height pixels with a stride of stride pixels, centered on the screen after rotation
+int trik_display_present(const uint16_t* image, uint32_t width, uint32_t height, uint32_t stride);
+
+#endif
@@ -1,5 +1,6 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,7 +8,6 @@
 #include <time.h>
 #include <unistd.h>
 
-#include <linux/fb.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -25,11 +25,15 @@
 #include <trik/sensors/camera.h>
 #include <trik/sensors/cmd.h>
 #include <trik/sensors/cv_algorithm.h>
+#include <trik/sensors/display.h>
 #include <trik/sensors/log.h>
 #include <trik/sensors/msg.h>
 
 #define PAGE_SIZE 4096
 #define CAMERA_BUFFER_COUNT 2
+#define TRIK_CYCLES_REPORT_FRAMES 100
+#define TRIK_DISPLAY_SIZE IMG_HEIGHT // square middle of the frame is shown on the screen
+#define TRIK_DISPLAY_COL_OFFSET ((IMG_WIDTH - TRIK_DISPLAY_SIZE) / 2)
 
 static enum trik_cmd trik_cmd_from_cv_algorithm(enum trik_cv_algorithm cv_algorithm) {
   if (cv_algorithm == TRIK_CV_ALGORITHM_MOTION_SENSOR)
@@ -42,10 +46,19 @@ static enum trik_cmd trik_cmd_from_cv_algorithm(enum trik_cv_algorithm cv_algori
     return TRIK_CMD_OBJECT_SENSOR;
   else if (cv_algorithm == TRIK_CV_ALGORITHM_MXN_SENSOR)
     return TRIK_CMD_MXN_SENSOR;
+  else if (cv_algorithm == TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR)
+    return TRIK_CMD_MOTION_VECTOR_SENSOR;
+  else if (cv_algorithm == TRIK_CV_ALGORITHM_LANE_SENSOR)
+    return TRIK_CMD_LANE_SENSOR;
   else
     return TRIK_CMD_NOP;
 }
 
+// command line names, also the prefixes of the schedule keys of the config file
+static const char* const trik_cv_algorithm_names[TRIK_CV_ALGORITHM_COUNT] = {
+  "motion_sensor", "edge_line_sensor", "line_sensor", "object_sensor", "mxn_sensor", "motion_vector_sensor", "lane_sensor",
+};
+
 /* module structure */
 typedef struct {
   MessageQ_Handle hostQue;   // created locally
@@ -169,12 +182,12 @@ static int trik_drain_pipeline() {
   return 0;
 }
 
-static int8_t* trik_get_ptr_for_phys_addr(void* addr) {
+static int8_t* trik_get_ptr_for_phys_addr(void* addr, size_t size) {
   uint32_t page_base = ((uint32_t) addr) / PAGE_SIZE * PAGE_SIZE;
   uint32_t page_offset = ((uint32_t) addr) - page_base;
 
   int memfd = open("/dev/mem", O_RDWR | O_SYNC);
-  int8_t* mapped_start = mmap(0, page_offset + BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, page_base);
+  int8_t* mapped_start = mmap(0, page_offset + size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, page_base);
 
   if (mapped_start == MAP_FAILED)
     return NULL;
@@ -182,7 +195,8 @@ static int8_t* trik_get_ptr_for_phys_addr(void* addr) {
   return (int8_t*) (((uint32_t) mapped_start) + page_offset);
 }
 
-static int trik_req_init(struct buffer* dsp_in_buf, struct buffer* dsp_out_buf) {
+static int trik_req_init(struct buffer* dsp_in_buf, struct buffer* dsp_out_buf, struct trik_cv_algorithm_draw_list** draw_list,
+  struct trik_cv_algorithm_results** results) {
   if (trik_send_cmd(TRIK_CMD_INIT) < 0)
     return -1;
 
@@ -191,31 +205,49 @@ static int trik_req_init(struct buffer* dsp_in_buf, struct buffer* dsp_out_buf)
     return -1;
 
   int retval = 0;
-  if ((dsp_in_buf->start = trik_get_ptr_for_phys_addr(res->dsp_in_buffer)) == NULL) {
+  if ((dsp_in_buf->start = trik_get_ptr_for_phys_addr(res->dsp_in_buffer, BUFFER_SIZE)) == NULL) {
     retval = -1;
     goto cleanup;
   }
   dsp_in_buf->length = BUFFER_SIZE;
 
-  if ((dsp_out_buf->start = trik_get_ptr_for_phys_addr(res->dsp_out_buffer)) == NULL) {
+  if ((dsp_out_buf->start = trik_get_ptr_for_phys_addr(res->dsp_out_buffer, BUFFER_SIZE)) == NULL) {
     retval = -1;
     goto cleanup;
   }
   dsp_out_buf->length = BUFFER_SIZE;
 
+  if ((*draw_list = (struct trik_cv_algorithm_draw_list*) trik_get_ptr_for_phys_addr(res->dsp_draw_list, sizeof(**draw_list))) == NULL) {
+    retval = -1;
+    goto cleanup;
+  }
+
+  if ((*results = (struct trik_cv_algorithm_results*) trik_get_ptr_for_phys_addr(res->dsp_results, sizeof(**results))) == NULL) {
+    retval = -1;
+    goto cleanup;
+  }
+
 cleanup:
   trik_destroy_msg(res);
   return retval;
 }
 
-static int trik_req_cv_algorithm(enum trik_cv_algorithm cv_algorithm, struct trik_cv_algorithm_in_args in_args) {
-  enum trik_cmd cmd = trik_cmd_from_cv_algorithm(cv_algorithm);
-  if (cmd == TRIK_CMD_NOP)
+// a single sensor is requested with its own command, several of them with TRIK_CMD_SENSOR_SET
+static int trik_req_cv_algorithm(uint32_t cv_algorithms, struct trik_cv_algorithm_in_args in_args, const struct trik_cv_algorithm_schedule* schedule) {
+  if (cv_algorithms == 0 || (cv_algorithms & ~TRIK_CV_ALGORITHM_ALL) != 0)
     return -1;
+  enum trik_cmd cmd = TRIK_CMD_SENSOR_SET;
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; i++)
+    if (cv_algorithms == TRIK_CV_ALGORITHM_BIT(i))
+      cmd = trik_cmd_from_cv_algorithm((enum trik_cv_algorithm) i);
 
   struct trik_req_cv_algorithm_msg* req = (struct trik_req_cv_algorithm_msg*) trik_create_msg(cmd);
+  if (req == NULL)
+    return -1;
 
   req->in_args = in_args;
+  req->cv_algorithms = cv_algorithms;
+  req->schedule = *schedule;
 
   if (trik_send_msg((struct trik_msg*) req) < 0)
     return -1;
@@ -239,11 +271,32 @@ static int trik_req_step(struct trik_cv_algorithm_out_args* out_args) {
   return 0;
 }
 
-static int trik_read_cv_algorithm_in_args_from_file(char* filename, struct trik_cv_algorithm_in_args* in_args) {
+// <algorithm>_period frames and <algorithm>_budget ticks, such as mxn_sensor_period
+static void trik_read_schedule_param(const char* param, int32_t value, struct trik_cv_algorithm_schedule* schedule) {
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; i++) {
+    const size_t length = strlen(trik_cv_algorithm_names[i]);
+    if (strncmp(param, trik_cv_algorithm_names[i], length) != 0 || param[length] != '_')
+      continue;
+    if (strcmp(param + length + 1, "period") == 0)
+      schedule->period[i] = value;
+    else if (strcmp(param + length + 1, "budget") == 0)
+      schedule->budget[i] = value;
+    return;
+  }
+}
+
+static int trik_read_cv_algorithm_in_args_from_file(char* filename, struct trik_cv_algorithm_in_args* in_args, struct trik_display_config* display_config,
+  struct trik_cv_algorithm_schedule* schedule) {
   FILE* f = fopen(filename, "r");
+  if (f == NULL)
+    return -1;
 
   char param[32];
   int32_t value;
+  uint32_t roi;
+  char roi_field[8];
+  uint32_t floor_point;
+  char floor_field[8];
 
   while (fscanf(f, "%s = %d", param, &value) > 0)
     if (strcmp(param, "detect_hue_from") == 0)
@@ -264,41 +317,354 @@ static int trik_read_cv_algorithm_in_args_from_file(char* filename, struct trik_
       in_args->width_n = value;
     else if (strcmp(param, "height_n") == 0)
       in_args->height_n = value;
+    else if (strcmp(param, "activity_cols") == 0)
+      in_args->activity_cols = value;
+    else if (strcmp(param, "activity_rows") == 0)
+      in_args->activity_rows = value;
+    else if (strcmp(param, "activity_threshold") == 0)
+      in_args->activity_threshold = value;
+    else if (strcmp(param, "static_threshold") == 0)
+      in_args->static_threshold = value;
+    else if (strcmp(param, "preview") == 0)
+      in_args->preview = value;
+    else if (strcmp(param, "preview_scale") == 0)
+      in_args->preview_scale = value;
+    else if (strcmp(param, "detect_corners") == 0)
+      in_args->detect_corners = value;
+    else if (strcmp(param, "track_target") == 0)
+      in_args->track_target = value;
+    else if (strcmp(param, "track_max_misses") == 0)
+      in_args->track_max_misses = value;
+    else if (strcmp(param, "bin_2x2") == 0)
+      in_args->bin_2x2 = value;
+    else if (strcmp(param, "sample_stride") == 0)
+      in_args->sample_stride = value;
+    else if (strcmp(param, "sample_checkerboard") == 0)
+      in_args->sample_checkerboard = value;
+    else if (strcmp(param, "line_bands") == 0)
+      in_args->line_bands = value;
+    else if (strcmp(param, "lens_focal") == 0)
+      in_args->lens.focal = value;
+    else if (strcmp(param, "lens_k1") == 0)
+      in_args->lens.k1 = value;
+    else if (strcmp(param, "lens_k2") == 0)
+      in_args->lens.k2 = value;
+    else if (strcmp(param, "roi_count") == 0)
+      in_args->roi_count = value;
+    else if (strcmp(param, "display_fps") == 0)
+      display_config->fps = value;
+    else if (strcmp(param, "display_rotate") == 0) // quarter turns clockwise, -1 for the rotation of the device
+      display_config->rotate = value;
+    else if (strcmp(param, "display_width") == 0) // display_width, display_height, display_bpp describe a file standing in for the device
+      display_config->width = value;
+    else if (strcmp(param, "display_height") == 0)
+      display_config->height = value;
+    else if (strcmp(param, "display_bpp") == 0)
+      display_config->bpp = value;
+    else if (strcmp(param, "frame_budget") == 0) // DSP timestamp ticks of sensor runs per frame, as in the cycles report
+      schedule->frame_budget = value;
+    else if (strcmp(param, "auto_detect_hsv_period") == 0)
+      schedule->auto_detect_hsv_period = value;
+    else if (sscanf(param, "roi%u_%7s", &roi, roi_field) == 2 && roi < TRIK_MAX_ROIS) { // roi<i>_x, roi<i>_y, roi<i>_width, roi<i>_height
+      if (strcmp(roi_field, "x") == 0)
+        in_args->rois[roi].x = value;
+      else if (strcmp(roi_field, "y") == 0)
+        in_args->rois[roi].y = value;
+      else if (strcmp(roi_field, "width") == 0)
+        in_args->rois[roi].width = value;
+      else if (strcmp(roi_field, "height") == 0)
+        in_args->rois[roi].height = value;
+    } else if (sscanf(param, "floor%u_%7s", &floor_point, floor_field) == 2 && floor_point < 4) { // floor<i>_u, floor<i>_v pixels, floor<i>_x, floor<i>_y mm
+      if (strcmp(floor_field, "u") == 0)
+        in_args->floor.image[floor_point].x = value;
+      else if (strcmp(floor_field, "v") == 0)
+        in_args->floor.image[floor_point].y = value;
+      else if (strcmp(floor_field, "x") == 0)
+        in_args->floor.floor[floor_point].x = value;
+      else if (strcmp(floor_field, "y") == 0)
+        in_args->floor.floor[floor_point].y = value;
+    } else
+      trik_read_schedule_param(param, value, schedule);
 
   fclose(f);
   return 0;
 }
 
-static int trik_setup_display(int8_t** fbp) {
-  int fbfd = 0;
-  struct fb_var_screeninfo vinfo;
-  struct fb_fix_screeninfo finfo;
-  long int screensize = 0;
+// one line per activity map change: "activity <cols>x<rows> <row masks> <cell magnitudes>"
+static void trik_publish_activity(const struct trik_cv_algorithm_out_activity* activity) {
+  printf("activity %ux%u", activity->cols, activity->rows);
+  for (uint32_t row = 0; row < activity->rows; row++)
+    printf(" %02x", activity->mask[row]);
+  for (uint32_t row = 0; row < activity->rows; row++)
+    for (uint32_t col = 0; col < activity->cols; col++)
+      printf(" %u", activity->magnitude[row][col]);
+  printf("\n");
+  fflush(stdout);
+}
 
-  *fbp = NULL;
+/*
+ * Mean DSP timestamp ticks per stage over the last TRIK_CYCLES_REPORT_FRAMES processed frames, summed over the sensors
+ * run on each of them, and the scheduling counters of every sensor of the set.
+ */
+static void trik_report_cycles(uint32_t cv_algorithms, const struct trik_cv_algorithm_results* results, uint8_t preview,
+  struct trik_cv_algorithm_out_cycles* sum, uint32_t* frames) {
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; i++) {
+    if (!(results->cv_algorithms & TRIK_CV_ALGORITHM_BIT(i)))
+      continue;
+    const struct trik_cv_algorithm_out_cycles* frame = &results->out_args[i].cycles;
+    sum->bin += frame->bin;
+    sum->sensor += frame->sensor;
+    sum->upscale += frame->upscale;
+    sum->preview += frame->preview;
+  }
+  if (++*frames < TRIK_CYCLES_REPORT_FRAMES)
+    return;
+  debugf("preview %u cycles: bin %u sensor %u (background %u) upscale %u", preview, sum->bin / *frames, sum->sensor / *frames, sum->preview / *frames,
+    sum->upscale / *frames);
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; i++) {
+    const struct trik_cv_algorithm_out_schedule* schedule = &results->schedule[i];
+    if (cv_algorithms & TRIK_CV_ALGORITHM_BIT(i))
+      debugf("%s: runs %u deferred %u misses %u overruns %u", trik_cv_algorithm_names[i], schedule->runs, schedule->deferred, schedule->misses,
+        schedule->overruns);
+  }
+  memset(sum, 0, sizeof(*sum));
+  *frames = 0;
+}
 
-  fbfd = open("/dev/fb0", O_RDWR);
-  if (fbfd == -1) {
-    errorf("cannot open framebuffer device");
-    return -1;
+/*
+ * Screen updates. The display thread asks for a frame once per display period and the server loop hands the next
+ * processed one over: the DSP preview, or the camera frame with the DSP draw list, which the thread converts and
+ * draws itself. Frames in between are never copied, and the framebuffer is written off the server loop.
+ */
+struct trik_display {
+  pthread_mutex_t lock;
+  pthread_cond_t posted;
+  bool wanted; // the thread waits for a frame, the server loop copies the next one
+  bool fresh;  // frame and draw list were posted and not taken yet
+  bool draw_list;
+  uint32_t preview_scale; // the DSP preview is 1/n of the frame, its square is blown up to the screen size
+  uint32_t period_us;
+  int8_t frame[BUFFER_SIZE]; // camera frame for draw lists, the shown square of the DSP preview otherwise
+  uint16_t draw_count;
+  struct trik_cv_algorithm_draw_cmd draw_cmds[TRIK_MAX_DRAW_COMMANDS];
+};
+
+static struct trik_display display = { .lock = PTHREAD_MUTEX_INITIALIZER, .posted = PTHREAD_COND_INITIALIZER };
+static uint16_t display_canvas[TRIK_DISPLAY_SIZE * TRIK_DISPLAY_SIZE];
+
+static uint8_t trik_clamp_u8(int32_t value) {
+  return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+// same fixed point BT.601 coefficients as the DSP conversion
+static uint16_t trik_yuv_to_rgb565(int32_t y, int32_t u, int32_t v) {
+  const int32_t luma = 298 * (y - 16) + 128;
+  const uint8_t r = trik_clamp_u8((luma + 409 * (v - 128)) >> 8);
+  const uint8_t g = trik_clamp_u8((luma - 100 * (u - 128) - 208 * (v - 128)) >> 8);
+  const uint8_t b = trik_clamp_u8((luma + 516 * (u - 128)) >> 8);
+  return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+}
+
+// one color per 2x2 block, taken from the top pixel pair of the block
+static void trik_display_draw_frame(const uint8_t* frame) {
+  for (uint32_t row = 0; row < TRIK_DISPLAY_SIZE; row += 2) {
+    const uint8_t* src = frame + (row * IMG_WIDTH + TRIK_DISPLAY_COL_OFFSET) * 2;
+    uint16_t* dst = display_canvas + row * TRIK_DISPLAY_SIZE;
+    for (uint32_t col = 0; col < TRIK_DISPLAY_SIZE; col += 2, src += 4) {
+      const uint16_t rgb565 = trik_yuv_to_rgb565((src[0] + src[2]) / 2, src[1], src[3]);
+      dst[col] = rgb565;
+      dst[col + 1] = rgb565;
+      dst[col + TRIK_DISPLAY_SIZE] = rgb565;
+      dst[col + TRIK_DISPLAY_SIZE + 1] = rgb565;
+    }
   }
+}
 
-  if (ioctl(fbfd, FBIOGET_FSCREENINFO, &finfo) == -1) {
-    errorf("failed to read fixed information");
-    return -1;
+// every pixel of a reduced preview square becomes a scale x scale block
+static void trik_display_upscale_preview(const uint16_t* square, uint32_t scale) {
+  const uint32_t size = TRIK_DISPLAY_SIZE / scale;
+  for (uint32_t row = 0; row < TRIK_DISPLAY_SIZE; row++) {
+    const uint16_t* src = square + (row / scale) * size;
+    uint16_t* dst = display_canvas + row * TRIK_DISPLAY_SIZE;
+    for (uint32_t col = 0; col < TRIK_DISPLAY_SIZE; col++)
+      dst[col] = src[col / scale];
   }
+}
 
-  if (ioctl(fbfd, FBIOGET_VSCREENINFO, &vinfo) == -1) {
-    errorf("failed to read variable information");
-    return -1;
+// frame pixels [x0, x1) x [y0, y1), clipped to the part of the frame on the screen
+static void trik_display_fill(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t rgb565) {
+  x0 = x0 < TRIK_DISPLAY_COL_OFFSET ? 0 : x0 - TRIK_DISPLAY_COL_OFFSET;
+  x1 = x1 > TRIK_DISPLAY_COL_OFFSET + TRIK_DISPLAY_SIZE ? TRIK_DISPLAY_SIZE : x1 - TRIK_DISPLAY_COL_OFFSET;
+  y0 = y0 < 0 ? 0 : y0;
+  y1 = y1 > TRIK_DISPLAY_SIZE ? TRIK_DISPLAY_SIZE : y1;
+  for (int32_t row = y0; row < y1; row++)
+    for (int32_t col = x0; col < x1; col++)
+      display_canvas[row * TRIK_DISPLAY_SIZE + col] = rgb565;
+}
+
+static void trik_display_plot(int32_t x, int32_t y, uint16_t rgb565) {
+  x -= TRIK_DISPLAY_COL_OFFSET;
+  if (x >= 0 && x < TRIK_DISPLAY_SIZE && y >= 0 && y < TRIK_DISPLAY_SIZE)
+    display_canvas[y * TRIK_DISPLAY_SIZE + x] = rgb565;
+}
+
+static void trik_display_draw_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t rgb565) {
+  const int32_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+  const int32_t dy = y1 > y0 ? y0 - y1 : y1 - y0;
+  const int32_t sx = x0 < x1 ? 1 : -1;
+  const int32_t sy = y0 < y1 ? 1 : -1;
+  int32_t error = dx + dy;
+  while (true) {
+    trik_display_plot(x0, y0, rgb565);
+    if (x0 == x1 && y0 == y1)
+      break;
+    const int32_t error2 = 2 * error;
+    if (error2 >= dy) {
+      error += dy;
+      x0 += sx;
+    }
+    if (error2 <= dx) {
+      error += dx;
+      y0 += sy;
+    }
   }
+}
 
-  screensize = vinfo.xres * vinfo.yres * vinfo.bits_per_pixel / 8;
+static void trik_display_draw_circle(int32_t x0, int32_t y0, int32_t radius, uint16_t rgb565) {
+  int32_t x = radius;
+  int32_t y = 0;
+  int32_t error = 1 - radius;
+  while (y <= x) {
+    trik_display_plot(x0 + x, y0 + y, rgb565);
+    trik_display_plot(x0 - x, y0 + y, rgb565);
+    trik_display_plot(x0 + x, y0 - y, rgb565);
+    trik_display_plot(x0 - x, y0 - y, rgb565);
+    trik_display_plot(x0 + y, y0 + x, rgb565);
+    trik_display_plot(x0 - y, y0 + x, rgb565);
+    trik_display_plot(x0 + y, y0 - x, rgb565);
+    trik_display_plot(x0 - y, y0 - x, rgb565);
+    y++;
+    if (error < 0)
+      error += 2 * y + 1;
+    else {
+      x--;
+      error += 2 * (y - x) + 1;
+    }
+  }
+}
+
+static void trik_display_draw_cmd(const struct trik_cv_algorithm_draw_cmd* cmd) {
+  const int32_t half = cmd->width / 2;
+  switch (cmd->op) {
+  case TRIK_DRAW_CROSSHAIR:
+    trik_display_fill(cmd->x0 - cmd->x1, cmd->y0, cmd->x0 + cmd->x1 + 1, cmd->y0 + 1, cmd->rgb565);
+    trik_display_fill(cmd->x0, cmd->y0 - cmd->y1, cmd->x0 + 1, cmd->y0 + cmd->y1 + 1, cmd->rgb565);
+    break;
+  case TRIK_DRAW_CIRCLE:
+    trik_display_draw_circle(cmd->x0, cmd->y0, cmd->x1, cmd->rgb565);
+    break;
+  case TRIK_DRAW_RECTANGLE:
+    trik_display_fill(cmd->x0 - half, cmd->y0 - half, cmd->x1 - half + cmd->width, cmd->y0 - half + cmd->width, cmd->rgb565);
+    trik_display_fill(cmd->x0 - half, cmd->y1 - half, cmd->x1 - half + cmd->width, cmd->y1 - half + cmd->width, cmd->rgb565);
+    trik_display_fill(cmd->x0 - half, cmd->y0 - half, cmd->x0 - half + cmd->width, cmd->y1 - half + cmd->width, cmd->rgb565);
+    trik_display_fill(cmd->x1 - half, cmd->y0 - half, cmd->x1 - half + cmd->width, cmd->y1 - half + cmd->width, cmd->rgb565);
+    break;
+  case TRIK_DRAW_LINE:
+    trik_display_draw_line(cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->rgb565);
+    break;
+  case TRIK_DRAW_FILL:
+    trik_display_fill(cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->rgb565);
+    break;
+  }
+}
 
-  *fbp = (int8_t*) mmap(0, screensize, PROT_READ | PROT_WRITE, MAP_SHARED, fbfd, 0);
+static void trik_add_us(struct timespec* time, uint32_t us) {
+  time->tv_nsec += (long) us * 1000;
+  time->tv_sec += time->tv_nsec / 1000000000;
+  time->tv_nsec %= 1000000000;
+}
+
+static void* trik_display_thread(void* arg) {
+  static struct trik_cv_algorithm_draw_cmd draw_cmds[TRIK_MAX_DRAW_COMMANDS];
+  struct timespec deadline;
+  (void) arg;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  while (true) {
+    // a period missed while waiting for the camera is not caught up on
+    struct timespec now;
+    trik_add_us(&deadline, display.period_us);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec > deadline.tv_nsec))
+      deadline = now;
+    else
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+    // the server loop leaves the frame alone until it is wanted again, so it is read without the lock
+    pthread_mutex_lock(&display.lock);
+    display.wanted = true;
+    while (!display.fresh)
+      pthread_cond_wait(&display.posted, &display.lock);
+    display.fresh = false;
+    display.wanted = false;
+    const uint16_t draw_count = display.draw_count;
+    memcpy(draw_cmds, display.draw_cmds, draw_count * sizeof(draw_cmds[0]));
+    pthread_mutex_unlock(&display.lock);
+
+    if (!display.draw_list && display.preview_scale == 1) {
+      trik_display_present((const uint16_t*) display.frame, TRIK_DISPLAY_SIZE, TRIK_DISPLAY_SIZE, TRIK_DISPLAY_SIZE);
+      continue;
+    }
+    if (!display.draw_list) {
+      trik_display_upscale_preview((const uint16_t*) display.frame, display.preview_scale);
+      trik_display_present(display_canvas, TRIK_DISPLAY_SIZE, TRIK_DISPLAY_SIZE, TRIK_DISPLAY_SIZE);
+      continue;
+    }
+    trik_display_draw_frame((const uint8_t*) display.frame);
+    for (uint32_t i = 0; i < draw_count; i++)
+      trik_display_draw_cmd(&draw_cmds[i]);
+    trik_display_present(display_canvas, TRIK_DISPLAY_SIZE, TRIK_DISPLAY_SIZE, TRIK_DISPLAY_SIZE);
+  }
+  return NULL;
+}
+
+static int trik_start_display_thread(bool draw_list, uint32_t preview_scale, uint32_t fps) {
+  pthread_t thread;
+  display.draw_list = draw_list;
+  display.preview_scale = preview_scale;
+  display.period_us = 1000000 / (fps > 0 ? fps : 1);
+  if (pthread_create(&thread, NULL, trik_display_thread, NULL) != 0)
+    return -1;
+  pthread_detach(thread);
   return 0;
 }
 
+// called after every step, the DSP may write its buffers again on the next one
+static void trik_display_post_frame(const struct buffer* image_buf, const struct buffer* dsp_out_buf, const struct trik_cv_algorithm_draw_list* draw_list) {
+  pthread_mutex_lock(&display.lock);
+  if (!display.wanted || display.fresh) {
+    pthread_mutex_unlock(&display.lock);
+    return;
+  }
+  if (display.draw_list) {
+    memcpy(display.frame, image_buf->start, BUFFER_SIZE);
+    display.draw_count = draw_list->count < TRIK_MAX_DRAW_COMMANDS ? draw_list->count : TRIK_MAX_DRAW_COMMANDS;
+    memcpy(display.draw_cmds, draw_list->cmds, display.draw_count * sizeof(display.draw_cmds[0]));
+  } else {
+    // a reduced preview has IMG_WIDTH / scale pixels per row, the shown square shrinks with it
+    const uint32_t scale = display.preview_scale;
+    const uint32_t size = TRIK_DISPLAY_SIZE / scale;
+    const uint16_t* preview = (const uint16_t*) dsp_out_buf->start + TRIK_DISPLAY_COL_OFFSET / scale;
+    uint16_t* square = (uint16_t*) display.frame;
+    for (uint32_t row = 0; row < size; row++)
+      memcpy(square + row * size, preview + row * (IMG_WIDTH / scale), size * sizeof(uint16_t));
+    display.draw_count = 0;
+  }
+  display.fresh = true;
+  pthread_cond_signal(&display.posted);
+  pthread_mutex_unlock(&display.lock);
+}
+
 int trik_init_arm_server(uint16_t rproc_id) {
   if (trik_init_rpmsg(rproc_id) < 0) {
     errorf("failed to initialize rpmsg");
@@ -316,11 +682,14 @@ int trik_destroy_arm_server(void) {
   if (trik_destroy_camera() < 0)
     warnf("failed disabling the camera");
 
+  if (trik_destroy_display() < 0)
+    warnf("failed releasing the display");
+
   debugf("destroyed arm server");
   return 0;
 }
 
-int trik_start_arm_server(enum trik_cv_algorithm cv_algorithm, char* dev_name, char* config_filename) {
+int trik_start_arm_server(uint32_t cv_algorithms, char* dev_name, char* fb_name, char* config_filename) {
   debugf("starting arm server");
 
   // I don't know, why it is obsolete, but found it in examples...
@@ -332,14 +701,22 @@ int trik_start_arm_server(enum trik_cv_algorithm cv_algorithm, char* dev_name, c
 
   struct buffer dsp_in_buf;
   struct buffer dsp_out_buf;
+  struct trik_cv_algorithm_draw_list* draw_list;
+  struct trik_cv_algorithm_results* results;
   struct trik_cv_algorithm_in_args in_args;
-
-  if (trik_read_cv_algorithm_in_args_from_file(config_filename, &in_args) < 0)
+  struct trik_cv_algorithm_schedule schedule;
+  struct trik_display_config display_config;
+  memset(&in_args, 0, sizeof(in_args));
+  memset(&schedule, 0, sizeof(schedule));
+  trik_default_display_config(&display_config);
+  display_config.dev_name = fb_name;
+
+  if (trik_read_cv_algorithm_in_args_from_file(config_filename, &in_args, &display_config, &schedule) < 0)
     warnf("failed to read config from '%s', using fallback", config_filename);
   else
     debugf("sucessfully loaded config file '%s'", config_filename);
 
-  if (trik_req_init(&dsp_in_buf, &dsp_out_buf) < 0) {
+  if (trik_req_init(&dsp_in_buf, &dsp_out_buf, &draw_list, &results) < 0) {
     errorf("failed to recieve image buffer");
     return -1;
   }
@@ -351,18 +728,36 @@ int trik_start_arm_server(enum trik_cv_algorithm cv_algorithm, char* dev_name, c
   }
   debugf("successully init camera");
 
-  if (trik_req_cv_algorithm(cv_algorithm, in_args) < 0) {
-    errorf("failed to request a cv algorithm");
-    return -1;
+  // the DSP preview is the whole frame, a half or a quarter of it in both directions
+  if (in_args.preview_scale != 2 && in_args.preview_scale != 4) {
+    if (in_args.preview_scale > 1)
+      warnf("unsupported preview scale %u, using full size", in_args.preview_scale);
+    in_args.preview_scale = 1;
   }
-  debugf("successully got cv algorithm");
 
-  int8_t* fbp;
-  if (trik_setup_display(&fbp) < 0)
-    warnf("failed to initialize display");
-  else
+  // without a screen nobody sees the preview, so the DSP does not render it
+  if (in_args.preview != TRIK_PREVIEW_NONE && trik_init_display(&display_config) < 0) {
+    warnf("failed to initialize display, preview is off");
+    in_args.preview = TRIK_PREVIEW_NONE;
+  } else if (in_args.preview != TRIK_PREVIEW_NONE)
     debugf("successully set up the display");
 
+  if (in_args.preview != TRIK_PREVIEW_NONE &&
+    trik_start_display_thread(in_args.preview == TRIK_PREVIEW_DRAW_LIST, in_args.preview_scale, display_config.fps) < 0) {
+    warnf("failed to start the display thread, preview is off");
+    in_args.preview = TRIK_PREVIEW_NONE;
+  }
+
+  if (trik_req_cv_algorithm(cv_algorithms, in_args, &schedule) < 0) {
+    errorf("failed to request cv algorithms %x", cv_algorithms);
+    return -1;
+  }
+  debugf("successully got cv algorithms %x", cv_algorithms);
+
+  struct trik_cv_algorithm_out_cycles cycles;
+  uint32_t cycles_frames = 0;
+  memset(&cycles, 0, sizeof(cycles));
+
   while (true) {
     struct buffer image_buf;
     if (trik_camera_wait_for_frame(&image_buf) < 0) {
@@ -376,9 +771,14 @@ int trik_start_arm_server(enum trik_cv_algorithm cv_algorithm, char* dev_name, c
       errorf("unable to proccess a frame on a DSP");
       return -1;
     }
-    if (fbp != NULL)
-      for (uint32_t i = 0; i < IMG_HEIGHT; i++)
-        memcpy(fbp + i * IMG_HEIGHT * 2, dsp_out_buf.start + i * IMG_WIDTH * 2 + (IMG_WIDTH - IMG_HEIGHT), sizeof(int8_t) * IMG_HEIGHT * 2);
+    // the reply has the results of the first sensor only, every sensor of the set is in the shared results
+    const struct trik_cv_algorithm_out_args* motion = &results->out_args[TRIK_CV_ALGORITHM_MOTION_SENSOR];
+    if ((results->cv_algorithms & TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_MOTION_SENSOR)) && motion->ext.activity.changed)
+      trik_publish_activity(&motion->ext.activity);
+    if (results->cv_algorithms != 0)
+      trik_report_cycles(cv_algorithms, results, in_args.preview, &cycles, &cycles_frames);
+    if (in_args.preview != TRIK_PREVIEW_NONE)
+      trik_display_post_frame(&image_buf, &dsp_out_buf, draw_list);
     trik_release_frame();
   }
 
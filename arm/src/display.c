@@ -0,0 +1,241 @@
+#include <trik/sensors/display.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/fb.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <trik/sensors/log.h>
+
+#define TRIK_DISPLAY_DEFAULT_FPS 25
+#define TRIK_DISPLAY_FILE_WIDTH 240 // TRIK screen, used for file stand-ins
+#define TRIK_DISPLAY_FILE_HEIGHT 320
+#define TRIK_DISPLAY_FILE_BPP 16
+
+/*
+ * Framebuffer output. The screen is drawn into the page which is not shown and then panned to with FBIOPAN_DISPLAY,
+ * so a half drawn screen is never visible. Devices which cannot hold two pages, and regular files standing in for
+ * a device, are drawn in place.
+ */
+static int fd = -1;
+static uint8_t* fb_mem = NULL;
+static size_t fb_size;
+static struct fb_var_screeninfo vinfo;
+static uint32_t line_length;
+static uint32_t bytes_per_pixel;
+static uint32_t pages;
+static uint32_t back_page;
+static uint32_t rotate;
+static bool native_rgb565;
+
+void trik_default_display_config(struct trik_display_config* config) {
+  config->dev_name = "/dev/fb0";
+  config->fps = TRIK_DISPLAY_DEFAULT_FPS;
+  config->rotate = TRIK_DISPLAY_ROTATE_DEVICE;
+  config->width = TRIK_DISPLAY_FILE_WIDTH;
+  config->height = TRIK_DISPLAY_FILE_HEIGHT;
+  config->bpp = TRIK_DISPLAY_FILE_BPP;
+}
+
+static void trik_set_bitfield(struct fb_bitfield* field, uint32_t offset, uint32_t length) {
+  field->offset = offset;
+  field->length = length;
+  field->msb_right = 0;
+}
+
+// a file gets the configured geometry with RGB565 or XRGB8888 pixels, it is sized to one page
+static int trik_setup_file(const struct trik_display_config* config) {
+  memset(&vinfo, 0, sizeof(vinfo));
+  vinfo.xres = vinfo.xres_virtual = config->width;
+  vinfo.yres = vinfo.yres_virtual = config->height;
+  vinfo.bits_per_pixel = config->bpp;
+  if (config->bpp == 16) {
+    trik_set_bitfield(&vinfo.red, 11, 5);
+    trik_set_bitfield(&vinfo.green, 5, 6);
+    trik_set_bitfield(&vinfo.blue, 0, 5);
+  } else {
+    trik_set_bitfield(&vinfo.red, 16, 8);
+    trik_set_bitfield(&vinfo.green, 8, 8);
+    trik_set_bitfield(&vinfo.blue, 0, 8);
+  }
+  line_length = config->width * config->bpp / 8;
+  pages = 1;
+  if (ftruncate(fd, (off_t) line_length * vinfo.yres) == -1) {
+    errorf("failed to size the framebuffer file");
+    return -1;
+  }
+  return 0;
+}
+
+// asks for a virtual screen of two pages when the device does not have one yet
+static int trik_setup_fbdev(void) {
+  struct fb_fix_screeninfo finfo;
+  if (ioctl(fd, FBIOGET_VSCREENINFO, &vinfo) == -1) {
+    errorf("failed to read variable information");
+    return -1;
+  }
+  if (vinfo.yres_virtual < 2 * vinfo.yres) {
+    struct fb_var_screeninfo request = vinfo;
+    request.yres_virtual = 2 * vinfo.yres;
+    if (ioctl(fd, FBIOPUT_VSCREENINFO, &request) == -1 || ioctl(fd, FBIOGET_VSCREENINFO, &vinfo) == -1)
+      warnf("framebuffer has no room for a second page");
+  }
+  if (ioctl(fd, FBIOGET_FSCREENINFO, &finfo) == -1) {
+    errorf("failed to read fixed information");
+    return -1;
+  }
+  line_length = finfo.line_length;
+  pages = vinfo.yres_virtual >= 2 * vinfo.yres && finfo.smem_len >= 2 * vinfo.yres * line_length ? 2 : 1;
+  return 0;
+}
+
+static int trik_pan_display(uint32_t page) {
+  vinfo.xoffset = 0;
+  vinfo.yoffset = page * vinfo.yres;
+  return ioctl(fd, FBIOPAN_DISPLAY, &vinfo);
+}
+
+int trik_init_display(const struct trik_display_config* config) {
+  struct stat st;
+  fd = open(config->dev_name, O_RDWR);
+  if (fd == -1) {
+    errorf("cannot open framebuffer '%s'", config->dev_name);
+    return -1;
+  }
+  if (fstat(fd, &st) == -1 || (S_ISREG(st.st_mode) ? trik_setup_file(config) : trik_setup_fbdev()) < 0)
+    goto fail;
+
+  bytes_per_pixel = vinfo.bits_per_pixel / 8;
+  if (vinfo.bits_per_pixel % 8 != 0 || bytes_per_pixel < 2 || bytes_per_pixel > 4 || line_length < vinfo.xres * bytes_per_pixel) {
+    errorf("unsupported framebuffer format, %u bits per pixel", vinfo.bits_per_pixel);
+    goto fail;
+  }
+  native_rgb565 = bytes_per_pixel == 2 && vinfo.red.offset == 11 && vinfo.red.length == 5 && vinfo.green.offset == 5 && vinfo.green.length == 6 &&
+                  vinfo.blue.offset == 0 && vinfo.blue.length == 5;
+  rotate = (config->rotate == TRIK_DISPLAY_ROTATE_DEVICE ? vinfo.rotate : (uint32_t) config->rotate) & 3;
+
+  fb_size = (size_t) line_length * vinfo.yres * pages;
+  fb_mem = (uint8_t*) mmap(0, fb_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (fb_mem == MAP_FAILED) {
+    fb_mem = NULL;
+    errorf("failed to map framebuffer device");
+    goto fail;
+  }
+  memset(fb_mem, 0, fb_size);
+
+  // the first page is shown while the second one is drawn
+  if (pages > 1 && trik_pan_display(0) == -1) {
+    warnf("framebuffer does not pan, drawing in place");
+    pages = 1;
+  }
+  back_page = pages > 1 ? 1 : 0;
+  debugf("framebuffer %ux%u, %u bpp, line %u bytes, %u page(s), rotation %u", vinfo.xres, vinfo.yres, vinfo.bits_per_pixel, line_length, pages, rotate);
+  return 0;
+
+fail:
+  close(fd);
+  fd = -1;
+  return -1;
+}
+
+int trik_destroy_display(void) {
+  if (fd == -1)
+    return 0;
+  if (pages > 1)
+    trik_pan_display(0);
+  if (fb_mem != NULL)
+    munmap(fb_mem, fb_size);
+  fb_mem = NULL;
+  close(fd);
+  fd = -1;
+  return 0;
+}
+
+// RGB565 to the channel layout of the device, channels are widened to 8 bits first
+static uint32_t trik_pack_pixel(uint16_t rgb565) {
+  const uint32_t r5 = rgb565 >> 11;
+  const uint32_t g6 = (rgb565 >> 5) & 0x3f;
+  const uint32_t b5 = rgb565 & 0x1f;
+  const uint32_t r = (r5 << 3) | (r5 >> 2);
+  const uint32_t g = (g6 << 2) | (g6 >> 4);
+  const uint32_t b = (b5 << 3) | (b5 >> 2);
+  return ((r >> (8 - vinfo.red.length)) << vinfo.red.offset) | ((g >> (8 - vinfo.green.length)) << vinfo.green.offset) |
+         ((b >> (8 - vinfo.blue.length)) << vinfo.blue.offset);
+}
+
+static void trik_store_pixel(uint8_t* dst, uint32_t pixel) {
+  if (bytes_per_pixel == 2)
+    *(uint16_t*) dst = pixel;
+  else if (bytes_per_pixel == 4)
+    *(uint32_t*) dst = pixel;
+  else {
+    dst[0] = pixel;
+    dst[1] = pixel >> 8;
+    dst[2] = pixel >> 16;
+  }
+}
+
+int trik_display_present(const uint16_t* image, uint32_t width, uint32_t height, uint32_t stride) {
+  if (fb_mem == NULL)
+    return -1;
+
+  // rotated image is centered and clipped to the screen
+  const uint32_t turned_width = rotate & 1 ? height : width;
+  const uint32_t turned_height = rotate & 1 ? width : height;
+  const uint32_t cols = turned_width < vinfo.xres ? turned_width : vinfo.xres;
+  const uint32_t rows = turned_height < vinfo.yres ? turned_height : vinfo.yres;
+  const uint32_t first_col = (turned_width - cols) / 2;
+  const uint32_t first_row = (turned_height - rows) / 2;
+  uint8_t* page = fb_mem + (size_t) back_page * vinfo.yres * line_length;
+  uint8_t* dst_origin = page + ((vinfo.yres - rows) / 2) * line_length + ((vinfo.xres - cols) / 2) * bytes_per_pixel;
+
+  for (uint32_t row = 0; row < rows; row++) {
+    uint8_t* dst = dst_origin + row * line_length;
+    const uint32_t y = first_row + row;
+    if (rotate == 0 && native_rgb565) {
+      memcpy(dst, image + y * stride + first_col, cols * sizeof(uint16_t));
+      continue;
+    }
+    for (uint32_t col = 0; col < cols; col++, dst += bytes_per_pixel) {
+      const uint32_t x = first_col + col;
+      uint32_t src_x, src_y;
+      switch (rotate) {
+      case FB_ROTATE_CW:
+        src_x = y;
+        src_y = height - 1 - x;
+        break;
+      case FB_ROTATE_UD:
+        src_x = width - 1 - x;
+        src_y = height - 1 - y;
+        break;
+      case FB_ROTATE_CCW:
+        src_x = width - 1 - y;
+        src_y = x;
+        break;
+      default:
+        src_x = x;
+        src_y = y;
+        break;
+      }
+      trik_store_pixel(dst, trik_pack_pixel(image[src_y * stride + src_x]));
+    }
+  }
+
+  if (pages == 1)
+    return 0;
+  if (trik_pan_display(back_page) == -1) {
+    errorf("failed to pan the framebuffer, errno %d", errno);
+    return -1;
+  }
+  back_page ^= 1;
+  return 0;
+}
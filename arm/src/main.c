@@ -17,6 +17,7 @@
 #include <trik/sensors/msg.h>
 
 #define DEFAULT_DEV_NAME "/dev/video0"
+#define DEFAULT_FB_NAME "/dev/fb0"
 #define DEFAULT_CONFIG_FILENAME "/etc/trik/sensors";
 
 static enum trik_cv_algorithm trik_cv_algorithm_from_string(char* string) {
@@ -30,21 +31,40 @@ static enum trik_cv_algorithm trik_cv_algorithm_from_string(char* string) {
     return TRIK_CV_ALGORITHM_LINE_SENSOR;
   else if (strcmp(string, "mxn_sensor") == 0)
     return TRIK_CV_ALGORITHM_MXN_SENSOR;
+  else if (strcmp(string, "motion_vector_sensor") == 0)
+    return TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR;
+  else if (strcmp(string, "lane_sensor") == 0)
+    return TRIK_CV_ALGORITHM_LANE_SENSOR;
   else
     return TRIK_CV_ALGORITHM_NONE;
 }
 
+// comma separated algorithms, such as "line_sensor,object_sensor", 0 when any of them is unknown
+static uint32_t trik_cv_algorithms_from_string(char* string) {
+  uint32_t cv_algorithms = 0;
+  for (char* name = strtok(string, ","); name != NULL; name = strtok(NULL, ",")) {
+    enum trik_cv_algorithm cv_algorithm = trik_cv_algorithm_from_string(name);
+    if (cv_algorithm == TRIK_CV_ALGORITHM_NONE)
+      return 0;
+    cv_algorithms |= TRIK_CV_ALGORITHM_BIT(cv_algorithm);
+  }
+  return cv_algorithms;
+}
+
 static void usage(void) {
-  printf("usage: trik-media-sensors [-h] [-d dev_name] [-c config_path] algorithm\n");
-  printf("possible algorithms: motion_sensor, edge_line_sensor, object_sensor, line_sensor, mxn_sensor\n");
+  printf("usage: trik-media-sensors [-h] [-d dev_name] [-f fb_name] [-c config_path] algorithm[,algorithm...]\n");
+  printf("possible algorithms: motion_sensor, edge_line_sensor, object_sensor, line_sensor, mxn_sensor, motion_vector_sensor, lane_sensor\n");
+  printf("several algorithms share the frame conversion, each one at the rate the config file schedules\n");
+  printf("example: trik-media-sensors line_sensor,object_sensor,mxn_sensor\n");
 }
 
 int main(int argc, char* argv[]) {
   char* dev_name = DEFAULT_DEV_NAME;
+  char* fb_name = DEFAULT_FB_NAME;
   char* config_filename = DEFAULT_CONFIG_FILENAME;
 
   int c;
-  while ((c = getopt(argc, argv, "hd:c:")) != -1) {
+  while ((c = getopt(argc, argv, "hd:f:c:")) != -1) {
     switch (c) {
     case 'h':
       usage();
@@ -52,11 +72,14 @@ int main(int argc, char* argv[]) {
     case 'd':
       dev_name = optarg;
       break;
+    case 'f':
+      fb_name = optarg;
+      break;
     case 'c':
       config_filename = optarg;
       break;
     case '?':
-      if (optopt == 'c')
+      if (optopt == 'c' || optopt == 'f')
         fprintf(stderr, "option -%c requires an argument", optopt);
       return -1;
     default:
@@ -68,7 +91,11 @@ int main(int argc, char* argv[]) {
     usage();
     return -1;
   }
-  enum trik_cv_algorithm cv_algorithm = trik_cv_algorithm_from_string(argv[optind]);
+  uint32_t cv_algorithms = trik_cv_algorithms_from_string(argv[optind]);
+  if (cv_algorithms == 0) {
+    usage();
+    return -1;
+  }
 
   Ipc_transportConfig(&TransportRpmsg_Factory);
 
@@ -87,7 +114,7 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
-  if (trik_start_arm_server(cv_algorithm, dev_name, config_filename) < 0) {
+  if (trik_start_arm_server(cv_algorithms, dev_name, fb_name, config_filename) < 0) {
     printf("main(): failed to start trik arm server\n");
     return -1;
   }
@@ -0,0 +1,84 @@
+#ifndef TRIK_SENSORS_BINNING_HPP_
+#define TRIK_SENSORS_BINNING_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+
+#include "image.hpp"
+
+namespace trik {
+namespace sensors {
+
+static uint32_t s_binned_bn[(IMG_WIDTH / 2) * (IMG_HEIGHT / 2) / 2] __attribute__((aligned(8))); // yuyv words of the half resolution frame
+
+/*
+ * 2x2 box averaging of YUYV frames into a half resolution working image, and the matching nearest neighbour
+ * upscale of the preview which sensors render at half resolution.
+ */
+class Binning2x2 {
+public:
+  // _binnedDesc gets the half resolution frame, stored in a packed buffer of its own
+  bool bin(const ImageBuffer& _inImage, const ImageDesc& _inImageDesc, ImageBuffer& _binnedImage, ImageDesc& _binnedDesc) const {
+    const uint32_t width = _inImageDesc.m_width;
+    const uint32_t height = _inImageDesc.m_height;
+    if (width % 4 != 0 || height % 2 != 0 || width * height > IMG_WIDTH * IMG_HEIGHT || height * _inImageDesc.m_lineLength > _inImage.m_size)
+      return false;
+
+    _binnedDesc.m_width = width / 2;
+    _binnedDesc.m_height = height / 2;
+    _binnedDesc.m_lineLength = width;
+    _binnedDesc.m_format = _inImageDesc.m_format;
+    _binnedImage.m_ptr = reinterpret_cast<int8_t*>(s_binned_bn);
+    _binnedImage.m_size = _binnedDesc.m_height * _binnedDesc.m_lineLength;
+
+    uint32_t* restrict dst = s_binned_bn;
+    for (uint32_t row = 0; row < height; row += 2) {
+      const uint64_t* restrict src1 = reinterpret_cast<const uint64_t*>(_inImage.m_ptr + row * _inImageDesc.m_lineLength);
+      const uint64_t* restrict src2 = reinterpret_cast<const uint64_t*>(_inImage.m_ptr + (row + 1) * _inImageDesc.m_lineLength);
+      // Y0 U0 Y1 V0 Y2 U1 Y3 V1 -> avg(Y0,Y1) avg(U0,U1) avg(Y2,Y3) avg(V0,V1), both rows averaged first
+#pragma MUST_ITERATE(2, , 2)
+      for (uint32_t col = 0; col < width; col += 4) {
+        const uint64_t yuyv1 = *src1++;
+        const uint64_t yuyv2 = *src2++;
+        const uint32_t lo = _avgu4(_loll(yuyv1), _loll(yuyv2));
+        const uint32_t hi = _avgu4(_hill(yuyv1), _hill(yuyv2));
+        const uint32_t luma = _packl4(hi, lo);   // Y3 Y2 Y1 Y0
+        const uint32_t chroma = _packh4(hi, lo); // V1 U1 V0 U0
+        const uint32_t lumaAvg = _avgu4(luma, _swap4(luma));
+        const uint32_t chromaAvg = _avgu4(chroma, _rotl(chroma, 16));
+        *dst++ = (lumaAvg & 0x00ff00ffu) | ((chromaAvg << 8) & 0x0000ff00u) | (chromaAvg & 0xff000000u);
+      }
+    }
+    return true;
+  }
+
+  // doubles a _width x _height RGB565 image in place, rows are _lineLength bytes apart and the buffer must hold the doubled image
+  void upscale(ImageBuffer& _outImage, const uint32_t _width, const uint32_t _height, const uint32_t _lineLength) const {
+    if (2 * _height * _lineLength > _outImage.m_size || _width % 2 != 0 || 2 * _width * sizeof(uint16_t) > _lineLength)
+      return;
+
+    // bottom up and right to left, so every source pixel is read before a doubled one lands on it
+    for (int32_t row = _height - 1; row >= 0; --row) {
+      const uint32_t* src = reinterpret_cast<const uint32_t*>(_outImage.m_ptr + row * _lineLength); // overlaps dst on row 0
+      uint64_t* dst = reinterpret_cast<uint64_t*>(_outImage.m_ptr + 2 * row * _lineLength);
+#pragma MUST_ITERATE(1, , 1)
+      for (int32_t pair = _width / 2 - 1; pair >= 0; --pair) {
+        const uint32_t pixels = src[pair];
+        dst[pair] = _itoll(_pack2(pixels >> 16, pixels >> 16), _pack2(pixels, pixels));
+      }
+      memcpy(_outImage.m_ptr + (2 * row + 1) * _lineLength, dst, 2 * _width * sizeof(uint16_t));
+    }
+    _outImage.m_size = 2 * _height * _lineLength;
+  }
+};
+
+}
+}
+
+#endif
@@ -38,9 +38,6 @@ private:
   uint64_t m_detectRange;
   uint32_t m_detectExpected;
 
-  ImageDesc m_inImageDesc;
-  ImageDesc m_outImageDesc;
-
   uint32_t m_detectHueFrom;
   uint32_t m_detectHueTo;
   uint32_t m_detectSatFrom;
@@ -114,6 +111,8 @@ public:
     resetHsvRange();
     // }
 
+    setupRois(_inArgs);
+
     const uint64_t u64_hsv_range = m_detectRange;
     const uint32_t u32_hsv_expect = m_detectExpected;
 
@@ -130,8 +129,8 @@ public:
           |12|13|14|15|
           -------------
     */
-    const uint64_t* restrict p_inImg = reinterpret_cast<const uint64_t*>(_inImage.m_ptr);
-    const uint16_t* restrict p_hi2ho = s_hi2ho_bb;
+    const uint64_t* restrict inImg = reinterpret_cast<const uint64_t*>(_inImage.m_ptr);
+    uint16_t* restrict outImg = reinterpret_cast<uint16_t*>(_outImage.m_ptr);
 
     int64_t detectedPoints = 0;
 #ifdef HSV_CORRECTION
@@ -141,32 +140,36 @@ public:
     memset(midS, 0, 256 * sizeof(uint32_t));
 #endif
 
-    // just detect and build metapixels:
-    uint8_t* restrict p_metapixFillerShifter = s_metapixFillerShifter_bb;
-    uint8_t metapixFiller = 0;
+    // just detect and build metapixels, ROI spans start and end on metapixel boundaries:
+    RoiSpan spans[TRIK_MAX_ROIS];
     U_Hsv8x3 pixel;
-#pragma MUST_ITERATE(4, , 4)
-    for (uint16_t srcRow = 0; srcRow < m_inImageDesc.m_height; srcRow++) {
-      uint16_t* restrict p_outImg = reinterpret_cast<uint16_t*>(_outImage.m_ptr) + *(p_hi2ho++);
-      const uint16_t metapixFillerShifter = *(p_metapixFillerShifter++); //(0 4 8 12)...
+    for (uint32_t srcRow = m_roiRowBegin; srcRow < m_roiRowEnd; srcRow++) {
+      const uint16_t metapixFillerShifter = s_metapixFillerShifter_bb[srcRow]; //(0 4 8 12)...
+      const uint32_t spanCount = roiRowSpans(srcRow, spans);
 
-#pragma MUST_ITERATE(32, , 32)
-      for (uint16_t srcCol = 0; srcCol < m_inImageDesc.m_width; srcCol++) {
-        pixel.whole = _loll(*(p_inImg++));
-        bool det = detectHsvPixel(pixel.whole, u64_hsv_range, u32_hsv_expect);
+      for (uint32_t span = 0; span < spanCount; ++span) {
+        const uint64_t* restrict p_inImg = inImg + srcRow * m_inImageDesc.m_width + spans[span].m_begin;
+        uint16_t* restrict p_outImg = outImg + s_hi2ho_bb[srcRow] + spans[span].m_begin / METAPIX_SIZE;
+        uint8_t metapixFiller = 0;
+
+#pragma MUST_ITERATE(8, , 8)
+        for (uint32_t srcCol = spans[span].m_begin; srcCol < spans[span].m_end; srcCol++) {
+          pixel.whole = _loll(*(p_inImg++));
+          bool det = detectHsvPixel(pixel.whole, u64_hsv_range, u32_hsv_expect);
 
 #ifdef HSV_CORRECTION
-        if (det) {
-          midH[pixel.parts.h]++;
-          midS[pixel.parts.s]++;
-          detectedPoints++;
-        }
+          if (det) {
+            midH[pixel.parts.h]++;
+            midS[pixel.parts.s]++;
+            detectedPoints++;
+          }
 #endif
-        *p_outImg += det << (metapixFillerShifter + metapixFiller++);
+          *p_outImg += det << (metapixFillerShifter + metapixFiller++);
 
-        if (metapixFiller == METAPIX_SIZE) {
-          p_outImg++;
-          metapixFiller = 0;
+          if (metapixFiller == METAPIX_SIZE) {
+            p_outImg++;
+            metapixFiller = 0;
+          }
         }
       }
     }
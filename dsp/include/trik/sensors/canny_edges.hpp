@@ -0,0 +1,187 @@
+#ifndef TRIK_SENSORS_CANNY_EDGES_HPP_
+#define TRIK_SENSORS_CANNY_EDGES_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+
+#include "harris_corners.hpp"
+#include "image.hpp"
+
+extern "C" {
+#include <ti/imglib/src/IMG_corr_3x3_i8_c16s/IMG_corr_3x3_i8_c16s.h>
+}
+
+namespace trik {
+namespace sensors {
+
+#define CANNY_TAN22_Q7 53       // tan(22.5) in Q7, splits gradient directions into four sectors
+#define CANNY_STACK_SIZE 2048   // hysteresis stops growing edges beyond that many pending pixels
+#define CANNY_WEAK 0x01         // edge map marks during hysteresis
+#define CANNY_STRONG 0xff
+
+static const int16_t s_sobelX_ce[9] = { -1, 0, 1, -2, 0, 2, -1, 0, 1 };
+static const int16_t s_sobelY_ce[9] = { -1, -2, -1, 0, 0, 0, 1, 2, 1 };
+
+static int32_t s_grad_ce[2][IMG_WIDTH] __attribute__((aligned(8))); // corr output, element i is column i + 1
+static int16_t s_gradX_ce[3][IMG_WIDTH];                            // rings of the last three rows
+static int16_t s_gradY_ce[3][IMG_WIDTH];
+static int16_t s_mag_ce[3][IMG_WIDTH];
+static uint32_t s_stack_ce[CANNY_STACK_SIZE];
+
+/*
+ * Canny-lite: signed Sobel gradients, non-maximum suppression across the quantized gradient direction and
+ * two-level hysteresis. Gradients are kept for three rows only, full frame planes are 8-bit.
+ */
+class CannyEdgeDetector {
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+
+  void gradientRow(const uint8_t* restrict _luma, const uint32_t _row, uint8_t* restrict _magnitude) const {
+    const uint32_t width = m_width;
+    const uint32_t slot = _row % 3;
+    const uint8_t* restrict src = _luma + (_row - 1) * width;
+    IMG_corr_3x3_i8_c16s(src, s_grad_ce[0], width - 2, width, s_sobelX_ce);
+    IMG_corr_3x3_i8_c16s(src, s_grad_ce[1], width - 2, width, s_sobelY_ce);
+
+    const int32_t* restrict corrX = s_grad_ce[0];
+    const int32_t* restrict corrY = s_grad_ce[1];
+    int16_t* restrict gradX = s_gradX_ce[slot] + 1;
+    int16_t* restrict gradY = s_gradY_ce[slot] + 1;
+    int16_t* restrict mag = s_mag_ce[slot] + 1;
+    uint8_t* restrict magOut = _magnitude + _row * width + 1;
+#pragma MUST_ITERATE(2, , 2)
+    for (uint32_t i = 0; i < width - 2; ++i) {
+      const int32_t gx = corrX[i];
+      const int32_t gy = corrY[i];
+      const int32_t m = _abs(gx) + _abs(gy); // same norm as IMG_sobel_3x3_8
+      gradX[i] = gx;
+      gradY[i] = gy;
+      mag[i] = m;
+      magOut[i] = m > 255 ? 255 : m;
+    }
+  }
+
+  void suppressRow(const uint32_t _row, uint8_t* restrict _thin) const {
+    const int16_t* restrict above = s_mag_ce[(_row - 1) % 3];
+    const int16_t* restrict center = s_mag_ce[_row % 3];
+    const int16_t* restrict below = s_mag_ce[(_row + 1) % 3];
+    const int16_t* restrict gradX = s_gradX_ce[_row % 3];
+    const int16_t* restrict gradY = s_gradY_ce[_row % 3];
+    uint8_t* restrict thin = _thin + _row * m_width;
+
+    for (uint32_t x = 1; x < m_width - 1; ++x) {
+      const int32_t m = center[x];
+      const int32_t gx = gradX[x];
+      const int32_t gy = gradY[x];
+      const int32_t ax = _abs(gx);
+      const int32_t ay = _abs(gy);
+
+      // neighbours across the edge, y axis pointing down
+      int32_t m1;
+      int32_t m2;
+      if (ay * 128 <= ax * CANNY_TAN22_Q7) {
+        m1 = center[x - 1];
+        m2 = center[x + 1];
+      } else if (ax * 128 <= ay * CANNY_TAN22_Q7) {
+        m1 = above[x];
+        m2 = below[x];
+      } else if ((gx ^ gy) >= 0) {
+        m1 = above[x - 1];
+        m2 = below[x + 1];
+      } else {
+        m1 = above[x + 1];
+        m2 = below[x - 1];
+      }
+
+      // strict on one side, so two pixel wide ridges keep a single pixel
+      thin[x] = (m > m1 && m >= m2) ? (m > 255 ? 255 : m) : 0;
+    }
+  }
+
+public:
+  CannyEdgeDetector()
+    : m_width(0)
+    , m_height(0) {}
+
+  bool setup(const ImageDesc& _imageDesc) {
+    m_width = _imageDesc.m_width;
+    m_height = _imageDesc.m_height;
+    return m_width <= IMG_WIDTH && m_width >= 4 && m_height >= 4 && m_width % 2 == 0;
+  }
+
+  // _magnitude gets the gradient magnitude, _thin the magnitude left after non-maximum suppression, border pixels are zero in both;
+  // gradient rows are also handed to _corners when given, so the Harris stage does not compute them again
+  void suppress(const uint8_t* restrict _luma, uint8_t* restrict _magnitude, uint8_t* restrict _thin, HarrisCornerDetector* _corners) const {
+    const uint32_t width = m_width;
+    const uint32_t height = m_height;
+
+    memset(s_mag_ce, 0, sizeof(s_mag_ce));
+    memset(_magnitude, 0, width);
+    memset(_magnitude + (height - 1) * width, 0, width);
+    memset(_thin, 0, 2 * width);
+    memset(_thin + (height - 2) * width, 0, 2 * width);
+
+    for (uint32_t row = 1; row < height - 1; ++row) {
+      gradientRow(_luma, row, _magnitude);
+      if (_corners != NULL)
+        _corners->addGradientRow(s_gradX_ce[row % 3] + 1, s_gradY_ce[row % 3] + 1, row);
+      _magnitude[row * width] = 0;
+      _magnitude[row * width + width - 1] = 0;
+      if (row >= 3) {
+        suppressRow(row - 1, _thin);
+        _thin[(row - 1) * width] = 0;
+        _thin[(row - 1) * width + width - 1] = 0;
+      }
+    }
+  }
+
+  // turns the suppressed magnitude into a 0x00/0xff edge map in place
+  void hysteresis(uint8_t* restrict _edges, const uint32_t _low, const uint32_t _high) const {
+    const uint32_t width = m_width;
+    const uint32_t pixels = width * m_height;
+    uint32_t stackSize = 0;
+
+    for (uint32_t pix = 0; pix < pixels; ++pix) {
+      const uint32_t m = _edges[pix];
+      if (m > _high) {
+        _edges[pix] = CANNY_STRONG;
+        if (stackSize < CANNY_STACK_SIZE)
+          s_stack_ce[stackSize++] = pix;
+      } else
+        _edges[pix] = m > _low ? CANNY_WEAK : 0;
+    }
+
+    // border pixels are never marked, so neighbours of a marked pixel are always inside the frame
+    const int32_t neighbours[8] = { -static_cast<int32_t>(width) - 1, -static_cast<int32_t>(width), -static_cast<int32_t>(width) + 1, -1, 1,
+      static_cast<int32_t>(width) - 1, static_cast<int32_t>(width), static_cast<int32_t>(width) + 1 };
+    while (stackSize > 0) {
+      const uint32_t pix = s_stack_ce[--stackSize];
+      for (uint32_t n = 0; n < 8; ++n) {
+        const uint32_t neighbour = pix + neighbours[n];
+        if (_edges[neighbour] != CANNY_WEAK)
+          continue;
+        _edges[neighbour] = CANNY_STRONG;
+        if (stackSize < CANNY_STACK_SIZE)
+          s_stack_ce[stackSize++] = neighbour;
+      }
+    }
+
+#pragma MUST_ITERATE(8, , 8)
+    for (uint32_t pix = 0; pix < pixels; ++pix)
+      _edges[pix] = _edges[pix] == CANNY_STRONG ? CANNY_STRONG : 0;
+  }
+};
+
+}
+}
+
+#endif
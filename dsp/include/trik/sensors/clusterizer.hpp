@@ -38,9 +38,6 @@ static inline bool compareTargetBySize(const Target& a, const Target& b) { retur
 
 class ClusterizerCvAlgorithm : public CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X> {
 private:
-  ImageDesc m_inImageDesc;
-  ImageDesc m_outImageDesc;
-
   std::vector<uint16_t> equalClusters;
   std::vector<Target> clusters;
 
@@ -143,7 +140,7 @@ public:
 
   int32_t getY(int i) { return (clusters[i].y / (clusters[i].size + 1)) * METAPIX_SIZE; }
 
-  uint16_t getSize(int i) { return clusters[i].size; }
+  uint16_t getSize(int i) { return i < clusters.size() ? clusters[i].size : 0; } // frames often have fewer clusters than OBJECTS
 
   virtual bool setup(const ImageDesc& _inImageDesc, const ImageDesc& _outImageDesc, int8_t* _fastRam, size_t _fastRamSize) {
     m_inImageDesc = _inImageDesc;
@@ -166,15 +163,23 @@ public:
     clusters.push_back(bg);
     m_maxCluster = 1;
 
-    const uint16_t* restrict srcImgPtr = reinterpret_cast<uint16_t*>(_inImage.m_ptr);
-    uint16_t* restrict dstImgPtr = reinterpret_cast<uint16_t*>(_outImage.m_ptr);
-
-    for (int srcRow = 0; srcRow < m_inImageDesc.m_height; srcRow++) {
-      for (int srcCol = 0; srcCol < m_inImageDesc.m_width; srcCol++) {
-        if (pop(*(srcImgPtr++)) > METAPIX_SIZE / 2) // metapix detected if there are more than N pixels
-          setClusterNum(dstImgPtr, srcRow, srcCol);
-
-        dstImgPtr++;
+    const uint16_t* restrict srcImg = reinterpret_cast<uint16_t*>(_inImage.m_ptr);
+    uint16_t* restrict dstImg = reinterpret_cast<uint16_t*>(_outImage.m_ptr);
+
+    // metapixels outside of ROIs stay background, rows are still walked in raster order so neighbours are labeled first
+    setupRois(_inArgs, METAPIX_SIZE);
+    RoiSpan spans[TRIK_MAX_ROIS];
+    for (int srcRow = m_roiRowBegin; srcRow < m_roiRowEnd; srcRow++) {
+      const uint32_t spanCount = roiRowSpans(srcRow, spans);
+      for (uint32_t span = 0; span < spanCount; ++span) {
+        const uint16_t* restrict srcImgPtr = srcImg + srcRow * m_inImageDesc.m_width + spans[span].m_begin;
+        uint16_t* restrict dstImgPtr = dstImg + srcRow * m_inImageDesc.m_width + spans[span].m_begin;
+        for (int srcCol = spans[span].m_begin; srcCol < spans[span].m_end; srcCol++) {
+          if (pop(*(srcImgPtr++)) > METAPIX_SIZE / 2) // metapix detected if there are more than N pixels
+            setClusterNum(dstImgPtr, srcRow, srcCol);
+
+          dstImgPtr++;
+        }
       }
     }
 
@@ -9,9 +9,13 @@ extern "C" {
 #include <trik/sensors/cv_algorithm.h>
 #include <trik/sensors/cv_algorithm_args.h>
 
-int trik_init_cv_algorithm(enum trik_cv_algorithm algorithm);
-int trik_run_cv_algorithm(enum trik_cv_algorithm algorithm, struct buffer in_buffer, struct buffer out_buffer, struct trik_cv_algorithm_in_args in_args,
-  struct trik_cv_algorithm_out_args* out_args);
+// cv_algorithms is a TRIK_CV_ALGORITHM_BIT mask, out_args of every sensor of the set go into results
+int trik_init_cv_algorithm(uint32_t cv_algorithms, bool binned, uint8_t preview_scale);
+// auto_detect_hsv is the mask of the sensors detecting their HSV range on the frame, in place of in_args.auto_detect_hsv
+int trik_run_cv_algorithm(uint32_t cv_algorithms, uint32_t auto_detect_hsv, struct buffer in_buffer, struct buffer out_buffer,
+  struct trik_cv_algorithm_draw_list* draw_list, struct trik_cv_algorithm_in_args in_args, struct trik_cv_algorithm_results* results);
+bool trik_detect_frame_change(struct buffer in_buffer, uint32_t threshold);
+void trik_reset_frame_change_detector(void);
 
 #ifdef __cplusplus
 }
@@ -9,11 +9,18 @@
 #include <cassert>
 #include <cmath>
 #include <stdint.h>
+#include <string.h>
 
 #include "image.hpp"
 #include "video_format.hpp"
 #include <trik/sensors/cv_algorithm_args.h>
 
+#include <xdc/runtime/Timestamp.h>
+
+extern "C" {
+#include <ti/imglib/src/IMG_ycbcr422pl_to_rgb565/IMG_ycbcr422pl_to_rgb565.h>
+}
+
 namespace trik {
 namespace sensors {
 
@@ -57,6 +64,21 @@ inline int makeValueWrap(int _val, int _adj, int _min, int _max) {
   return _val;
 }
 
+// camera frame planes of the preview background, sensors which demux the frame anyway may bring their own luma
+static uint8_t s_luma_pv[IMG_WIDTH * IMG_HEIGHT] __attribute__((aligned(8)));
+static uint8_t s_cb_pv[IMG_WIDTH * IMG_HEIGHT / 2] __attribute__((aligned(8)));
+static uint8_t s_cr_pv[IMG_WIDTH * IMG_HEIGHT / 2] __attribute__((aligned(8)));
+// one output row of a reduced preview, gathered from every n-th source pixel
+static uint8_t s_rowLuma_pv[IMG_WIDTH / 2] __attribute__((aligned(8)));
+static uint8_t s_rowCb_pv[IMG_WIDTH / 4] __attribute__((aligned(8)));
+static uint8_t s_rowCr_pv[IMG_WIDTH / 4] __attribute__((aligned(8)));
+
+static const short s_coeff_pv[5] = { 0x2543, 0x3313, -0x0C8A, -0x1A04, 0x408D }; // BT.601 studio range in Q13, as in convert2xYuyvToRgb888
+
+#define ROI_COL_ALIGN 8 // ROI columns are processed in packed pixel groups
+#define ROI_ROW_ALIGN 4 // ROI rows cover whole metapixels
+#define SAMPLE_MAX_STRIDE 8
+
 template <VideoFormat _inFormat, VideoFormat _outFormat>
 class CvAlgorithm {
 public:
@@ -68,10 +90,57 @@ public:
 
   virtual ~CvAlgorithm() {}
 
+  // buffer shared with the ARM, filled instead of the output buffer by sensors running with TRIK_PREVIEW_DRAW_LIST
+  static void setDrawList(trik_cv_algorithm_draw_list* _drawList) { s_drawList = _drawList; }
+
+  // called once per camera frame, every sensor of a set then runs on the same frame
+  static void startFrame() { ++s_frame; }
+
 protected:
+  struct RoiRect {
+    uint32_t m_colBegin;
+    uint32_t m_colEnd;
+    uint32_t m_rowBegin;
+    uint32_t m_rowEnd;
+  };
+
+  struct RoiSpan {
+    uint32_t m_begin;
+    uint32_t m_end;
+  };
+
+  // pixels of a frame convertImageYuyvToHsv put into s_rgb888hsv
+  struct HsvCoverage {
+    RoiRect m_rois[TRIK_MAX_ROIS];
+    uint32_t m_roiCount;
+    uint32_t m_sampleStride;
+    uint32_t m_samplePhase;
+    uint32_t m_pairPhase; // parity of the checkerboard pair offsets, 2 without checkerboard sampling
+  };
+
   ImageDesc m_inImageDesc;
   ImageDesc m_outImageDesc;
 
+  RoiRect m_rois[TRIK_MAX_ROIS]; // sorted by first column
+  uint32_t m_roiCount;
+  uint32_t m_roiRowBegin; // rows covered by any ROI
+  uint32_t m_roiRowEnd;
+  bool m_roiFullFrame;
+
+  uint32_t m_sampleStride; // every m_sampleStride-th row is processed
+  uint32_t m_samplePhase;  // first processed row, rotated every frame so all rows get their turn
+  uint32_t m_sampleFrame;
+  bool m_sampleCheckerboard; // processed rows take one pixel pair of every four pixels, alternating between rows
+
+  bool m_previewImage;   // camera frame and detected pixels are rendered into the output buffer
+  bool m_previewOverlay; // detections and sensor geometry are drawn over the preview
+  trik_cv_algorithm_draw_list* m_drawList; // overlay goes there as draw commands instead, NULL when it is drawn into the output buffer
+
+  static trik_cv_algorithm_draw_list* s_drawList;
+  static uint32_t s_frame;        // frames started so far
+  static uint32_t s_previewFrame; // frame whose background is in the output buffer, drawn by the first sensor run on it
+  static uint32_t s_hsvFrame;     // frame s_rgb888hsv was last converted from, over s_hsvCoverage
+  static HsvCoverage s_hsvCoverage;
   static uint64_t s_rgb888hsv[IMG_WIDTH * IMG_HEIGHT];
   static uint32_t s_wi2wo[IMG_WIDTH];
   static uint32_t s_hi2ho[IMG_HEIGHT];
@@ -79,8 +148,12 @@ protected:
   static uint16_t* restrict s_mult43_div;
   static uint16_t* restrict s_mult255_div;
 
+  static uint16_t __attribute__((always_inline)) convertRgb888ToRgb565(const uint32_t _rgb888) {
+    return ((_rgb888 >> 3) & 0x001f) | ((_rgb888 >> 5) & 0x07e0) | ((_rgb888 >> 8) & 0xf800);
+  }
+
   static void __attribute__((always_inline)) writeOutputPixel(uint16_t* restrict _rgb565ptr, const uint32_t _rgb888) {
-    *_rgb565ptr = ((_rgb888 >> 3) & 0x001f) | ((_rgb888 >> 5) & 0x07e0) | ((_rgb888 >> 8) & 0xf800);
+    *_rgb565ptr = convertRgb888ToRgb565(_rgb888);
   }
 
   void __attribute__((always_inline)) drawOutputPixelBound(const int32_t _srcCol, const int32_t _srcRow, const int32_t _srcColBot, const int32_t _srcColTop,
@@ -96,171 +169,214 @@ protected:
     writeOutputPixel(reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstOfs), _rgb888);
   }
 
-  void __attribute__((always_inline)) drawFatPixel(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
-
-    drawOutputPixelBound(_srcCol - 1, _srcRow - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol - 1, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol - 1, _srcRow + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + 1, _srcRow - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + 1, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + 1, _srcRow + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+  static uint32_t __attribute__((always_inline)) packOutputPixels(const uint32_t _rgb888) {
+    const uint32_t rgb565 = convertRgb888ToRgb565(_rgb888);
+    return _pack2(rgb565, rgb565);
   }
 
-  void __attribute__((always_inline))
-  drawRgbTargetCenterLine(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
+  // commands past the end of the list are counted and dropped, the ARM still draws the ones that fit
+  void appendDrawCommand(const trik_draw_op _op, const int32_t _x0, const int32_t _y0, const int32_t _x1, const int32_t _y1, const uint32_t _rgb888,
+    const uint32_t _width = 1) const {
+    if (m_drawList->count >= TRIK_MAX_DRAW_COMMANDS) {
+      ++m_drawList->dropped;
+      return;
+    }
+    trik_cv_algorithm_draw_cmd& cmd = m_drawList->cmds[m_drawList->count++];
+    cmd.op = _op;
+    cmd.width = _width;
+    cmd.rgb565 = convertRgb888ToRgb565(_rgb888);
+    cmd.x0 = _x0;
+    cmd.y0 = _y0;
+    cmd.x1 = _x1;
+    cmd.y1 = _y1;
+  }
 
-    for (int adj = 0; adj < 100; ++adj) {
-      drawOutputPixelBound(_srcCol, _srcRow - adj, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol, _srcRow + adj, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+  /*
+   * Filled box of source pixels [_colBegin, _colEnd) x [_rowBegin, _rowEnd), clipped to the frame once and filled over
+   * its output rows with two pixel stores. Source to output scaling is monotonic, so a run of source pixels maps onto
+   * a run of output pixels.
+   */
+  void fillOutputBox(int32_t _colBegin, int32_t _colEnd, int32_t _rowBegin, int32_t _rowEnd, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    if (m_drawList != NULL) {
+      appendDrawCommand(TRIK_DRAW_FILL, _colBegin, _rowBegin, _colEnd, _rowEnd, _rgb888);
+      return;
+    }
+    _colBegin = _colBegin > 0 ? _colBegin : 0;
+    _rowBegin = _rowBegin > 0 ? _rowBegin : 0;
+    _colEnd = _colEnd < static_cast<int32_t>(m_inImageDesc.m_width) ? _colEnd : m_inImageDesc.m_width;
+    _rowEnd = _rowEnd < static_cast<int32_t>(m_inImageDesc.m_height) ? _rowEnd : m_inImageDesc.m_height;
+    if (_colBegin >= _colEnd || _rowBegin >= _rowEnd)
+      return;
+
+    const uint32_t dstColBegin = s_wi2wo[_colBegin];
+    const uint32_t dstColEnd = s_wi2wo[_colEnd - 1] + 1;
+    const uint32_t dstRowEnd = s_hi2ho[_rowEnd - 1] + 1;
+    const uint32_t pixels = packOutputPixels(_rgb888);
+    for (uint32_t dstRow = s_hi2ho[_rowBegin]; dstRow < dstRowEnd; ++dstRow) {
+      uint16_t* restrict dst = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRow * m_outImageDesc.m_lineLength) + dstColBegin;
+      uint32_t count = dstColEnd - dstColBegin;
+      if ((reinterpret_cast<uintptr_t>(dst) & 2) != 0) {
+        *dst++ = static_cast<uint16_t>(pixels);
+        --count;
+      }
+      uint32_t* restrict dstPair = reinterpret_cast<uint32_t*>(dst);
+      for (uint32_t pair = 0; pair < count / 2; ++pair)
+        *dstPair++ = pixels;
+      if ((count & 1) != 0)
+        *reinterpret_cast<uint16_t*>(dstPair) = static_cast<uint16_t>(pixels);
     }
   }
 
   void __attribute__((always_inline))
-  drawRgbTargetHorizontalCenterLine(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
+  drawOutputHorizontalSpan(const int32_t _colBegin, const int32_t _colEnd, const int32_t _row, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    fillOutputBox(_colBegin, _colEnd, _row, _row + 1, _outImage, _rgb888);
+  }
 
-    for (int adj = 0; adj < 100; ++adj) {
-      drawOutputPixelBound(_srcCol - adj, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol + adj, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    }
+  void __attribute__((always_inline))
+  drawOutputVerticalSpan(const int32_t _col, const int32_t _rowBegin, const int32_t _rowEnd, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    fillOutputBox(_col, _col + 1, _rowBegin, _rowEnd, _outImage, _rgb888);
+  }
+
+  void __attribute__((always_inline)) drawFatPixel(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    fillOutputBox(_srcCol - 1, _srcCol + 2, _srcRow - 1, _srcRow + 2, _outImage, _rgb888);
   }
 
   void __attribute__((always_inline))
-  drawOutputCircle(const int32_t _srcCol, const int32_t _srcRow, const int32_t _srcRadius, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
+  drawRgbTargetCenterLine(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
+    if (m_drawList != NULL)
+      appendDrawCommand(TRIK_DRAW_CROSSHAIR, _srcCol, _srcRow, 0, 99, _rgb888);
+    else
+      drawOutputVerticalSpan(_srcCol, _srcRow - 99, _srcRow + 100, _outImage, _rgb888);
+  }
+
+  void __attribute__((always_inline))
+  drawRgbTargetHorizontalCenterLine(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
+    if (m_drawList != NULL)
+      appendDrawCommand(TRIK_DRAW_CROSSHAIR, _srcCol, _srcRow, 99, 0, _rgb888);
+    else
+      drawOutputHorizontalSpan(_srcCol - 99, _srcCol + 100, _srcRow, _outImage, _rgb888);
+  }
 
+  // midpoint circle, every octant step keeps either the row or the column, so pixels are drawn as runs along it
+  void drawOutputCircle(const int32_t _srcCol, const int32_t _srcRow, const int32_t _srcRadius, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    if (m_drawList != NULL) {
+      appendDrawCommand(TRIK_DRAW_CIRCLE, _srcCol, _srcRow, _srcRadius, 0, _rgb888);
+      return;
+    }
     int32_t circleError = 1 - _srcRadius;
     int32_t circleErrorY = 1;
     int32_t circleErrorX = -2 * _srcRadius;
     int32_t circleX = _srcRadius;
     int32_t circleY = 0;
-
-    drawOutputPixelBound(_srcCol, _srcRow + _srcRadius, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow - _srcRadius, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + _srcRadius, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol - _srcRadius, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-
-    while (circleY < circleX) {
-      if (circleError >= 0) {
-        circleX -= 1;
-        circleErrorX += 2;
-        circleError += circleErrorX;
+    int32_t runBegin = 0;
+
+    while (true) {
+      const bool last = circleY >= circleX;
+      const int32_t prevX = circleX;
+      if (!last) {
+        if (circleError >= 0) {
+          circleX -= 1;
+          circleErrorX += 2;
+          circleError += circleErrorX;
+        }
+        circleY += 1;
+        circleErrorY += 2;
+        circleError += circleErrorY;
       }
-      circleY += 1;
-      circleErrorY += 2;
-      circleError += circleErrorY;
-
-      drawOutputPixelBound(_srcCol + circleX, _srcRow + circleY, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol + circleX, _srcRow - circleY, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol - circleX, _srcRow + circleY, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol - circleX, _srcRow - circleY, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol + circleY, _srcRow + circleX, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol + circleY, _srcRow - circleX, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol - circleY, _srcRow + circleX, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_srcCol - circleY, _srcRow - circleX, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+      if (!last && circleX == prevX)
+        continue;
+
+      // run of circleY from runBegin to runEnd at circleX = prevX, mirrored into all octants
+      const int32_t runEnd = last ? circleY : circleY - 1;
+      drawOutputHorizontalSpan(_srcCol + runBegin, _srcCol + runEnd + 1, _srcRow + prevX, _outImage, _rgb888);
+      drawOutputHorizontalSpan(_srcCol - runEnd, _srcCol - runBegin + 1, _srcRow + prevX, _outImage, _rgb888);
+      drawOutputHorizontalSpan(_srcCol + runBegin, _srcCol + runEnd + 1, _srcRow - prevX, _outImage, _rgb888);
+      drawOutputHorizontalSpan(_srcCol - runEnd, _srcCol - runBegin + 1, _srcRow - prevX, _outImage, _rgb888);
+      drawOutputVerticalSpan(_srcCol + prevX, _srcRow + runBegin, _srcRow + runEnd + 1, _outImage, _rgb888);
+      drawOutputVerticalSpan(_srcCol - prevX, _srcRow + runBegin, _srcRow + runEnd + 1, _outImage, _rgb888);
+      drawOutputVerticalSpan(_srcCol + prevX, _srcRow - runEnd, _srcRow - runBegin + 1, _outImage, _rgb888);
+      drawOutputVerticalSpan(_srcCol - prevX, _srcRow - runEnd, _srcRow - runBegin + 1, _outImage, _rgb888);
+      if (last)
+        break;
+      runBegin = circleY;
     }
   }
 
   void __attribute__((always_inline)) drawRgbThinLine(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
-
-#pragma MUST_ITERATE(4, , 4)
-    for (int adj = 0; adj < m_inImageDesc.m_height; ++adj)
-      drawOutputPixelBound(_srcCol, _srcRow + adj, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+    if (m_drawList != NULL)
+      appendDrawCommand(TRIK_DRAW_LINE, _srcCol, _srcRow, _srcCol, _srcRow + m_inImageDesc.m_height - 1, _rgb888);
+    else
+      drawOutputVerticalSpan(_srcCol, _srcRow, _srcRow + m_inImageDesc.m_height, _outImage, _rgb888);
   }
 
   void __attribute__((always_inline))
   drawRgbHorizontalLine(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
-
-#pragma MUST_ITERATE(32, , 32)
-    for (int adj = 0; adj < m_inImageDesc.m_width; ++adj)
-      drawOutputPixelBound(_srcCol + adj, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+    if (m_drawList != NULL)
+      appendDrawCommand(TRIK_DRAW_LINE, _srcCol, _srcRow, _srcCol + m_inImageDesc.m_width - 1, _srcRow, _rgb888);
+    else
+      drawOutputHorizontalSpan(_srcCol, _srcCol + m_inImageDesc.m_width, _srcRow, _outImage, _rgb888);
   }
 
   void __attribute__((always_inline)) drawCornerHighlight(const int32_t _srcCol, const int32_t _srcRow, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
-
-    drawOutputPixelBound(_srcCol - 1, _srcRow - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol - 1, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol - 1, _srcRow + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol, _srcRow + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + 1, _srcRow - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + 1, _srcRow, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    drawOutputPixelBound(_srcCol + 1, _srcRow + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+    fillOutputBox(_srcCol - 1, _srcCol + 2, _srcRow - 1, _srcRow + 2, _outImage, _rgb888);
   }
 
+  // three pixels wide edges centered on the rectangle sides
   void __attribute__((always_inline)) drawOutputFatRectangle(const int32_t _x1, const int32_t _x2, const int32_t _y1, const int32_t _y2,
     const ImageBuffer& _outImage, const uint32_t _rgb888) const {
-    const int32_t widthBot = 0;
-    const int32_t widthTop = m_inImageDesc.m_width - 1;
-    const int32_t heightBot = 0;
-    const int32_t heightTop = m_inImageDesc.m_height - 1;
-
-    for (int32_t c = _x1; c < _x2; c++) {
-      drawOutputPixelBound(c, _y1 - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(c, _y1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(c, _y1 + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-
-      drawOutputPixelBound(c, _y2 - 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(c, _y2, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(c, _y2 + 1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+    if (m_drawList != NULL) {
+      appendDrawCommand(TRIK_DRAW_RECTANGLE, _x1, _y1, _x2, _y2, _rgb888, 3);
+      return;
     }
+    fillOutputBox(_x1, _x2, _y1 - 1, _y1 + 2, _outImage, _rgb888);
+    fillOutputBox(_x1, _x2, _y2 - 1, _y2 + 2, _outImage, _rgb888);
+    fillOutputBox(_x1 - 1, _x1 + 2, _y1, _y2, _outImage, _rgb888);
+    fillOutputBox(_x2 - 1, _x2 + 2, _y1, _y2, _outImage, _rgb888);
+  }
 
-    for (int32_t r = _y1; r < _y2; r++) {
-      drawOutputPixelBound(_x1 - 1, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_x1, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_x1 + 1, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-
-      drawOutputPixelBound(_x2 - 1, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_x2, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_x2 + 1, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+  void __attribute__((always_inline))
+  drawOutputRectangle(const int32_t _x1, const int32_t _x2, const int32_t _y1, const int32_t _y2, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    if (m_drawList != NULL) {
+      appendDrawCommand(TRIK_DRAW_RECTANGLE, _x1, _y1, _x2, _y2, _rgb888);
+      return;
     }
+    drawOutputHorizontalSpan(_x1, _x2, _y1, _outImage, _rgb888);
+    drawOutputHorizontalSpan(_x1, _x2, _y2, _outImage, _rgb888);
+    drawOutputVerticalSpan(_x1, _y1, _y2, _outImage, _rgb888);
+    drawOutputVerticalSpan(_x2, _y1, _y2, _outImage, _rgb888);
   }
 
   void __attribute__((always_inline))
-  drawOutputRectangle(const int32_t _x1, const int32_t _x2, const int32_t _y1, const int32_t _y2, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+  drawOutputLine(int32_t _x1, int32_t _y1, const int32_t _x2, const int32_t _y2, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    if (m_drawList != NULL) {
+      appendDrawCommand(TRIK_DRAW_LINE, _x1, _y1, _x2, _y2, _rgb888);
+      return;
+    }
     const int32_t widthBot = 0;
     const int32_t widthTop = m_inImageDesc.m_width - 1;
     const int32_t heightBot = 0;
     const int32_t heightTop = m_inImageDesc.m_height - 1;
 
-    for (int32_t c = _x1; c < _x2; c++) {
-      drawOutputPixelBound(c, _y1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(c, _y2, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-    }
-
-    for (int32_t r = _y1; r < _y2; r++) {
-      drawOutputPixelBound(_x1, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
-      drawOutputPixelBound(_x2, r, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+    const int32_t dx = _x2 > _x1 ? _x2 - _x1 : _x1 - _x2;
+    const int32_t dy = _y2 > _y1 ? _y1 - _y2 : _y2 - _y1;
+    const int32_t sx = _x1 < _x2 ? 1 : -1;
+    const int32_t sy = _y1 < _y2 ? 1 : -1;
+    int32_t lineError = dx + dy;
+
+    // Bresenham, both octant directions handled by the sign steps
+    while (true) {
+      drawOutputPixelBound(_x1, _y1, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+      if (_x1 == _x2 && _y1 == _y2)
+        break;
+      const int32_t lineError2 = 2 * lineError;
+      if (lineError2 >= dy) {
+        lineError += dy;
+        _x1 += sx;
+      }
+      if (lineError2 <= dx) {
+        lineError += dx;
+        _y1 += sy;
+      }
     }
   }
 
@@ -324,15 +440,381 @@ protected:
     return u32_hsv;
   }
 
+  void resetRois() {
+    m_rois[0].m_colBegin = 0;
+    m_rois[0].m_colEnd = m_inImageDesc.m_width;
+    m_rois[0].m_rowBegin = 0;
+    m_rois[0].m_rowEnd = m_inImageDesc.m_height;
+    m_roiCount = 1;
+    m_roiRowBegin = 0;
+    m_roiRowEnd = m_inImageDesc.m_height;
+    m_roiFullFrame = true;
+  }
+
+  /*
+   * ROIs come in full frame pixels, _pixelSize scales them down for images built of metapixels.
+   * Rectangles are snapped outwards to ROI_COL_ALIGN x ROI_ROW_ALIGN and clipped to the frame, empty ones are dropped.
+   * No ROIs left means the whole frame.
+   */
+  void setupRois(const trik_cv_algorithm_in_args& _inArgs, const uint32_t _pixelSize = 1) {
+    const uint32_t width = m_inImageDesc.m_width * _pixelSize;
+    const uint32_t height = m_inImageDesc.m_height * _pixelSize;
+    const uint32_t count = _inArgs.roi_count < TRIK_MAX_ROIS ? _inArgs.roi_count : TRIK_MAX_ROIS;
+
+    m_roiCount = 0;
+    m_roiRowBegin = m_inImageDesc.m_height;
+    m_roiRowEnd = 0;
+    m_roiFullFrame = false;
+    for (uint32_t i = 0; i < count; ++i) {
+      const trik_cv_algorithm_roi& roi = _inArgs.rois[i];
+      const uint32_t colBegin = roi.x & ~(ROI_COL_ALIGN - 1);
+      const uint32_t colEnd = (roi.x + roi.width + ROI_COL_ALIGN - 1) & ~(ROI_COL_ALIGN - 1);
+      const uint32_t rowBegin = roi.y & ~(ROI_ROW_ALIGN - 1);
+      const uint32_t rowEnd = (roi.y + roi.height + ROI_ROW_ALIGN - 1) & ~(ROI_ROW_ALIGN - 1);
+
+      RoiRect rect;
+      rect.m_colBegin = colBegin / _pixelSize;
+      rect.m_colEnd = (colEnd < width ? colEnd : width) / _pixelSize;
+      rect.m_rowBegin = rowBegin / _pixelSize;
+      rect.m_rowEnd = (rowEnd < height ? rowEnd : height) / _pixelSize;
+      if (roi.width == 0 || roi.height == 0 || rect.m_colBegin >= rect.m_colEnd || rect.m_rowBegin >= rect.m_rowEnd)
+        continue;
+
+      uint32_t slot = m_roiCount++;
+      for (; slot > 0 && m_rois[slot - 1].m_colBegin > rect.m_colBegin; --slot)
+        m_rois[slot] = m_rois[slot - 1];
+      m_rois[slot] = rect;
+
+      m_roiRowBegin = rect.m_rowBegin < m_roiRowBegin ? rect.m_rowBegin : m_roiRowBegin;
+      m_roiRowEnd = rect.m_rowEnd > m_roiRowEnd ? rect.m_rowEnd : m_roiRowEnd;
+    }
+
+    if (m_roiCount == 0)
+      resetRois();
+  }
+
+  // column spans of _row covered by ROIs, overlapping ROIs are merged so every pixel is visited once
+  uint32_t roiRowSpans(const uint32_t _row, RoiSpan* _spans) const {
+    uint32_t spans = 0;
+    for (uint32_t i = 0; i < m_roiCount; ++i) {
+      const RoiRect& roi = m_rois[i];
+      if (_row < roi.m_rowBegin || _row >= roi.m_rowEnd)
+        continue;
+      if (spans > 0 && roi.m_colBegin <= _spans[spans - 1].m_end) {
+        if (roi.m_colEnd > _spans[spans - 1].m_end)
+          _spans[spans - 1].m_end = roi.m_colEnd;
+      } else {
+        _spans[spans].m_begin = roi.m_colBegin;
+        _spans[spans].m_end = roi.m_colEnd;
+        ++spans;
+      }
+    }
+    return spans;
+  }
+
+  bool insideRois(const uint32_t _col, const uint32_t _row) const {
+    for (uint32_t i = 0; i < m_roiCount; ++i) {
+      const RoiRect& roi = m_rois[i];
+      if (_col >= roi.m_colBegin && _col < roi.m_colEnd && _row >= roi.m_rowBegin && _row < roi.m_rowEnd)
+        return true;
+    }
+    return false;
+  }
+
+  // zeroes an 8-bit full frame plane outside of the ROIs
+  void clearOutsideRois(uint8_t* restrict _plane) const {
+    if (m_roiFullFrame)
+      return;
+
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint32_t height = m_inImageDesc.m_height;
+    RoiSpan spans[TRIK_MAX_ROIS];
+    for (uint32_t row = 0; row < height; ++row) {
+      uint8_t* restrict planeRow = _plane + row * width;
+      const uint32_t spanCount = row >= m_roiRowBegin && row < m_roiRowEnd ? roiRowSpans(row, spans) : 0;
+      uint32_t col = 0;
+      for (uint32_t span = 0; span < spanCount; ++span) {
+        memset(planeRow + col, 0, spans[span].m_begin - col);
+        col = spans[span].m_end;
+      }
+      memset(planeRow + col, 0, width - col);
+    }
+  }
+
+  void drawRois(const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    if (m_roiFullFrame)
+      return;
+    for (uint32_t i = 0; i < m_roiCount; ++i)
+      drawOutputRectangle(m_rois[i].m_colBegin, m_rois[i].m_colEnd - 1, m_rois[i].m_rowBegin, m_rois[i].m_rowEnd - 1, _outImage, _rgb888);
+  }
+
+  /*
+   * Preview background of every sensor, planes demuxed by convertImageYuyvToPlanar go through IMG_ycbcr422pl_to_rgb565
+   * straight into the output rows. Sensors draw their detections over it afterwards. A reduced preview takes every
+   * n-th pixel of every n-th row, n is even, so every output pixel pair keeps the chroma of the source pair it starts at.
+   */
+  uint32_t previewStep() const { return m_inImageDesc.m_width / m_outImageDesc.m_width; }
+
+  // later sensors of a set draw over the background the first one rendered, sensors demuxing chroma for it ask first
+  bool previewBackgroundPending() const { return s_previewFrame != s_frame; }
+
+  void renderPreviewRow(const uint32_t _row, const ImageBuffer& _outImage) const {
+    IMG_ycbcr422pl_to_rgb565(s_coeff_pv, s_rowLuma_pv, s_rowCb_pv, s_rowCr_pv,
+      reinterpret_cast<unsigned short*>(_outImage.m_ptr + _row * m_outImageDesc.m_lineLength), m_outImageDesc.m_width);
+  }
+
+  void renderPreviewPlanes(const uint8_t* restrict _luma, const uint8_t* restrict _cb, const uint8_t* restrict _cr, const ImageBuffer& _outImage,
+    trik_cv_algorithm_out_cycles& _cycles) const {
+    if (!previewBackgroundPending())
+      return;
+    s_previewFrame = s_frame;
+    const uint32_t startTime = Timestamp_get32();
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint32_t height = m_inImageDesc.m_height;
+    const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
+    const uint32_t step = previewStep();
+
+    // full frame output rows follow each other, binned ones are a half row apart
+    if (step == 1 && dstLineLength == width * sizeof(uint16_t))
+      IMG_ycbcr422pl_to_rgb565(s_coeff_pv, _luma, _cb, _cr, reinterpret_cast<unsigned short*>(_outImage.m_ptr), width * height);
+    else if (step == 1)
+      for (uint32_t row = 0; row < height; ++row)
+        IMG_ycbcr422pl_to_rgb565(s_coeff_pv, _luma + row * width, _cb + row * width / 2, _cr + row * width / 2,
+          reinterpret_cast<unsigned short*>(_outImage.m_ptr + row * dstLineLength), width);
+    else
+      for (uint32_t row = 0; row < m_outImageDesc.m_height; ++row) {
+        const uint8_t* restrict lumaRow = _luma + row * step * width;
+        const uint8_t* restrict cbRow = _cb + row * step * width / 2;
+        const uint8_t* restrict crRow = _cr + row * step * width / 2;
+#pragma MUST_ITERATE(4, , 4)
+        for (uint32_t pair = 0; pair < m_outImageDesc.m_width / 2; ++pair) {
+          s_rowLuma_pv[2 * pair + 0] = lumaRow[2 * pair * step];
+          s_rowLuma_pv[2 * pair + 1] = lumaRow[(2 * pair + 1) * step];
+          s_rowCb_pv[pair] = cbRow[pair * step];
+          s_rowCr_pv[pair] = crRow[pair * step];
+        }
+        renderPreviewRow(row, _outImage);
+      }
+    _cycles.preview += Timestamp_get32() - startTime;
+  }
+
+  // a reduced preview is gathered straight from the yuyv rows it samples, the rest of the frame is never demuxed
+  void renderPreviewBackground(const ImageBuffer& _inImage, const ImageBuffer& _outImage, trik_cv_algorithm_out_cycles& _cycles) const {
+    if (!previewBackgroundPending())
+      return;
+    const uint32_t startTime = Timestamp_get32();
+    const uint32_t step = previewStep();
+    if (step == 1) {
+      convertImageYuyvToPlanar(_inImage, s_luma_pv, s_cb_pv, s_cr_pv);
+      _cycles.preview += Timestamp_get32() - startTime;
+      renderPreviewPlanes(s_luma_pv, s_cb_pv, s_cr_pv, _outImage, _cycles);
+      return;
+    }
+
+    s_previewFrame = s_frame;
+    for (uint32_t row = 0; row < m_outImageDesc.m_height; ++row) {
+      const uint8_t* restrict yuyvRow = reinterpret_cast<const uint8_t*>(_inImage.m_ptr + row * step * m_inImageDesc.m_lineLength);
+#pragma MUST_ITERATE(4, , 4)
+      for (uint32_t pair = 0; pair < m_outImageDesc.m_width / 2; ++pair) {
+        const uint8_t* restrict yuyv = yuyvRow + 4 * pair * step;
+        s_rowLuma_pv[2 * pair + 0] = yuyv[0];
+        s_rowLuma_pv[2 * pair + 1] = yuyv[2 * step];
+        s_rowCb_pv[pair] = yuyv[1];
+        s_rowCr_pv[pair] = yuyv[3];
+      }
+      renderPreviewRow(row, _outImage);
+    }
+    _cycles.preview += Timestamp_get32() - startTime;
+  }
+
+  /*
+   * Overlay-only previews start from a black frame, nothing else is drawn where the camera frame would be, draw lists
+   * leave the output buffer alone. Sensors of a set share the preview, so only the first one clears it.
+   */
+  void setupPreview(const trik_cv_algorithm_in_args& _inArgs, const ImageBuffer& _outImage) {
+    m_drawList = _inArgs.preview == TRIK_PREVIEW_DRAW_LIST ? s_drawList : NULL;
+    m_previewImage = _inArgs.preview == TRIK_PREVIEW_FULL;
+    m_previewOverlay = _inArgs.preview != TRIK_PREVIEW_NONE && (_inArgs.preview != TRIK_PREVIEW_DRAW_LIST || m_drawList != NULL);
+    if (m_previewImage || !m_previewOverlay || m_drawList != NULL || !previewBackgroundPending())
+      return;
+    s_previewFrame = s_frame;
+    const uint32_t rowBytes = m_outImageDesc.m_width * sizeof(uint16_t);
+    for (uint32_t row = 0; row < m_outImageDesc.m_height; ++row)
+      memset(_outImage.m_ptr + row * m_outImageDesc.m_lineLength, 0, rowBytes);
+  }
+
+  void resetSampling() {
+    m_sampleStride = 1;
+    m_samplePhase = 0;
+    m_sampleCheckerboard = false;
+  }
+
+  void setupSampling(const trik_cv_algorithm_in_args& _inArgs) {
+    m_sampleStride = _inArgs.sample_stride == 0 ? 1 : range<uint32_t>(1, _inArgs.sample_stride, SAMPLE_MAX_STRIDE);
+    m_sampleCheckerboard = _inArgs.sample_checkerboard;
+    m_samplePhase = ++m_sampleFrame % m_sampleStride;
+  }
+
+  bool isSampledRow(const uint32_t _row) const { return _row % m_sampleStride == m_samplePhase; }
+
+  uint32_t firstSampledRow(const uint32_t _row) const { return _row + (m_samplePhase + m_sampleStride - _row % m_sampleStride) % m_sampleStride; }
+
+  // column offset of the processed pixel pair in every group of four, for checkerboard sampling
+  uint32_t samplePairOffset(const uint32_t _row) const { return ((_row / m_sampleStride + m_sampleFrame) & 1) * 2; }
+
+  // scales a pixel count taken over the sampled rows of [_rowBegin, _rowEnd) up to an estimate for all pixels of these rows
+  uint32_t estimateFullCount(const uint32_t _count, const uint32_t _rowBegin, const uint32_t _rowEnd) const {
+    if (m_sampleStride == 1 && !m_sampleCheckerboard)
+      return _count;
+    const uint32_t first = firstSampledRow(_rowBegin);
+    const uint32_t sampledRows = first < _rowEnd ? (_rowEnd - first + m_sampleStride - 1) / m_sampleStride : 0;
+    if (sampledRows == 0)
+      return 0;
+    return (_count * (_rowEnd - _rowBegin) * (m_sampleCheckerboard ? 2 : 1)) / sampledRows;
+  }
+
+  void describeHsvCoverage(HsvCoverage& _coverage) const {
+    memset(&_coverage, 0, sizeof(_coverage));
+    for (uint32_t i = 0; i < m_roiCount; ++i)
+      _coverage.m_rois[i] = m_rois[i];
+    _coverage.m_roiCount = m_roiCount;
+    _coverage.m_sampleStride = m_sampleStride;
+    _coverage.m_samplePhase = m_samplePhase;
+    _coverage.m_pairPhase = m_sampleCheckerboard ? m_sampleFrame & 1 : 2;
+  }
+
+  // whole frames cover any request, ROIs and sampling are compared as they are
+  bool hsvConverted(const HsvCoverage& _coverage) const {
+    if (s_hsvFrame != s_frame)
+      return false;
+    const RoiRect& roi = s_hsvCoverage.m_rois[0];
+    if (s_hsvCoverage.m_roiCount == 1 && roi.m_colBegin == 0 && roi.m_colEnd == m_inImageDesc.m_width && roi.m_rowBegin == 0 &&
+        roi.m_rowEnd == m_inImageDesc.m_height && s_hsvCoverage.m_sampleStride == 1 && s_hsvCoverage.m_pairPhase == 2)
+      return true;
+    return memcmp(&s_hsvCoverage, &_coverage, sizeof(_coverage)) == 0;
+  }
+
+  /*
+   * Converts sampled ROI pixels only, the rest of s_rgb888hsv keeps whatever an earlier frame left there. Sensors of a
+   * set asking for pixels of the frame which are converted already, same ROIs and sampling or the whole frame, skip it.
+   */
   void convertImageYuyvToHsv(const ImageBuffer& _inImage) {
-    uint32_t* restrict src = (uint32_t*) _inImage.m_ptr;
-    uint64_t* restrict dst = s_rgb888hsv;
+    HsvCoverage coverage;
+    describeHsvCoverage(coverage);
+    if (hsvConverted(coverage))
+      return;
+    s_hsvFrame = s_frame;
+    s_hsvCoverage = coverage;
+
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint32_t srcLineLength = m_inImageDesc.m_lineLength;
+    const uint32_t colStep = m_sampleCheckerboard ? 4 : 2;
+    RoiSpan spans[TRIK_MAX_ROIS];
+    for (uint32_t row = firstSampledRow(m_roiRowBegin); row < m_roiRowEnd; row += m_sampleStride) {
+      const uint32_t spanCount = roiRowSpans(row, spans);
+      const uint32_t pairOffset = m_sampleCheckerboard ? samplePairOffset(row) : 0;
+      for (uint32_t span = 0; span < spanCount; ++span) {
+        const uint32_t colBegin = spans[span].m_begin + pairOffset;
+        const uint32_t* restrict src = reinterpret_cast<const uint32_t*>(_inImage.m_ptr + row * srcLineLength) + colBegin / 2;
+        uint64_t* restrict dst = s_rgb888hsv + row * width + colBegin;
+#pragma MUST_ITERATE(2, , 2)
+        for (uint32_t col = colBegin; col < spans[span].m_end; col += colStep) {
+          const uint64_t rgb = convert2xYuyvToRgb888(*src);
+          dst[0] = _itoll(_loll(rgb), convertRgb888ToHsv(_loll(rgb)));
+          dst[1] = _itoll(_hill(rgb), convertRgb888ToHsv(_hill(rgb)));
+          src += colStep / 2;
+          dst += colStep;
+        }
+      }
+    }
+  }
+
+  /*
+   * HSV range detection over the ROI spans of a row converted by convertImageYuyvToHsv. Results are packed into
+   * _mask, bit i of word w for column 32 * w + i, and with _preview detected pixels are highlighted over the preview
+   * background.
+   */
+  template <bool _preview>
+  void detectHsvRow(const ImageBuffer& _outImage, const uint32_t _srcRow, const RoiSpan* _spans, const uint32_t _spanCount, const uint64_t _hsvRange,
+    const uint32_t _hsvExpect, uint32_t* restrict _mask) const {
+    const uint32_t width = m_inImageDesc.m_width;
+    uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + s_hi2ho[_srcRow] * m_outImageDesc.m_lineLength);
+    memset(_mask, 0, (width / 32) * sizeof(uint32_t));
+
+    const uint32_t pairOffset = samplePairOffset(_srcRow);
+    for (uint32_t span = 0; span < _spanCount && m_sampleCheckerboard; ++span) {
+      // both pixels of the sampled pair are drawn over the skipped pair next to them too
+#pragma MUST_ITERATE(2, , 2)
+      for (uint32_t srcCol = _spans[span].m_begin + pairOffset; srcCol < _spans[span].m_end; srcCol += 4) {
+        const uint64_t* restrict rgb888hsvptr = s_rgb888hsv + _srcRow * width + srcCol;
+        uint32_t bits = 0;
+        for (uint32_t pix = 0; pix < 2; ++pix) {
+          const uint64_t rgb888hsv = rgb888hsvptr[pix];
+          const bool det = detectHsvPixel(_loll(rgb888hsv), _hsvRange, _hsvExpect);
+          bits |= det << pix;
+          if (_preview && det) {
+            writeOutputPixel(dstImageRow + s_wi2wo[srcCol + pix], 0x00ffff);
+            writeOutputPixel(dstImageRow + s_wi2wo[(srcCol + pix) ^ 2], 0x00ffff);
+          }
+        }
+        _mask[srcCol / 32] |= bits << (srcCol % 32);
+      }
+    }
+
+    for (uint32_t span = 0; span < _spanCount && !m_sampleCheckerboard; ++span) {
+      const uint64_t* restrict rgb888hsvptr = s_rgb888hsv + _srcRow * width + _spans[span].m_begin;
+      const uint32_t* restrict p_wi2wo = s_wi2wo + _spans[span].m_begin;
+      assert(_spans[span].m_begin % ROI_COL_ALIGN == 0 && _spans[span].m_end % ROI_COL_ALIGN == 0); // snapped in setupRois
+#pragma MUST_ITERATE(1, , 1)
+      for (uint32_t srcCol = _spans[span].m_begin; srcCol < _spans[span].m_end; srcCol += 8) {
+        uint32_t bits = 0;
+#pragma MUST_ITERATE(8, 8)
+        for (uint32_t pix = 0; pix < 8; ++pix) {
+          const uint64_t rgb888hsv = rgb888hsvptr[pix];
+          const bool det = detectHsvPixel(_loll(rgb888hsv), _hsvRange, _hsvExpect);
+          bits |= det << pix;
+          if (_preview && det)
+            writeOutputPixel(dstImageRow + p_wi2wo[pix], 0x00ffff);
+        }
+        _mask[srcCol / 32] |= bits << (srcCol % 32);
+        rgb888hsvptr += 8;
+        p_wi2wo += 8;
+      }
+    }
+  }
+
+  void convertImageYuyvToLuma(const ImageBuffer& _inImage, uint8_t* restrict _luma) const {
+    const uint64_t* restrict src = reinterpret_cast<const uint64_t*>(_inImage.m_ptr);
+    uint32_t* restrict dst = reinterpret_cast<uint32_t*>(_luma);
+    const uint32_t pixels = m_inImageDesc.m_width * m_inImageDesc.m_height;
+
+    // Y0 U Y1 V Y2 U Y3 V -> Y0 Y1 Y2 Y3, four pixels per iteration
+    assert(pixels % 32 == 0); // verified in setup
+#pragma MUST_ITERATE(8, , 8)
+    for (uint32_t pix = 0; pix < pixels; pix += 4) {
+      const uint64_t yuyv = *src++;
+      *dst++ = _packl4(_hill(yuyv), _loll(yuyv));
+    }
+  }
+
+  void convertImageYuyvToPlanar(const ImageBuffer& _inImage, uint8_t* restrict _luma, uint8_t* restrict _cb, uint8_t* restrict _cr) const {
+    const uint64_t* restrict src = reinterpret_cast<const uint64_t*>(_inImage.m_ptr);
+    uint64_t* restrict dstY = reinterpret_cast<uint64_t*>(_luma);
+    uint32_t* restrict dstCb = reinterpret_cast<uint32_t*>(_cb);
+    uint32_t* restrict dstCr = reinterpret_cast<uint32_t*>(_cr);
+    const uint32_t pixels = m_inImageDesc.m_width * m_inImageDesc.m_height;
+
+    // Y U Y V x4 -> Y x8, U x4, V x4, eight pixels per iteration
+    assert(pixels % 32 == 0); // verified in setup
 #pragma MUST_ITERATE(4, , 4)
-    while ((uint8_t*) src < ((uint8_t*) _inImage.m_ptr) + m_inImageDesc.m_width * m_inImageDesc.m_height * 2) {
-      const uint64_t rgb = convert2xYuyvToRgb888(*src);
-      *dst++ = _itoll(_loll(rgb), convertRgb888ToHsv(_loll(rgb)));
-      *dst++ = _itoll(_hill(rgb), convertRgb888ToHsv(_hill(rgb)));
-      src++;
+    for (uint32_t pix = 0; pix < pixels; pix += 8) {
+      const uint64_t yuyv1 = *src++;
+      const uint64_t yuyv2 = *src++;
+      *dstY++ = _itoll(_packl4(_hill(yuyv2), _loll(yuyv2)), _packl4(_hill(yuyv1), _loll(yuyv1)));
+      const uint32_t vu1 = _packh4(_hill(yuyv1), _loll(yuyv1));
+      const uint32_t vu2 = _packh4(_hill(yuyv2), _loll(yuyv2));
+      *dstCb++ = _packl4(vu2, vu1);
+      *dstCr++ = _packh4(vu2, vu1);
     }
   }
 
@@ -342,6 +824,15 @@ protected:
 
     if (m_inImageDesc.m_width % 32 != 0 || m_inImageDesc.m_height % 4 != 0)
       return false;
+    // the preview is the frame or every n-th pixel of every n-th row of it, output rows are converted in groups of eight pixels
+    if (m_outImageDesc.m_width == 0 || m_outImageDesc.m_width % 8 != 0)
+      return false;
+    const uint32_t step = previewStep();
+    if (m_outImageDesc.m_width * step != m_inImageDesc.m_width || m_outImageDesc.m_height * step != m_inImageDesc.m_height || (step != 1 && step % 2 != 0))
+      return false;
+    resetRois();
+    resetSampling();
+    m_sampleFrame = 0;
 
 #define min(x, y) x < y ? x : y;
     const double srcToDstShift =
@@ -379,9 +870,25 @@ protected:
     return true;
   }
 
-  CvAlgorithm() {}
+  CvAlgorithm()
+    : m_roiCount(0)
+    , m_roiRowBegin(0)
+    , m_roiRowEnd(0)
+    , m_roiFullFrame(true)
+    , m_sampleStride(1)
+    , m_samplePhase(0)
+    , m_sampleFrame(0)
+    , m_sampleCheckerboard(false)
+    , m_previewImage(true)
+    , m_previewOverlay(true)
+    , m_drawList(NULL) {}
 };
 
+trik_cv_algorithm_draw_list* CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_drawList = NULL;
+uint32_t CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_frame = 0;
+uint32_t CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_previewFrame = 0;
+uint32_t CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_hsvFrame = 0;
+CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::HsvCoverage CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_hsvCoverage;
 uint64_t restrict CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_rgb888hsv[IMG_WIDTH * IMG_HEIGHT];
 uint32_t restrict CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_wi2wo[IMG_WIDTH];
 uint32_t restrict CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_hi2ho[IMG_HEIGHT];
@@ -391,9 +898,13 @@ uint16_t* restrict CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::s_mul
 }
 }
 
+#include "binning.hpp"
 #include "edge_line_sensor.hpp"
+#include "frame_change_detector.hpp"
+#include "lane_sensor.hpp"
 #include "line_sensor.hpp"
 #include "motion_sensor.hpp"
+#include "motion_vector_sensor.hpp"
 #include "mxn_sensor.hpp"
 #include "object_sensor.hpp"
 
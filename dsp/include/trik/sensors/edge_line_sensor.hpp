@@ -21,33 +21,31 @@
 #include <cassert>
 #include <cmath>
 
+#include "canny_edges.hpp"
+#include "harris_corners.hpp"
+#include "hough_lines.hpp"
+#include "lens_undistortion.hpp"
+
 extern "C" {
-#include <ti/imglib/src/IMG_sobel_3x3_8/IMG_sobel_3x3_8.h>
-#include <ti/imglib/src/IMG_thr_gt2max_8/IMG_thr_gt2max_8.h>
-#include <ti/imglib/src/IMG_ycbcr422pl_to_rgb565/IMG_ycbcr422pl_to_rgb565.h>
+#include <ti/imglib/src/IMG_histogram_8/IMG_histogram_8.h>
 }
 
 namespace trik {
 namespace sensors {
 
-static uint8_t s_y[320 * 240];
-static uint8_t s_y2[320 * 240];
-static uint8_t s_cb[320 * 240];
-static uint8_t s_cr[320 * 240];
+static uint8_t s_y[320 * 240] __attribute__((aligned(8)));
+static uint8_t s_mag_el[320 * 240] __attribute__((aligned(8)));
+static uint8_t s_y2[320 * 240] __attribute__((aligned(8)));
 
 static uint32_t s_wi2wo[640];
 static uint32_t s_hi2ho[480];
 
-static int16_t s_xGrad[320 * 240 + 1];
-static int16_t s_yGrad[320 * 240 + 1];
-static int16_t s_gradMag[320 * 240 + 1];
-static uint16_t s_harrisScore_el[320 * 240];
-
-static int8_t s_corners_el[320 * 240];
+#define EL_HISTOGRAM_CHUNK (64 * 320) // keeps IMG_histogram_8 16-bit bins from saturating
+#define EL_MIN_THRESHOLD 20           // Otsu splits sensor noise on edgeless frames, never go below it
 
-static uint8_t s_buffer_el[200]; // 200
-
-static const short s_coeff_el[5] = { 0x2000, 0x2BDD, -0x0AC5, -0x1658, 0x3770 };
+static int16_t s_histTemp_el[1024] __attribute__((aligned(8)));
+static int16_t s_histChunk_el[256] __attribute__((aligned(8)));
+static uint32_t s_hist_el[256];
 
 class EdgeLineSensorCvAlgorithm : public CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X> {
 private:
@@ -79,37 +77,77 @@ private:
   int32_t m_targetX;
   int32_t m_targetY;
   uint32_t m_targetPoints;
+  uint32_t m_threshold;
+
+  CannyEdgeDetector m_canny;
+  HoughLineDetector m_hough;
+  HarrisCornerDetector m_harris;
+  LensUndistortion m_lens;
+
+  uint32_t otsuThreshold(const uint8_t* restrict _img, const uint32_t _pixels) const {
+    memset(s_hist_el, 0, sizeof(s_hist_el));
+    for (uint32_t pix = 0; pix < _pixels; pix += EL_HISTOGRAM_CHUNK) {
+      const uint32_t chunk = _pixels - pix < EL_HISTOGRAM_CHUNK ? _pixels - pix : EL_HISTOGRAM_CHUNK;
+      memset(s_histTemp_el, 0, sizeof(s_histTemp_el));
+      memset(s_histChunk_el, 0, sizeof(s_histChunk_el));
+      IMG_histogram_8(_img + pix, chunk, 1, s_histTemp_el, s_histChunk_el);
+#pragma MUST_ITERATE(256, 256, 256)
+      for (uint32_t bin = 0; bin < 256; ++bin)
+        s_hist_el[bin] += static_cast<uint16_t>(s_histChunk_el[bin]);
+    }
+
+    uint32_t sumAll = 0;
+    for (uint32_t bin = 0; bin < 256; ++bin)
+      sumAll += bin * s_hist_el[bin];
+
+    // maximize between-class variance wB*wF*(mB-mF)^2, class means in Q4
+    uint32_t weightB = 0;
+    uint32_t sumB = 0;
+    uint64_t bestVariance = 0;
+    uint32_t bestThreshold = 0;
+    for (uint32_t bin = 0; bin < 255; ++bin) {
+      weightB += s_hist_el[bin];
+      sumB += bin * s_hist_el[bin];
+      const uint32_t weightF = _pixels - weightB;
+      if (weightB == 0)
+        continue;
+      if (weightF == 0)
+        break;
+
+      const int32_t meanDiff = static_cast<int32_t>(((sumAll - sumB) << 4) / weightF) - static_cast<int32_t>((sumB << 4) / weightB);
+      const uint64_t variance = static_cast<uint64_t>(weightB) * weightF * static_cast<uint64_t>(meanDiff * meanDiff);
+      if (variance > bestVariance) {
+        bestVariance = variance;
+        bestThreshold = bin;
+      }
+    }
+
+    return bestThreshold < EL_MIN_THRESHOLD ? EL_MIN_THRESHOLD : bestThreshold;
+  }
 
-  void convertImageYuyvToRgb(const ImageBuffer& _inImage, ImageBuffer& _outImage) {
+  void convertImageYuyvToRgb(const ImageBuffer& _inImage, ImageBuffer& _outImage, const bool _preview, const bool _detectCorners,
+    trik_cv_algorithm_out_edge_line& _edgeLine, trik_cv_algorithm_out_cycles& _cycles) {
     const uint32_t width = m_inImageDesc.m_width;
     const uint32_t height = m_inImageDesc.m_height;
-    const uint32_t imgSize = width * height;
 
     uint16_t targetPointsPerRow;
     uint16_t targetPointsCol;
 
-    // separate Cb Cr
-    uint8_t* restrict y2 = reinterpret_cast<uint8_t*>(s_y2);
-    uint8_t* restrict cb = reinterpret_cast<uint8_t*>(s_cb);
-    uint8_t* restrict cr = reinterpret_cast<uint8_t*>(s_cr);
-    const uint8_t* restrict CbCr = reinterpret_cast<const uint8_t*>(_inImage.m_ptr);
-    for (int i = 0; i < imgSize / 2; i++) {
-      *(y2++) = *CbCr;
-      CbCr++;
-      *(cb++) = *CbCr;
-      CbCr++;
-      *(y2++) = *CbCr;
-      CbCr++;
-      *(cr++) = *CbCr;
-      CbCr++;
-    }
+    // Sobel needs luma only, chroma is demuxed just for the preview
+    if (_preview)
+      convertImageYuyvToPlanar(_inImage, s_y2, s_cb_pv, s_cr_pv);
+    else
+      convertImageYuyvToLuma(_inImage, s_y2);
 
-    // Sobel edge detection
-    const unsigned char* restrict y_in_sobel = reinterpret_cast<const unsigned char*>(s_y2);
-    unsigned char* restrict sobel_out = reinterpret_cast<unsigned char*>(s_y);
-    IMG_sobel_3x3_8(y_in_sobel, sobel_out, width, height);
+    // Sobel edge detection thinned to one pixel wide edges, Otsu threshold picked on the raw magnitude drives hysteresis;
+    // the corner stage takes its structure tensor from the same gradient rows
+    HarrisCornerDetector* const corners = _detectCorners && m_harris.begin() ? &m_harris : NULL;
+    m_canny.suppress(s_y2, s_mag_el, s_y, corners);
+    m_threshold = otsuThreshold(s_mag_el, width * height);
+    m_canny.hysteresis(s_y, m_threshold / 2, m_threshold);
+    clearOutsideRois(s_y);
 
-    IMG_thr_gt2max_8(reinterpret_cast<const unsigned char*>(s_y), reinterpret_cast<unsigned char*>(s_y), width, height, 50);
+    m_hough.run(s_y, _edgeLine);
 
     // detect line
     const uint8_t* restrict sobelBin = reinterpret_cast<unsigned char*>(s_y);
@@ -132,56 +170,52 @@ private:
       m_targetPoints += targetPointsPerRow;
     }
 
-#ifdef CORNERS
-    // Harris corner detector
-    VLIB_xyGradientsAndMagnitude(reinterpret_cast<const uint8_t*>(_inImage.m_ptr), reinterpret_cast<int16_t*>(s_xGrad), reinterpret_cast<int16_t*>(s_yGrad),
-      reinterpret_cast<int16_t*>(s_gradMag), width, height);
-
-    VLIB_harrisScore_7x7(reinterpret_cast<const int16_t*>(s_xGrad), reinterpret_cast<const int16_t*>(s_yGrad), width, height,
-      reinterpret_cast<int16_t*>(s_harrisScore_el), 1500, reinterpret_cast<uint8_t*>(s_buffer_el));
-
-    VLIB_nonMaxSuppress_7x7_S16(reinterpret_cast<const int16_t*>(s_harrisScore_el), width, height, 7000, reinterpret_cast<uint8_t*>(s_corners_el));
-#endif
-
-    // in_img to rgb565
-    const short* restrict coeff = s_coeff_el;
-    const unsigned char* restrict res_in = reinterpret_cast<const unsigned char*>(s_y);
-    const unsigned char* restrict cb_in = reinterpret_cast<const unsigned char*>(s_cb);
-    const unsigned char* restrict cr_in = reinterpret_cast<const unsigned char*>(s_cr);
-    unsigned short* rgb565_out = reinterpret_cast<unsigned short*>(s_gradMag);
-    IMG_ycbcr422pl_to_rgb565(coeff, res_in, cb_in, cr_in, rgb565_out, width * height);
+    if (_detectCorners) {
+      m_harris.finish(_edgeLine);
+      uint32_t corners = 0;
+      for (uint32_t i = 0; i < _edgeLine.corner_count; ++i)
+        if (insideRois(_edgeLine.corners[i].x, _edgeLine.corners[i].y))
+          _edgeLine.corners[corners++] = _edgeLine.corners[i];
+      _edgeLine.corner_count = corners;
+    } else
+      _edgeLine.corner_count = 0;
+
+    // the edge map stands in for luma, so edges show up over the frame colors
+    if (_preview)
+      renderPreviewPlanes(s_y, s_cb_pv, s_cr_pv, _outImage, _cycles);
+
+    if (m_previewOverlay)
+      for (uint32_t i = 0; i < _edgeLine.corner_count; ++i)
+        drawCornerHighlight(_edgeLine.corners[i].x, _edgeLine.corners[i].y, _outImage, 0xff0000);
+  }
 
-    // lets try scaling out // & highlight corners
-    const uint16_t* restrict imgRgb565ptr = reinterpret_cast<uint16_t*>(s_gradMag);
-    const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
-    const uint32_t* restrict p_hi2ho = s_hi2ho;
-    for (int r = 0; r < height; r++) {
-      const uint32_t dR = *(p_hi2ho++);
-      uint16_t* restrict dIR = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dR * dstLineLength);
-      const uint32_t* restrict p_wi2wo = s_wi2wo;
-#pragma MUST_ITERATE(2, , 2)
-      for (int c = 0; c < width; c++) {
-        const uint32_t dC = *(p_wi2wo++);
-        *(dIR + dC) = *(imgRgb565ptr++);
+  // clips the line to the frame, drawOutputLine would clamp anything outside onto the border
+  void drawHoughLine(const trik_cv_algorithm_out_hough_line& _line, const ImageBuffer& _outImage, const uint32_t _rgb888) const {
+    const float angle = (3.1415927f * _line.theta) / 180;
+    const float point[2] = { m_inImageDesc.m_width / 2 + _line.rho * std::cos(angle), m_inImageDesc.m_height / 2 + _line.rho * std::sin(angle) };
+    const float direction[2] = { -std::sin(angle), std::cos(angle) };
+    const float top[2] = { static_cast<float>(m_inImageDesc.m_width - 1), static_cast<float>(m_inImageDesc.m_height - 1) };
+
+    float tFrom = -static_cast<float>(m_inImageDesc.m_width + m_inImageDesc.m_height);
+    float tTo = -tFrom;
+    for (int axis = 0; axis < 2; ++axis) {
+      if (std::fabs(direction[axis]) < 1e-6f) {
+        if (point[axis] < 0 || point[axis] > top[axis])
+          return;
+        continue;
       }
+      const float t1 = -point[axis] / direction[axis];
+      const float t2 = (top[axis] - point[axis]) / direction[axis];
+      const float tLow = t1 < t2 ? t1 : t2;
+      const float tHigh = t1 < t2 ? t2 : t1;
+      tFrom = tLow > tFrom ? tLow : tFrom;
+      tTo = tHigh < tTo ? tHigh : tTo;
     }
+    if (tFrom > tTo)
+      return;
 
-#ifdef CORNERS
-    const uint8_t* restrict corners = reinterpret_cast<uint8_t*>(s_corners_el);
-    p_hi2ho = s_hi2ho;
-    for (int r = 0; r < height; r++) {
-      const uint32_t dR = *(p_hi2ho++);
-      uint16_t* dIR = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dR * dstLineLength);
-      const uint32_t* restrict p_wi2wo = s_wi2wo;
-      for (int c = 0; c < width; c++) {
-        const uint32_t dC = *(p_wi2wo++);
-        if (c > 5 && c < 315 && r > 5 && r < 235)
-          if (*corners != 0)
-            drawCornerHighlight(c, r, _outImage, 0xff0000);
-        corners++;
-      }
-    }
-#endif
+    drawOutputLine(point[0] + tFrom * direction[0], point[1] + tFrom * direction[1], point[0] + tTo * direction[0], point[1] + tTo * direction[1], _outImage,
+      _rgb888);
   }
 
   void proceedImageHsv(const ImageBuffer& _inImage, ImageBuffer& _outImage) {
@@ -225,6 +259,14 @@ public:
   virtual bool setup(const ImageDesc& _inImageDesc, const ImageDesc& _outImageDesc, int8_t* _fastRam, size_t _fastRamSize) {
     if (!commonSetup(_inImageDesc, _outImageDesc, _fastRam, _fastRamSize))
       return false;
+
+    if (!m_canny.setup(_inImageDesc))
+      return false;
+    if (!m_hough.setup(_inImageDesc))
+      Log_print0(Diags_INFO, "EdgeLineSensorCvAlgorithm::setup(): image is too large for the Hough stage, no lines will be reported");
+    if (!m_harris.setup(_inImageDesc))
+      Log_print0(Diags_INFO, "EdgeLineSensorCvAlgorithm::setup(): image does not fit the corner stage, no corners will be reported");
+    m_lens.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
     return true;
   }
 
@@ -238,6 +280,7 @@ public:
     m_targetX = 0;
     m_targetY = 0;
     m_targetPoints = 0;
+    m_threshold = 0;
 
     uint32_t detectValFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_from) * 255) / 100, 255); // scaling 0..100 to 0..255
     uint32_t detectValTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_to) * 255) / 100, 255);     // scaling 0..100 to 0..255
@@ -245,28 +288,53 @@ public:
     m_detectRange = _itoll((detectValFrom << 16) | (0 << 8) | 0, (detectValTo << 16) | (0 << 8) | 0);
     m_detectExpected = 0x0;
 
+    setupRois(_inArgs);
+    setupPreview(_inArgs, _outImage);
+    m_lens.configure(_inArgs);
+
 #ifdef DEBUG_REPEAT
     for (unsigned repeat = 0; repeat < DEBUG_REPEAT; ++repeat) {
 #endif
       if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0)
-        convertImageYuyvToRgb(_inImage, _outImage);
+        convertImageYuyvToRgb(_inImage, _outImage, m_previewImage && previewBackgroundPending(), _inArgs.detect_corners, _outArgs.ext.edge_line, _outArgs.cycles);
 #ifdef DEBUG_REPEAT
     } // repeat
 #endif
 
     int32_t drawY = m_inImageDesc.m_height / 2;
 
+    // corners are reported undistorted, those the lens moves outside of the frame are dropped, Hough lines stay in frame pixels
+    trik_cv_algorithm_out_edge_line& edgeLine = _outArgs.ext.edge_line;
+    if (m_lens.enabled()) {
+      uint32_t corners = 0;
+      for (uint32_t i = 0; i < edgeLine.corner_count; ++i) {
+        int32_t col = edgeLine.corners[i].x;
+        int32_t row = edgeLine.corners[i].y;
+        m_lens.undistort(col, row);
+        if (col < 0 || row < 0 || col >= static_cast<int32_t>(m_inImageDesc.m_width) || row >= static_cast<int32_t>(m_inImageDesc.m_height))
+          continue;
+        edgeLine.corners[corners].x = col;
+        edgeLine.corners[corners].y = row;
+        ++corners;
+      }
+      edgeLine.corner_count = corners;
+    }
+
     if (m_targetPoints > 0) {
       const int32_t targetX = m_targetX / m_targetPoints;
       const int32_t targetY = m_targetY / m_targetPoints;
+      int32_t targetCol = targetX;
+      int32_t targetRow = targetY;
+      m_lens.undistort(targetCol, targetRow);
 
       assert(m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0); // more or less safe since no target points would be detected otherwise
       const uint32_t targetRadius = std::ceil(std::sqrt(static_cast<float>(m_targetPoints) / 3.1415927f));
 
-      drawRgbTargetCenterLine(targetX, drawY, _outImage, 0xff0000);
+      if (m_previewOverlay)
+        drawRgbTargetCenterLine(targetX, drawY, _outImage, 0xff0000);
 
-      _outArgs.targets[0].x = ((targetX - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width);
-      _outArgs.targets[0].y = ((targetY - static_cast<int32_t>(m_inImageDesc.m_height) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_height);
+      _outArgs.targets[0].x = range<int32_t>(-100, ((targetCol - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width), 100);
+      _outArgs.targets[0].y = range<int32_t>(-100, ((targetRow - static_cast<int32_t>(m_inImageDesc.m_height) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_height), 100);
       _outArgs.targets[0].size = static_cast<uint32_t>(targetRadius * 100 * 4) / static_cast<uint32_t>(m_inImageDesc.m_width + m_inImageDesc.m_height);
 
     } else {
@@ -274,6 +342,13 @@ public:
       _outArgs.targets[0].y = 0;
       _outArgs.targets[0].size = 0;
     }
+    _outArgs.ext.edge_line.threshold = m_threshold;
+
+    if (m_previewOverlay) {
+      for (uint32_t i = 0; i < _outArgs.ext.edge_line.line_count; ++i)
+        drawHoughLine(_outArgs.ext.edge_line.lines[i], _outImage, 0x00ff00);
+      drawRois(_outImage, 0xffff00);
+    }
 
     return true;
   }
@@ -0,0 +1,241 @@
+#ifndef TRIK_SENSORS_FLOOR_PROJECTION_HPP_
+#define TRIK_SENSORS_FLOOR_PROJECTION_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+
+#include "lens_undistortion.hpp"
+
+namespace trik {
+namespace sensors {
+
+#define FLOOR_DEN_ONE (1 << 14)     // homography denominator at the frame corner farthest from the horizon
+#define FLOOR_MAX_TERM (1 << 30)    // table terms beyond that mean a calibration far outside the int16 millimetre range
+#define FLOOR_IMAGE_UNIT IMG_WIDTH  // calibration pixels and millimetres are brought near 1 before solving
+#define FLOOR_FLOOR_UNIT 1000.0
+
+static int32_t s_cols_fp[IMG_WIDTH][4] __attribute__((aligned(8))); // x and y numerators and denominator terms of a column
+static int32_t s_rows_fp[IMG_HEIGHT][4] __attribute__((aligned(8)));
+
+/*
+ * Camera to floor homography from four calibration points. The homography is split into per column and per row
+ * terms of its numerators and denominator, so a point costs three additions and one division per coordinate and
+ * only detected points are ever projected. The tables cover the frame, terms of undistorted points a lens moved
+ * outside of it are worked out on the spot.
+ */
+class FloorProjection {
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+  bool m_valid;
+  trik_cv_algorithm_floor_calibration m_calibration;
+  trik_cv_algorithm_lens m_lens;
+  double m_h[9]; // homography with its denominator positive in front of the horizon and scaled to FLOOR_DEN_ONE
+  double m_colScale; // full frame pixels per sensor frame pixel
+  double m_rowScale;
+
+  // homography from full frame pixels to millimetres with h[8] = 1, false for degenerate calibrations
+  static bool solve(const double _u[4], const double _v[4], const trik_cv_algorithm_floor_calibration& _calibration, double _h[9]) {
+    // x = (h0 u + h1 v + h2) / (h6 u + h7 v + 1) and y alike give two rows per point
+    double a[8][9];
+    for (uint32_t i = 0; i < 4; ++i) {
+      const double u = _u[i] / FLOOR_IMAGE_UNIT;
+      const double v = _v[i] / FLOOR_IMAGE_UNIT;
+      const double x = _calibration.floor[i].x / FLOOR_FLOOR_UNIT;
+      const double y = _calibration.floor[i].y / FLOOR_FLOOR_UNIT;
+      const double rowX[9] = { u, v, 1, 0, 0, 0, -u * x, -v * x, x };
+      const double rowY[9] = { 0, 0, 0, u, v, 1, -u * y, -v * y, y };
+      memcpy(a[2 * i], rowX, sizeof(rowX));
+      memcpy(a[2 * i + 1], rowY, sizeof(rowY));
+    }
+
+    // Gauss-Jordan elimination with partial pivoting
+    for (uint32_t col = 0; col < 8; ++col) {
+      uint32_t pivot = col;
+      for (uint32_t row = col + 1; row < 8; ++row)
+        if (std::fabs(a[row][col]) > std::fabs(a[pivot][col]))
+          pivot = row;
+      if (std::fabs(a[pivot][col]) < 1e-9)
+        return false;
+      for (uint32_t k = 0; k < 9; ++k) {
+        const double t = a[col][k];
+        a[col][k] = a[pivot][k];
+        a[pivot][k] = t;
+      }
+      for (uint32_t row = 0; row < 8; ++row) {
+        if (row == col)
+          continue;
+        const double f = a[row][col] / a[col][col];
+        for (uint32_t k = col; k < 9; ++k)
+          a[row][k] -= f * a[col][k];
+      }
+    }
+
+    // back to pixels and millimetres
+    const double unit = FLOOR_FLOOR_UNIT / FLOOR_IMAGE_UNIT;
+    _h[0] = unit * a[0][8] / a[0][0];
+    _h[1] = unit * a[1][8] / a[1][1];
+    _h[2] = FLOOR_FLOOR_UNIT * a[2][8] / a[2][2];
+    _h[3] = unit * a[3][8] / a[3][3];
+    _h[4] = unit * a[4][8] / a[4][4];
+    _h[5] = FLOOR_FLOOR_UNIT * a[5][8] / a[5][5];
+    _h[6] = a[6][8] / a[6][6] / FLOOR_IMAGE_UNIT;
+    _h[7] = a[7][8] / a[7][7] / FLOOR_IMAGE_UNIT;
+    _h[8] = 1;
+    return true;
+  }
+
+  // with a lens the homography and its tables are over undistorted pixels
+  bool build() {
+    double u[4];
+    double v[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+      u[i] = m_calibration.image[i].x;
+      v[i] = m_calibration.image[i].y;
+      LensUndistortion::undistortFullFrame(m_lens, u[i], v[i]);
+    }
+    double h[9];
+    if (!solve(u, v, m_calibration, h))
+      return false;
+
+    // the calibration points lie in front of the horizon, so the denominator is made positive there
+    const double sign = h[6] * u[0] + h[7] * v[0] + h[8] < 0 ? -1 : 1;
+
+    // centers of the pixels of the sensor frame, which is a binned half of the full frame when binning is on
+    const double colScale = static_cast<double>(IMG_WIDTH) / m_width;
+    const double rowScale = static_cast<double>(IMG_HEIGHT) / m_height;
+    double maxDen = 0;
+    for (uint32_t corner = 0; corner < 4; ++corner) {
+      const double u = ((corner & 1 ? m_width - 1 : 0) + 0.5) * colScale - 0.5;
+      const double v = ((corner & 2 ? m_height - 1 : 0) + 0.5) * rowScale - 0.5;
+      const double den = std::fabs(h[6] * u + h[7] * v + h[8]);
+      maxDen = den > maxDen ? den : maxDen;
+    }
+    const double scale = sign * FLOOR_DEN_ONE / maxDen;
+    for (uint32_t k = 0; k < 9; ++k)
+      m_h[k] = h[k] * scale;
+    m_colScale = colScale;
+    m_rowScale = rowScale;
+
+    for (uint32_t col = 0; col < m_width; ++col)
+      if (!columnTerms(col, s_cols_fp[col]))
+        return false;
+    for (uint32_t row = 0; row < m_height; ++row)
+      if (!rowTerms(row, s_rows_fp[row]))
+        return false;
+    return true;
+  }
+
+  static bool roundTerms(const double _terms[3], int32_t* _result) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      if (std::fabs(_terms[k]) > FLOOR_MAX_TERM)
+        return false;
+      _result[k] = std::floor(_terms[k] + 0.5);
+    }
+    return true;
+  }
+
+  // x and y numerator and denominator terms of a sensor frame column or row, which may lie outside of the frame
+  bool columnTerms(const int32_t _col, int32_t* _terms) const {
+    const double u = (_col + 0.5) * m_colScale - 0.5;
+    const double terms[3] = { m_h[0] * u, m_h[3] * u, m_h[6] * u };
+    return roundTerms(terms, _terms);
+  }
+
+  bool rowTerms(const int32_t _row, int32_t* _terms) const {
+    const double v = (_row + 0.5) * m_rowScale - 0.5;
+    const double terms[3] = { m_h[1] * v + m_h[2], m_h[4] * v + m_h[5], m_h[7] * v + m_h[8] };
+    return roundTerms(terms, _terms);
+  }
+
+  static bool divide(const int64_t _num, const int64_t _den, int16_t& _result) {
+    // rounded to the nearest millimetre
+    const int64_t result = (2 * _num + (_num < 0 ? -_den : _den)) / (2 * _den);
+    if (result < -0x7fff || result > 0x7fff)
+      return false;
+    _result = result;
+    return true;
+  }
+
+public:
+  FloorProjection()
+    : m_width(0)
+    , m_height(0)
+    , m_valid(false)
+    , m_colScale(1)
+    , m_rowScale(1) {
+    memset(&m_calibration, 0, sizeof(m_calibration));
+    memset(&m_lens, 0, sizeof(m_lens));
+    memset(m_h, 0, sizeof(m_h));
+  }
+
+  void setup(const uint32_t _width, const uint32_t _height) {
+    m_width = _width;
+    m_height = _height;
+    m_valid = false;
+    memset(&m_calibration, 0, sizeof(m_calibration));
+    memset(&m_lens, 0, sizeof(m_lens));
+  }
+
+  // tables are rebuilt only when the calibration or the lens change, they are shared by all sensors of the frame size set up last
+  void configure(const trik_cv_algorithm_in_args& _inArgs) {
+    if (memcmp(&m_calibration, &_inArgs.floor, sizeof(m_calibration)) == 0 && memcmp(&m_lens, &_inArgs.lens, sizeof(m_lens)) == 0)
+      return;
+    m_calibration = _inArgs.floor;
+    m_lens = _inArgs.lens;
+    m_valid = build();
+  }
+
+  bool valid() const { return m_valid; }
+
+  // pixels are undistorted ones with a lens, false for pixels at or beyond the horizon and farther than the int16 millimetre range
+  bool project(const int32_t _col, const int32_t _row, trik_cv_algorithm_floor_point& _point) const {
+    if (!m_valid)
+      return false;
+    int32_t outsideCol[3];
+    int32_t outsideRow[3];
+    const int32_t* restrict col = outsideCol;
+    const int32_t* restrict row = outsideRow;
+    if (_col >= 0 && _col < static_cast<int32_t>(m_width))
+      col = s_cols_fp[_col];
+    else if (!columnTerms(_col, outsideCol))
+      return false;
+    if (_row >= 0 && _row < static_cast<int32_t>(m_height))
+      row = s_rows_fp[_row];
+    else if (!rowTerms(_row, outsideRow))
+      return false;
+    const int64_t den = static_cast<int64_t>(col[2]) + row[2];
+    if (den <= 0)
+      return false;
+    return divide(static_cast<int64_t>(col[0]) + row[0], den, _point.x) && divide(static_cast<int64_t>(col[1]) + row[1], den, _point.y);
+  }
+
+  void projectTarget(const uint32_t _target, const int32_t _col, const int32_t _row, trik_cv_algorithm_out_floor& _out) const {
+    trik_cv_algorithm_floor_point point;
+    if (!project(_col, _row, point))
+      return;
+    _out.targets[_target] = point;
+    _out.target_mask |= 1u << _target;
+  }
+
+  void projectPathPoint(const uint32_t _band, const int32_t _col, const int32_t _row, trik_cv_algorithm_out_floor& _out) const {
+    trik_cv_algorithm_floor_point point;
+    if (!project(_col, _row, point))
+      return;
+    _out.points[_band] = point;
+    _out.point_mask |= 1u << _band;
+  }
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TRIK_SENSORS_FRAME_CHANGE_DETECTOR_HPP_
+#define TRIK_SENSORS_FRAME_CHANGE_DETECTOR_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <stdint.h>
+
+#include <c6x.h>
+
+#include "image.hpp"
+
+namespace trik {
+namespace sensors {
+
+#define FCD_ROW_STEP 8 // only every 8th row is compared
+
+static uint32_t s_luma_fcd[2][(IMG_HEIGHT / FCD_ROW_STEP + 1) * IMG_WIDTH / 4]; // four packed luma bytes per word
+
+/*
+ * Cheap static scene test: mean absolute luma difference of sampled rows against the last frame which was reported as changed.
+ * Comparing against that reference rather than the previous frame keeps slow drifts from going unnoticed.
+ */
+class FrameChangeDetector {
+private:
+  uint32_t m_reference;
+  bool m_referenceValid;
+
+public:
+  FrameChangeDetector()
+    : m_reference(0)
+    , m_referenceValid(false) {}
+
+  void reset() { m_referenceValid = false; }
+
+  // _threshold is mean absolute luma difference in 1/16 of a level
+  bool changed(const ImageBuffer& _inImage, const ImageDesc& _inImageDesc, const uint32_t _threshold) {
+    const uint32_t width = _inImageDesc.m_width;
+    const uint32_t height = _inImageDesc.m_height;
+    if (width == 0 || height == 0 || width * height > IMG_WIDTH * IMG_HEIGHT || width % 4 != 0)
+      return true;
+
+    uint32_t* restrict luma = s_luma_fcd[m_reference ^ 1];
+    const uint32_t* restrict reference = s_luma_fcd[m_reference];
+    uint32_t sad = 0;
+    uint32_t samples = 0;
+
+    for (uint32_t row = 0; row < height; row += FCD_ROW_STEP) {
+      const uint64_t* restrict srcImage = reinterpret_cast<const uint64_t*>(_inImage.m_ptr + row * _inImageDesc.m_lineLength);
+#pragma MUST_ITERATE(1, , 1)
+      for (uint32_t col = 0; col < width; col += 4) {
+        const uint64_t yuyv2x = *srcImage++;
+        const uint32_t luma4 = _packl4(_hill(yuyv2x), _loll(yuyv2x));
+        sad += _dotpu4(_subabs4(luma4, *reference++), 0x01010101);
+        *luma++ = luma4;
+      }
+      samples += width;
+    }
+
+    if (m_referenceValid && sad * 16 < _threshold * samples)
+      return false;
+
+    m_reference ^= 1;
+    m_referenceValid = true;
+    return true;
+  }
+};
+
+}
+}
+
+#endif
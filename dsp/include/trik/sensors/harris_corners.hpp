@@ -0,0 +1,198 @@
+#ifndef TRIK_SENSORS_HARRIS_CORNERS_HPP_
+#define TRIK_SENSORS_HARRIS_CORNERS_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+
+#include "image.hpp"
+
+namespace trik {
+namespace sensors {
+
+#define HARRIS_RADIUS 2 // 5x5 box window
+#define HARRIS_WINDOW (2 * HARRIS_RADIUS + 1)
+#define HARRIS_K_Q10 41      // k = 0.04
+#define HARRIS_THRESHOLD 300 // response >> 16, about a 25 levels step corner
+#define HARRIS_TILE 40       // at most one corner per tile
+#define HARRIS_MAX_TILES 64
+
+static int32_t s_products_hc[3][IMG_WIDTH];               // Ix*Ix, Iy*Iy, Ix*Iy of one row, element i is column i + 1
+static int32_t s_boxRows_hc[3][HARRIS_WINDOW][IMG_WIDTH];           // horizontal box sums of the last rows, ring
+static int32_t s_boxCols_hc[3][IMG_WIDTH];                          // running vertical sums of s_boxRows_hc
+static int32_t s_scores_hc[3][IMG_WIDTH];                           // responses of the last rows, ring
+
+/*
+ * Fixed-point Harris detector streaming over Sobel gradient rows, so no full frame gradient or score maps are kept.
+ * The rows come from CannyEdgeDetector, which computes the same gradients for edges. The structure tensor is summed
+ * over a separable box window and non-maximum suppression keeps the strongest 3x3 local maximum of every tile.
+ */
+class HarrisCornerDetector {
+private:
+  struct Candidate {
+    int32_t score;
+    uint16_t x;
+    uint16_t y;
+  };
+
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_tileCols;
+  bool m_enabled;
+  Candidate m_tiles[HARRIS_MAX_TILES];
+
+  void productRow(const int16_t* restrict _gradX, const int16_t* restrict _gradY) const {
+    const uint32_t width = m_width;
+    int32_t* restrict xx = s_products_hc[0];
+    int32_t* restrict yy = s_products_hc[1];
+    int32_t* restrict xy = s_products_hc[2];
+    // Sobel output is up to +-1020, scaled to +-255 so that window sums stay within 32 bits
+#pragma MUST_ITERATE(2, , 2)
+    for (uint32_t i = 0; i < width - 2; ++i) {
+      const int32_t gx = _gradX[i] >> 2;
+      const int32_t gy = _gradY[i] >> 2;
+      xx[i] = gx * gx;
+      yy[i] = gy * gy;
+      xy[i] = gx * gy;
+    }
+  }
+
+  void boxRow(const uint32_t _row) const {
+    const uint32_t width = m_width;
+    const uint32_t slot = _row % HARRIS_WINDOW;
+    for (uint32_t product = 0; product < 3; ++product) {
+      const int32_t* restrict src = s_products_hc[product];
+      int32_t* restrict boxRow = s_boxRows_hc[product][slot];
+      int32_t* restrict boxCol = s_boxCols_hc[product];
+
+      int32_t sum = 0;
+      for (uint32_t i = 0; i < HARRIS_WINDOW; ++i)
+        sum += src[i];
+
+      // column x = i + 1 is the window center
+      for (uint32_t i = HARRIS_RADIUS;; ++i) {
+        const uint32_t x = i + 1;
+        boxCol[x] += sum - boxRow[x];
+        boxRow[x] = sum;
+        if (i + HARRIS_RADIUS + 1 >= width - 2)
+          break;
+        sum += src[i + HARRIS_RADIUS + 1] - src[i - HARRIS_RADIUS];
+      }
+    }
+  }
+
+  void scoreRow(const uint32_t _row) const {
+    const int32_t* restrict boxXX = s_boxCols_hc[0];
+    const int32_t* restrict boxYY = s_boxCols_hc[1];
+    const int32_t* restrict boxXY = s_boxCols_hc[2];
+    int32_t* restrict scores = s_scores_hc[_row % 3];
+
+    for (uint32_t x = HARRIS_RADIUS + 1; x < m_width - HARRIS_RADIUS - 1; ++x) {
+      const int64_t a = boxXX[x];
+      const int64_t b = boxYY[x];
+      const int64_t c = boxXY[x];
+      const int64_t trace = a + b;
+      const int64_t response = (a * b - c * c) - ((trace * trace * HARRIS_K_Q10) >> 10);
+      scores[x] = response > 0 ? static_cast<int32_t>(response >> 16) : 0;
+    }
+  }
+
+  void suppressRow(const uint32_t _row) {
+    const int32_t* restrict above = s_scores_hc[(_row - 1) % 3];
+    const int32_t* restrict center = s_scores_hc[_row % 3];
+    const int32_t* restrict below = s_scores_hc[(_row + 1) % 3];
+    Candidate* tiles = m_tiles + (_row / HARRIS_TILE) * m_tileCols;
+
+    for (uint32_t x = HARRIS_RADIUS + 2; x < m_width - HARRIS_RADIUS - 2; ++x) {
+      const int32_t score = center[x];
+      if (score <= HARRIS_THRESHOLD)
+        continue;
+      // strict on one side, so plateaus yield a single maximum
+      if (score <= above[x - 1] || score <= above[x] || score <= above[x + 1] || score <= center[x - 1])
+        continue;
+      if (score < center[x + 1] || score < below[x - 1] || score < below[x] || score < below[x + 1])
+        continue;
+
+      Candidate& tile = tiles[x / HARRIS_TILE];
+      if (score > tile.score) {
+        tile.score = score;
+        tile.x = x;
+        tile.y = _row;
+      }
+    }
+  }
+
+public:
+  HarrisCornerDetector()
+    : m_width(0)
+    , m_height(0)
+    , m_tileCols(0)
+    , m_enabled(false) {}
+
+  bool setup(const ImageDesc& _imageDesc) {
+    m_width = _imageDesc.m_width;
+    m_height = _imageDesc.m_height;
+    m_tileCols = (m_width + HARRIS_TILE - 1) / HARRIS_TILE;
+    const uint32_t tileRows = (m_height + HARRIS_TILE - 1) / HARRIS_TILE;
+    m_enabled = m_width <= IMG_WIDTH && m_tileCols * tileRows <= HARRIS_MAX_TILES && m_width > 2 * HARRIS_WINDOW &&
+                m_height > 2 * HARRIS_WINDOW && m_width % 2 == 0;
+    return m_enabled;
+  }
+
+  bool begin() {
+    if (!m_enabled)
+      return false;
+
+    memset(s_boxRows_hc, 0, sizeof(s_boxRows_hc));
+    memset(s_boxCols_hc, 0, sizeof(s_boxCols_hc));
+    memset(s_scores_hc, 0, sizeof(s_scores_hc));
+    memset(m_tiles, 0, sizeof(m_tiles));
+    return true;
+  }
+
+  // Sobel gradients of rows 1 to height - 2 in order, element i of a row is column i + 1
+  void addGradientRow(const int16_t* restrict _gradX, const int16_t* restrict _gradY, const uint32_t _row) {
+    // window rows lag gradient rows by HARRIS_RADIUS, suppression lags scores by one more row
+    productRow(_gradX, _gradY);
+    boxRow(_row);
+    if (_row < HARRIS_WINDOW)
+      return;
+    scoreRow(_row - HARRIS_RADIUS);
+    if (_row >= HARRIS_WINDOW + 2)
+      suppressRow(_row - HARRIS_RADIUS - 1);
+  }
+
+  void finish(trik_cv_algorithm_out_edge_line& _out) {
+    _out.corner_count = 0;
+    if (!m_enabled)
+      return;
+
+    // corner budget: strongest tiles first
+    const uint32_t tiles = m_tileCols * ((m_height + HARRIS_TILE - 1) / HARRIS_TILE);
+    while (_out.corner_count < TRIK_MAX_CORNERS) {
+      Candidate* best = NULL;
+      for (uint32_t tile = 0; tile < tiles; ++tile)
+        if (m_tiles[tile].score > 0 && (best == NULL || m_tiles[tile].score > best->score))
+          best = &m_tiles[tile];
+      if (best == NULL)
+        break;
+
+      trik_cv_algorithm_out_corner& corner = _out.corners[_out.corner_count++];
+      corner.x = best->x;
+      corner.y = best->y;
+      best->score = 0;
+    }
+  }
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef TRIK_SENSORS_HOUGH_LINES_HPP_
+#define TRIK_SENSORS_HOUGH_LINES_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <xdc/runtime/Timestamp.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+#include <cmath>
+
+#include "image.hpp"
+
+namespace trik {
+namespace sensors {
+
+#define HOUGH_THETA_BINS 90   // 2 degrees per bin
+#define HOUGH_RHO_BINS 256    // 2 pixels per bin, covers images up to 255 pixels from center to corner
+#define HOUGH_MAX_POINTS 4096 // keeps int16 bins from saturating and bounds the voting time, edges beyond it are decimated
+#define HOUGH_BORDER 2        // Sobel output is not valid next to the image border
+#define HOUGH_SUPPRESS_THETA 3
+#define HOUGH_SUPPRESS_RHO 4
+
+static int16_t s_acc_hl[HOUGH_THETA_BINS * HOUGH_RHO_BINS] __attribute__((aligned(8))); // ~46KB, fits L2 SRAM
+static uint32_t s_cosSin_hl[HOUGH_THETA_BINS];                                          // sin:cos packed Q14 pairs for _dotp2
+static uint32_t s_points_hl[HOUGH_MAX_POINTS];                                          // dy:dx packed pairs relative to image center
+
+/*
+ * Line detector over an edge map, only 0xff bytes are edges.
+ * Lines are kept in normal form rho = dx*cos(theta) + dy*sin(theta), dx and dy taken from the image center.
+ */
+class HoughLineDetector {
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+  int32_t m_rhoMax; // even, so rho bins are symmetric around the center bin
+  bool m_enabled;
+
+  uint32_t collectPoints(const uint8_t* restrict _edges, uint32_t& _stride) const {
+    const int32_t cx = m_width / 2;
+    const int32_t cy = m_height / 2;
+
+    // first pass counts edges to pick a stride which keeps the point budget, edges are one pixel wide so no grid subsampling
+    uint32_t edges = 0;
+    for (uint32_t row = HOUGH_BORDER; row < m_height - HOUGH_BORDER; ++row) {
+      const uint8_t* restrict edgeRow = _edges + row * m_width;
+      for (uint32_t col = HOUGH_BORDER; col < m_width - HOUGH_BORDER; ++col)
+        edges += edgeRow[col] == 0xff;
+    }
+    const uint32_t stride = (edges + HOUGH_MAX_POINTS - 1) / HOUGH_MAX_POINTS;
+    _stride = stride;
+    if (stride == 0)
+      return 0;
+
+    uint32_t points = 0;
+    uint32_t skip = 0;
+    for (uint32_t row = HOUGH_BORDER; row < m_height - HOUGH_BORDER; ++row) {
+      const uint8_t* restrict edgeRow = _edges + row * m_width;
+      for (uint32_t col = HOUGH_BORDER; col < m_width - HOUGH_BORDER; ++col) {
+        if (edgeRow[col] != 0xff)
+          continue;
+        if (++skip < stride)
+          continue;
+        skip = 0;
+        s_points_hl[points++] = _pack2(static_cast<int32_t>(row) - cy, static_cast<int32_t>(col) - cx);
+      }
+    }
+    return points;
+  }
+
+  void vote(const uint32_t _points) const {
+    memset(s_acc_hl, 0, sizeof(s_acc_hl));
+
+    // bin = round(rho + rhoMax) / 2, rho in Q14 straight out of _dotp2
+    const int32_t rhoOffset = (m_rhoMax << 14) + (1 << 14);
+    for (uint32_t point = 0; point < _points; ++point) {
+      const uint32_t dydx = s_points_hl[point];
+      int16_t* restrict acc = s_acc_hl;
+#pragma MUST_ITERATE(HOUGH_THETA_BINS, HOUGH_THETA_BINS, 2)
+      for (uint32_t theta = 0; theta < HOUGH_THETA_BINS; ++theta) {
+        const int32_t bin = (_dotp2(s_cosSin_hl[theta], dydx) + rhoOffset) >> 15;
+        ++acc[bin];
+        acc += HOUGH_RHO_BINS;
+      }
+    }
+  }
+
+  void suppress(const int32_t _theta, const int32_t _bin) const {
+    const int32_t rhoBins = m_rhoMax + 1;
+    for (int32_t dt = -HOUGH_SUPPRESS_THETA; dt <= HOUGH_SUPPRESS_THETA; ++dt) {
+      int32_t theta = _theta + dt;
+      int32_t bin = _bin;
+      // theta wraps around at 180 degrees with the rho sign flipped
+      if (theta < 0 || theta >= HOUGH_THETA_BINS) {
+        theta = theta < 0 ? theta + HOUGH_THETA_BINS : theta - HOUGH_THETA_BINS;
+        bin = m_rhoMax - bin;
+      }
+      int16_t* restrict acc = s_acc_hl + theta * HOUGH_RHO_BINS;
+      for (int32_t b = bin - HOUGH_SUPPRESS_RHO; b <= bin + HOUGH_SUPPRESS_RHO; ++b)
+        if (b >= 0 && b < rhoBins)
+          acc[b] = 0;
+    }
+  }
+
+public:
+  HoughLineDetector()
+    : m_width(0)
+    , m_height(0)
+    , m_rhoMax(0)
+    , m_enabled(false) {}
+
+  bool setup(const ImageDesc& _imageDesc) {
+    m_width = _imageDesc.m_width;
+    m_height = _imageDesc.m_height;
+    const int32_t halfDiagonal = std::ceil(std::sqrt(static_cast<float>(m_width * m_width + m_height * m_height)) / 2);
+    m_rhoMax = (halfDiagonal + 1) & ~1;
+    m_enabled = m_rhoMax < HOUGH_RHO_BINS && m_width > 2 * HOUGH_BORDER && m_height > 2 * HOUGH_BORDER;
+
+    for (uint32_t theta = 0; theta < HOUGH_THETA_BINS; ++theta) {
+      const float angle = (3.1415927f * theta) / HOUGH_THETA_BINS;
+      const int32_t cosQ14 = std::floor(std::cos(angle) * (1 << 14) + 0.5f);
+      const int32_t sinQ14 = std::floor(std::sin(angle) * (1 << 14) + 0.5f);
+      s_cosSin_hl[theta] = _pack2(range<int32_t>(-0x7fff, sinQ14, 0x7fff), range<int32_t>(-0x7fff, cosQ14, 0x7fff));
+    }
+    return m_enabled;
+  }
+
+  void run(const uint8_t* restrict _edges, trik_cv_algorithm_out_edge_line& _out) const {
+    const uint32_t startTime = Timestamp_get32();
+
+    _out.line_count = 0;
+    _out.edge_points = 0;
+    if (m_enabled) {
+      uint32_t stride;
+      const uint32_t points = collectPoints(_edges, stride);
+      _out.edge_points = points;
+      vote(points);
+
+      // a line across a quarter of the frame height, scaled down by the sampling stride
+      const int32_t strideVotes = stride > 0 ? m_height / (4 * stride) : 0;
+      const int32_t minVotes = strideVotes > 8 ? strideVotes : 8;
+      const int32_t rhoBins = m_rhoMax + 1;
+      while (_out.line_count < TRIK_MAX_EDGE_LINES) {
+        int32_t bestVotes = 0;
+        int32_t bestTheta = 0;
+        int32_t bestBin = 0;
+        for (int32_t theta = 0; theta < HOUGH_THETA_BINS; ++theta) {
+          const int16_t* restrict acc = s_acc_hl + theta * HOUGH_RHO_BINS;
+          for (int32_t bin = 0; bin < rhoBins; ++bin)
+            if (acc[bin] > bestVotes) {
+              bestVotes = acc[bin];
+              bestTheta = theta;
+              bestBin = bin;
+            }
+        }
+        if (bestVotes < minVotes)
+          break;
+
+        trik_cv_algorithm_out_hough_line& line = _out.lines[_out.line_count++];
+        line.rho = bestBin * 2 - m_rhoMax;
+        line.theta = (bestTheta * 180) / HOUGH_THETA_BINS;
+        line.votes = bestVotes;
+        suppress(bestTheta, bestBin);
+      }
+    }
+
+    _out.hough_cycles = Timestamp_get32() - startTime;
+  }
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef TRIK_SENSORS_LANE_SENSOR_HPP_
+#define TRIK_SENSORS_LANE_SENSOR_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+#include <cassert>
+#include <cmath>
+
+#include "floor_projection.hpp"
+#include "lens_undistortion.hpp"
+
+namespace trik {
+namespace sensors {
+
+#define LANE_DEFAULT_BANDS 4
+#define LANE_MAX_RUNS 32         // runs kept per row, left to right
+#define LANE_MAX_GAP 2           // detection gaps up to that many pixels are bridged, checkerboard sampling leaves 2 pixel gaps
+#define LANE_MIN_RUN 3           // shorter runs are noise
+#define LANE_MIN_ROWS_PERCENT 25 // a band boundary needs runs in that share of the sampled band rows
+
+/*
+ * Lane between two lines of the detected color. Rows are scanned as runs of the packed detection mask, the runs
+ * closest to the lane center of the previous frame on either side are the boundaries. Bands with one boundary
+ * only keep the last lane width seen in them.
+ */
+class LaneSensorCvAlgorithm : public CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X> {
+private:
+  struct Run {
+    uint32_t m_begin;
+    uint32_t m_end;
+  };
+
+  uint64_t m_detectRange;
+  uint32_t m_detectExpected;
+  uint32_t m_bands;
+
+  uint32_t m_leftSum[TRIK_MAX_LINE_BANDS]; // doubled run centers
+  uint32_t m_leftRows[TRIK_MAX_LINE_BANDS];
+  uint32_t m_rightSum[TRIK_MAX_LINE_BANDS];
+  uint32_t m_rightRows[TRIK_MAX_LINE_BANDS];
+  uint32_t m_sampledRows[TRIK_MAX_LINE_BANDS];
+  int32_t m_center[TRIK_MAX_LINE_BANDS]; // lane of the previous frame, pixels
+  int32_t m_width[TRIK_MAX_LINE_BANDS];  // last lane width seen with both boundaries, 0 while unknown
+
+  FloorProjection m_floor;
+  LensUndistortion m_lens;
+
+  int32_t undistortedCol(int32_t _col, int32_t _row) const {
+    m_lens.undistort(_col, _row);
+    return _col;
+  }
+
+  static uint32_t lowestBit(const uint32_t _bits) { return 31 - _lmbd(1, _bits & (0 - _bits)); }
+
+  uint32_t band(const uint32_t _row) const { return (_row * m_bands) / m_inImageDesc.m_height; }
+  uint32_t bandRowBegin(const uint32_t _band) const { return (_band * m_inImageDesc.m_height + m_bands - 1) / m_bands; }
+
+  // runs of set bits, short gaps bridged and short runs dropped, runs past LANE_MAX_RUNS are ignored
+  uint32_t rowRuns(const uint32_t* restrict _mask, Run* _runs) const {
+    const uint32_t words = m_inImageDesc.m_width / 32;
+    uint32_t runs = 0;
+    uint32_t begin = 0;
+    bool inRun = false;
+    // gaps are bridged to the run found last, which is not the last stored one once the table is full
+    bool found = false;
+    bool stored = false;
+    uint32_t end = 0;
+    for (uint32_t word = 0; word < words; ++word) {
+      const uint32_t bits = _mask[word];
+      uint32_t passed = 0;
+      while (true) {
+        // inside a run the next zero bit ends it, outside the next set bit starts one
+        const uint32_t pending = (inRun ? ~bits : bits) & ~passed;
+        if (pending == 0)
+          break;
+        const uint32_t pos = lowestBit(pending);
+        const uint32_t col = word * 32 + pos;
+        if (inRun) {
+          stored = runs < LANE_MAX_RUNS;
+          if (stored) {
+            _runs[runs].m_begin = begin;
+            _runs[runs].m_end = col;
+            ++runs;
+          }
+          found = true;
+          end = col;
+        } else if (found && col - end <= LANE_MAX_GAP) {
+          // a bridged run which did not fit keeps its begin and is dropped again when it ends
+          if (stored)
+            begin = _runs[--runs].m_begin;
+        } else
+          begin = col;
+        inRun = !inRun;
+        passed = (1u << pos) - 1;
+      }
+    }
+    if (inRun && runs < LANE_MAX_RUNS) {
+      _runs[runs].m_begin = begin;
+      _runs[runs].m_end = m_inImageDesc.m_width;
+      ++runs;
+    }
+
+    uint32_t kept = 0;
+    for (uint32_t run = 0; run < runs; ++run)
+      if (_runs[run].m_end - _runs[run].m_begin >= LANE_MIN_RUN)
+        _runs[kept++] = _runs[run];
+    return kept;
+  }
+
+  void proceedRow(const uint32_t _row, const uint32_t* restrict _mask) {
+    Run runs[LANE_MAX_RUNS];
+    const uint32_t runCount = rowRuns(_mask, runs);
+    const uint32_t b = band(_row);
+    const uint32_t reference = 2 * m_center[b];
+    ++m_sampledRows[b];
+
+    int32_t left = -1;
+    int32_t right = -1;
+    for (uint32_t run = 0; run < runCount; ++run) {
+      const uint32_t center2 = runs[run].m_begin + runs[run].m_end - 1;
+      if (center2 < reference)
+        left = center2;
+      else if (right < 0)
+        right = center2;
+    }
+    if (left >= 0) {
+      m_leftSum[b] += left;
+      ++m_leftRows[b];
+    }
+    if (right >= 0) {
+      m_rightSum[b] += right;
+      ++m_rightRows[b];
+    }
+  }
+
+  template <bool _preview>
+  void proceedImageHsv(ImageBuffer& _outImage) {
+    uint32_t mask[IMG_WIDTH / 32];
+    RoiSpan spans[TRIK_MAX_ROIS];
+    for (uint32_t srcRow = m_roiRowBegin; srcRow < m_roiRowEnd; ++srcRow) {
+      if (!isSampledRow(srcRow))
+        continue;
+      const uint32_t spanCount = roiRowSpans(srcRow, spans);
+      detectHsvRow<_preview>(_outImage, srcRow, spans, spanCount, m_detectRange, m_detectExpected, mask);
+      proceedRow(srcRow, mask);
+    }
+  }
+
+public:
+  virtual bool setup(const ImageDesc& _inImageDesc, const ImageDesc& _outImageDesc, int8_t* _fastRam, size_t _fastRamSize) {
+    if (!commonSetup(_inImageDesc, _outImageDesc, _fastRam, _fastRamSize))
+      return false;
+
+    for (uint32_t b = 0; b < TRIK_MAX_LINE_BANDS; ++b) {
+      m_center[b] = m_inImageDesc.m_width / 2;
+      m_width[b] = 0;
+    }
+    m_bands = LANE_DEFAULT_BANDS;
+    m_floor.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
+    m_lens.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
+    return true;
+  }
+
+  virtual bool run(const ImageBuffer& _inImage, ImageBuffer& _outImage, const trik_cv_algorithm_in_args& _inArgs, trik_cv_algorithm_out_args& _outArgs) {
+    if (m_inImageDesc.m_height * m_inImageDesc.m_lineLength > _inImage.m_size)
+      return false;
+    if (m_outImageDesc.m_height * m_outImageDesc.m_lineLength > _outImage.m_size)
+      return false;
+    _outImage.m_size = m_outImageDesc.m_height * m_outImageDesc.m_lineLength;
+
+    uint32_t detectHueFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_hue_from) * 255) / 359, 255); // scaling 0..359 to 0..255
+    uint32_t detectHueTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_hue_to) * 255) / 359, 255);     // scaling 0..359 to 0..255
+    uint32_t detectSatFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_sat_from) * 255) / 100, 255); // scaling 0..100 to 0..255
+    uint32_t detectSatTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_sat_to) * 255) / 100, 255);     // scaling 0..100 to 0..255
+    uint32_t detectValFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_from) * 255) / 100, 255); // scaling 0..100 to 0..255
+    uint32_t detectValTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_to) * 255) / 100, 255);     // scaling 0..100 to 0..255
+
+    if (detectHueFrom <= detectHueTo) {
+      m_detectRange = _itoll((detectValFrom << 16) | (detectSatFrom << 8) | detectHueFrom, (detectValTo << 16) | (detectSatTo << 8) | detectHueTo);
+      m_detectExpected = 0x0;
+    } else {
+      assert(detectHueFrom > 0 && detectHueTo < 255);
+      m_detectRange = _itoll((detectValFrom << 16) | (detectSatFrom << 8) | (detectHueTo + 1), (detectValTo << 16) | (detectSatTo << 8) | (detectHueFrom - 1));
+      m_detectExpected = 0x1;
+    }
+
+    const uint32_t bands = _inArgs.line_bands == 0 ? LANE_DEFAULT_BANDS : range<uint32_t>(1, _inArgs.line_bands, TRIK_MAX_LINE_BANDS);
+    if (bands != m_bands) {
+      for (uint32_t b = 0; b < TRIK_MAX_LINE_BANDS; ++b) {
+        m_center[b] = m_inImageDesc.m_width / 2;
+        m_width[b] = 0;
+      }
+      m_bands = bands;
+    }
+    memset(m_leftSum, 0, sizeof(m_leftSum));
+    memset(m_leftRows, 0, sizeof(m_leftRows));
+    memset(m_rightSum, 0, sizeof(m_rightSum));
+    memset(m_rightRows, 0, sizeof(m_rightRows));
+    memset(m_sampledRows, 0, sizeof(m_sampledRows));
+    m_floor.configure(_inArgs);
+    m_lens.configure(_inArgs);
+    setupPreview(_inArgs, _outImage);
+
+    if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0) {
+      setupRois(_inArgs);
+      setupSampling(_inArgs);
+      convertImageYuyvToHsv(_inImage);
+      if (m_previewImage) {
+        renderPreviewBackground(_inImage, _outImage, _outArgs.cycles);
+        proceedImageHsv<true>(_outImage);
+      } else
+        proceedImageHsv<false>(_outImage);
+    }
+
+    trik_cv_algorithm_out_lane& lane = _outArgs.ext.lane;
+    memset(&lane, 0, sizeof(lane));
+    lane.band_count = m_bands;
+
+    // heading is fitted over undistorted band centers, rows pointing up, lane state stays in frame pixels
+    const int32_t halfWidth = m_inImageDesc.m_width / 2;
+    int64_t fitN = 0;
+    int64_t fitX = 0;
+    int64_t fitY = 0;
+    int64_t fitXY = 0;
+    int64_t fitYY = 0;
+    int32_t bottom = -1;
+    int32_t bottomCol = 0;
+    int32_t bottomRow = 0;
+    for (uint32_t b = 0; b < m_bands; ++b) {
+      trik_cv_algorithm_out_lane_band& out = lane.bands[b];
+      const uint32_t minRows = (m_sampledRows[b] * LANE_MIN_ROWS_PERCENT + 99) / 100;
+      const bool left = m_sampledRows[b] > 0 && m_leftRows[b] >= minRows;
+      const bool right = m_sampledRows[b] > 0 && m_rightRows[b] >= minRows;
+      const int32_t leftX = left ? m_leftSum[b] / (2 * m_leftRows[b]) : 0;
+      const int32_t rightX = right ? m_rightSum[b] / (2 * m_rightRows[b]) : 0;
+
+      if (left && right) {
+        m_width[b] = rightX - leftX;
+        m_center[b] = (leftX + rightX) / 2;
+      } else if (left && m_width[b] > 0)
+        m_center[b] = leftX + m_width[b] / 2;
+      else if (right && m_width[b] > 0)
+        m_center[b] = rightX - m_width[b] / 2;
+      else
+        continue;
+      m_center[b] = range<int32_t>(0, m_center[b], m_inImageDesc.m_width - 1);
+
+      const int32_t row = (bandRowBegin(b) + bandRowBegin(b + 1)) / 2;
+      int32_t centerCol = m_center[b];
+      int32_t centerRow = row;
+      m_lens.undistort(centerCol, centerRow);
+
+      out.boundaries = (left ? TRIK_LANE_LEFT : 0) | (right ? TRIK_LANE_RIGHT : 0);
+      out.left = left ? range<int32_t>(-100, ((undistortedCol(leftX, row) - halfWidth) * 100) / halfWidth, 100) : 0;
+      out.right = right ? range<int32_t>(-100, ((undistortedCol(rightX, row) - halfWidth) * 100) / halfWidth, 100) : 0;
+      out.center = range<int32_t>(-100, ((centerCol - halfWidth) * 100) / halfWidth, 100);
+      lane.boundaries |= out.boundaries;
+
+      const int64_t y = static_cast<int32_t>(m_inImageDesc.m_height) - 1 - centerRow;
+      ++fitN;
+      fitX += centerCol;
+      fitY += y;
+      fitXY += centerCol * y;
+      fitYY += y * y;
+      bottom = b;
+      bottomCol = centerCol;
+      bottomRow = centerRow;
+      m_floor.projectPathPoint(b, centerCol, centerRow, _outArgs.floor);
+
+      if (!m_previewOverlay)
+        continue;
+      drawFatPixel(m_center[b], row, _outImage, 0x00ff00);
+      if (left)
+        drawFatPixel(leftX, row, _outImage, 0xff0000);
+      if (right)
+        drawFatPixel(rightX, row, _outImage, 0x0000ff);
+    }
+    if (m_previewOverlay)
+      drawRois(_outImage, 0xffff00);
+
+    _outArgs.targets[0].x = 0;
+    _outArgs.targets[0].y = 0;
+    _outArgs.targets[0].size = 0;
+    if (bottom < 0)
+      return true;
+
+    const int32_t bandRow = (bandRowBegin(bottom) + bandRowBegin(bottom + 1)) / 2;
+    const int32_t width = undistortedCol(m_center[bottom] + m_width[bottom] - m_width[bottom] / 2, bandRow) - undistortedCol(m_center[bottom] - m_width[bottom] / 2, bandRow);
+    lane.center = lane.bands[bottom].center;
+    lane.width = range<int32_t>(0, (width * 100) / static_cast<int32_t>(m_inImageDesc.m_width), 100);
+    const int64_t denominator = fitN * fitYY - fitY * fitY;
+    if (fitN >= 2 && denominator != 0) {
+      const float slope = static_cast<float>(fitN * fitXY - fitX * fitY) / denominator;
+      lane.angle = std::floor(std::atan(slope) * (1800.0f / 3.1415927f) + 0.5f);
+    }
+
+    _outArgs.targets[0].x = lane.center;
+    _outArgs.targets[0].size = lane.width;
+    m_floor.projectTarget(0, bottomCol, bottomRow, _outArgs.floor);
+    return true;
+  }
+};
+
+}
+}
+
+#endif
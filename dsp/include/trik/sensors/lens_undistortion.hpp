@@ -0,0 +1,143 @@
+#ifndef TRIK_SENSORS_LENS_UNDISTORTION_HPP_
+#define TRIK_SENSORS_LENS_UNDISTORTION_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+
+namespace trik {
+namespace sensors {
+
+#define LENS_GRID_COLS 20 // grid cells over the frame, 16 pixels square at full resolution
+#define LENS_GRID_ROWS 15
+#define LENS_NEWTON_STEPS 8
+
+static int32_t s_grid_lu[LENS_GRID_ROWS + 1][LENS_GRID_COLS + 1][2] __attribute__((aligned(8))); // undistorted column and row of a node, Q4 pixels
+
+/*
+ * Sparse undistortion of the radial lens model of the in_args. The inverse model is solved once per configuration
+ * on the nodes of a coarse grid, detected points are then undistorted by bilinear interpolation over their cell.
+ * Pixels are those of the sensor frame, undistorted ones may fall outside of it.
+ */
+class LensUndistortion {
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+  bool m_enabled;
+  trik_cv_algorithm_lens m_lens;
+
+  void build() {
+    const double colScale = static_cast<double>(IMG_WIDTH) / m_width;
+    const double rowScale = static_cast<double>(IMG_HEIGHT) / m_height;
+    for (uint32_t row = 0; row <= LENS_GRID_ROWS; ++row)
+      for (uint32_t col = 0; col <= LENS_GRID_COLS; ++col) {
+        double u = ((col * m_width) / static_cast<double>(LENS_GRID_COLS) + 0.5) * colScale - 0.5;
+        double v = ((row * m_height) / static_cast<double>(LENS_GRID_ROWS) + 0.5) * rowScale - 0.5;
+        undistortFullFrame(m_lens, u, v);
+        s_grid_lu[row][col][0] = std::floor(((u + 0.5) / colScale - 0.5) * 16 + 0.5);
+        s_grid_lu[row][col][1] = std::floor(((v + 0.5) / rowScale - 0.5) * 16 + 0.5);
+      }
+  }
+
+public:
+  LensUndistortion()
+    : m_width(0)
+    , m_height(0)
+    , m_enabled(false) {
+    memset(&m_lens, 0, sizeof(m_lens));
+  }
+
+  static bool enabled(const trik_cv_algorithm_lens& _lens) { return _lens.focal > 0 && (_lens.k1 != 0 || _lens.k2 != 0); }
+
+  // full frame pixel through the inverse radial model, r_d = r_u (1 + k1 r_u^2 + k2 r_u^4) solved for r_u by Newton steps
+  static void undistortFullFrame(const trik_cv_algorithm_lens& _lens, double& _u, double& _v) {
+    if (!enabled(_lens))
+      return;
+    const double k1 = _lens.k1 / 10000.0;
+    const double k2 = _lens.k2 / 10000.0;
+    const double centerU = (IMG_WIDTH - 1) / 2.0;
+    const double centerV = (IMG_HEIGHT - 1) / 2.0;
+    const double x = (_u - centerU) / _lens.focal;
+    const double y = (_v - centerV) / _lens.focal;
+    const double distorted = std::sqrt(x * x + y * y);
+    if (distorted == 0)
+      return;
+
+    double r = distorted;
+    for (uint32_t step = 0; step < LENS_NEWTON_STEPS; ++step) {
+      const double r2 = r * r;
+      const double slope = 1 + 3 * k1 * r2 + 5 * k2 * r2 * r2;
+      if (slope <= 0)
+        break; // past the fold of the model, keep the last estimate
+      r -= (r * (1 + k1 * r2 + k2 * r2 * r2) - distorted) / slope;
+    }
+    const double scale = r / distorted;
+    _u = centerU + x * scale * _lens.focal;
+    _v = centerV + y * scale * _lens.focal;
+  }
+
+  void setup(const uint32_t _width, const uint32_t _height) {
+    m_width = _width;
+    m_height = _height;
+    m_enabled = false;
+    memset(&m_lens, 0, sizeof(m_lens));
+  }
+
+  // the grid is rebuilt only when the lens changes, it is shared by all sensors of the frame size set up last
+  void configure(const trik_cv_algorithm_in_args& _inArgs) {
+    if (memcmp(&m_lens, &_inArgs.lens, sizeof(m_lens)) == 0)
+      return;
+    m_lens = _inArgs.lens;
+    m_enabled = enabled(m_lens);
+    if (m_enabled)
+      build();
+  }
+
+  bool enabled() const { return m_enabled; }
+
+  // Q4 pixels in and out, points outside of the frame use the nearest cell
+  void undistortQ4(int32_t& _colQ4, int32_t& _rowQ4) const {
+    if (!m_enabled)
+      return;
+    const int32_t cellWidth = (m_width * 16) / LENS_GRID_COLS;
+    const int32_t cellHeight = (m_height * 16) / LENS_GRID_ROWS;
+    const int32_t col = range<int32_t>(0, _colQ4 / cellWidth, LENS_GRID_COLS - 1);
+    const int32_t row = range<int32_t>(0, _rowQ4 / cellHeight, LENS_GRID_ROWS - 1);
+    const int64_t fx = _colQ4 - col * cellWidth;
+    const int64_t fy = _rowQ4 - row * cellHeight;
+    const int64_t area = static_cast<int64_t>(cellWidth) * cellHeight;
+
+    int32_t result[2];
+    for (uint32_t k = 0; k < 2; ++k) {
+      const int64_t upper = s_grid_lu[row][col][k] * (cellWidth - fx) + s_grid_lu[row][col + 1][k] * fx;
+      const int64_t lower = s_grid_lu[row + 1][col][k] * (cellWidth - fx) + s_grid_lu[row + 1][col + 1][k] * fx;
+      const int64_t value = upper * (cellHeight - fy) + lower * fy;
+      result[k] = (2 * value + (value < 0 ? -area : area)) / (2 * area);
+    }
+    _colQ4 = result[0];
+    _rowQ4 = result[1];
+  }
+
+  // whole pixels, rounded
+  void undistort(int32_t& _col, int32_t& _row) const {
+    if (!m_enabled)
+      return;
+    int32_t colQ4 = _col * 16;
+    int32_t rowQ4 = _row * 16;
+    undistortQ4(colQ4, rowQ4);
+    _col = (colQ4 + 8) >> 4;
+    _row = (rowQ4 + 8) >> 4;
+  }
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef TRIK_SENSORS_LINE_PATH_HPP_
+#define TRIK_SENSORS_LINE_PATH_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+
+#include "lens_undistortion.hpp"
+
+namespace trik {
+namespace sensors {
+
+#define LINE_PATH_DEFAULT_BANDS 4
+#define LINE_PATH_U_RANGE 64 // fit abscissa u runs -64..64 from the bottom row to the top row
+
+/*
+ * Path of the line over horizontal bands, built from the per-row sums of the line sensor.
+ * Band centroids are fitted with x = a + b*u + c*u*u by integer least squares, x in quarter pixels from the
+ * image center, so offset, heading and curvature at the bottom row come without another pixel pass.
+ */
+class LinePath {
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_bands;
+
+  uint32_t m_bandCols[TRIK_MAX_LINE_BANDS]; // sum of line pixel columns
+  uint32_t m_bandRows[TRIK_MAX_LINE_BANDS]; // sum of line pixel rows
+  uint32_t m_bandPoints[TRIK_MAX_LINE_BANDS];
+
+  bool m_fitted;
+  int64_t m_a;    // quarter pixels
+  int64_t m_bQ8;  // quarter pixels per u, Q8
+  int64_t m_cQ16; // quarter pixels per u squared, Q16
+
+  static int64_t det3(const int64_t _m[3][3]) {
+    return _m[0][0] * (_m[1][1] * _m[2][2] - _m[1][2] * _m[2][1]) - _m[0][1] * (_m[1][0] * _m[2][2] - _m[1][2] * _m[2][0]) +
+           _m[0][2] * (_m[1][0] * _m[2][1] - _m[1][1] * _m[2][0]);
+  }
+
+  // u of a centroid row, both rows Q8 so that centroids between rows keep their fraction
+  int32_t rowToU(const int64_t _rowQ8) const {
+    const int64_t heightQ8 = static_cast<int64_t>(m_height - 1) << 8;
+    return static_cast<int32_t>(((heightQ8 - _rowQ8) * 2 * LINE_PATH_U_RANGE) / heightQ8) - LINE_PATH_U_RANGE;
+  }
+
+  int64_t fittedX(const int32_t _u) const { return m_a + ((m_bQ8 * _u) >> 8) + ((m_cQ16 * _u * _u) >> 16); }
+
+public:
+  LinePath()
+    : m_width(0)
+    , m_height(0)
+    , m_bands(LINE_PATH_DEFAULT_BANDS)
+    , m_fitted(false)
+    , m_a(0)
+    , m_bQ8(0)
+    , m_cQ16(0) {}
+
+  void setup(const uint32_t _width, const uint32_t _height) {
+    m_width = _width;
+    m_height = _height;
+  }
+
+  void reset(const trik_cv_algorithm_in_args& _inArgs) {
+    m_bands = _inArgs.line_bands == 0 ? LINE_PATH_DEFAULT_BANDS : range<uint32_t>(1, _inArgs.line_bands, TRIK_MAX_LINE_BANDS);
+    memset(m_bandCols, 0, sizeof(m_bandCols));
+    memset(m_bandRows, 0, sizeof(m_bandRows));
+    memset(m_bandPoints, 0, sizeof(m_bandPoints));
+    m_fitted = false;
+  }
+
+  uint32_t bands() const { return m_bands; }
+  uint32_t band(const uint32_t _row) const { return (_row * m_bands) / m_height; }
+  uint32_t bandRowBegin(const uint32_t _band) const { return (_band * m_height + m_bands - 1) / m_bands; }
+  uint32_t bandPoints(const uint32_t _band) const { return m_bandPoints[_band]; }
+
+  // line centroid of a band, false when the band has no line pixels
+  bool centroid(const uint32_t _band, int32_t& _col, int32_t& _row) const {
+    if (m_bandPoints[_band] == 0)
+      return false;
+    _col = m_bandCols[_band] / m_bandPoints[_band];
+    _row = m_bandRows[_band] / m_bandPoints[_band];
+    return true;
+  }
+
+  void addRow(const uint32_t _row, const uint32_t _points, const uint32_t _cols) {
+    const uint32_t b = band(_row);
+    m_bandCols[b] += _cols;
+    m_bandRows[b] += _row * _points;
+    m_bandPoints[b] += _points;
+  }
+
+  // _estimatedPoints are the band pixel counts scaled up for sampling, bands need a line pixel per row on average to be fitted
+  void fit(const uint32_t* _estimatedPoints, const LensUndistortion& _lens, trik_cv_algorithm_out_line_path& _out) {
+    memset(&_out, 0, sizeof(_out));
+    _out.band_count = m_bands;
+
+    // normal equation sums, x centered and in quarter pixels
+    int64_t s[5] = { 0, 0, 0, 0, 0 }; // sum of u^k
+    int64_t sx[3] = { 0, 0, 0 };      // sum of x*u^k
+    const int32_t halfWidth = m_width / 2;
+    for (uint32_t b = 0; b < m_bands; ++b) {
+      const uint32_t points = m_bandPoints[b];
+      const uint32_t bandRows = bandRowBegin(b + 1) - bandRowBegin(b);
+      if (points == 0)
+        continue;
+
+      // centroids are fitted undistorted
+      int64_t colQ8 = (static_cast<int64_t>(m_bandCols[b]) << 8) / points;
+      int64_t rowQ8 = (static_cast<int64_t>(m_bandRows[b]) << 8) / points;
+      if (_lens.enabled()) {
+        int32_t colQ4 = colQ8 >> 4;
+        int32_t rowQ4 = rowQ8 >> 4;
+        _lens.undistortQ4(colQ4, rowQ4);
+        colQ8 = colQ4 * 16;
+        rowQ8 = rowQ4 * 16;
+      }
+
+      const int32_t col = colQ8 >> 8;
+      trik_cv_algorithm_out_line_band& band = _out.bands[b];
+      band.x = range<int32_t>(-100, ((col - halfWidth) * 100) / halfWidth, 100);
+      band.size = bandRows > 0 ? (_estimatedPoints[b] * 100) / (bandRows * m_width) : 0;
+      if (_estimatedPoints[b] < bandRows)
+        continue;
+
+      const int64_t x = (colQ8 >> 6) - 4 * halfWidth;
+      const int64_t u = rowToU(rowQ8);
+      s[0] += 1;
+      s[1] += u;
+      s[2] += u * u;
+      s[3] += u * u * u;
+      s[4] += u * u * u * u;
+      sx[0] += x;
+      sx[1] += x * u;
+      sx[2] += x * u * u;
+      ++_out.fit_bands;
+    }
+
+    // |u| <= 64 and |x| <= 640 keep every determinant below 2^55, so Cramer's rule stays in 64 bits
+    m_a = 0;
+    m_bQ8 = 0;
+    m_cQ16 = 0;
+    const int64_t quadratic[3][3] = { { s[0], s[1], s[2] }, { s[1], s[2], s[3] }, { s[2], s[3], s[4] } };
+    const int64_t det = det3(quadratic);
+    const int64_t detLinear = s[0] * s[2] - s[1] * s[1];
+    if (_out.fit_bands >= 3 && det != 0) {
+      const int64_t forA[3][3] = { { sx[0], s[1], s[2] }, { sx[1], s[2], s[3] }, { sx[2], s[3], s[4] } };
+      const int64_t forB[3][3] = { { s[0], sx[0], s[2] }, { s[1], sx[1], s[3] }, { s[2], sx[2], s[4] } };
+      const int64_t forC[3][3] = { { s[0], s[1], sx[0] }, { s[1], s[2], sx[1] }, { s[2], s[3], sx[2] } };
+      m_a = det3(forA) / det;
+      m_bQ8 = (det3(forB) * 256) / det;
+      m_cQ16 = (det3(forC) * 65536) / det;
+    } else if (_out.fit_bands >= 2 && detLinear != 0) {
+      m_a = (sx[0] * s[2] - s[1] * sx[1]) / detLinear;
+      m_bQ8 = ((s[0] * sx[1] - s[1] * sx[0]) * 256) / detLinear;
+    } else if (_out.fit_bands >= 1)
+      m_a = sx[0] / s[0];
+    m_fitted = _out.fit_bands > 0;
+    if (!m_fitted)
+      return;
+
+    // derivatives over rows upwards from the bottom, u grows by 2*LINE_PATH_U_RANGE over height - 1 rows
+    const int32_t bottom = -LINE_PATH_U_RANGE;
+    const int64_t bottomX = fittedX(bottom);
+    const float rowsPerU = static_cast<float>(m_height - 1) / (2 * LINE_PATH_U_RANGE);
+    const float slope = (m_bQ8 + ((2 * m_cQ16 * bottom) >> 8)) / (256.0f * 4.0f * rowsPerU);
+    const float secondDerivative = (2.0f * m_cQ16) / (65536.0f * 4.0f * rowsPerU * rowsPerU);
+    const float curvature = secondDerivative / std::pow(1.0f + slope * slope, 1.5f);
+
+    _out.offset = range<int32_t>(-100, (bottomX * 100) / (4 * halfWidth), 100);
+    _out.angle = std::floor(std::atan(slope) * (1800.0f / 3.1415927f) + 0.5f);
+    _out.curvature = range<int32_t>(-0x7fff, std::floor(curvature * m_height * 1000.0f + 0.5f), 0x7fff);
+  }
+
+  // column of the fitted path in _row, false when there is no path
+  bool column(const uint32_t _row, int32_t& _col) const {
+    if (!m_fitted)
+      return false;
+    _col = (fittedX(rowToU(static_cast<int64_t>(_row) << 8)) >> 2) + static_cast<int32_t>(m_width / 2);
+    return _col >= 0 && _col < static_cast<int32_t>(m_width);
+  }
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef TRIK_SENSORS_LINE_PROJECTION_HPP_
+#define TRIK_SENSORS_LINE_PROJECTION_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+
+namespace trik {
+namespace sensors {
+
+#define MASK_WORDS (IMG_WIDTH / 32)
+#define JUNCTION_BAR_FACTOR 3      // rows wider than that many line widths belong to a crossing bar
+#define JUNCTION_MIN_BAR_PIXELS 16 // and have at least that many pixels more than the line itself
+#define JUNCTION_MIN_STEM_ROWS 8   // sampled rows of line needed above or below the bar to count as a stem
+
+static uint32_t s_masks_lp[IMG_HEIGHT][MASK_WORDS] __attribute__((aligned(8))); // bit i of word w is column 32 * w + i
+static uint16_t s_rowCounts_lp[IMG_HEIGHT];
+static uint32_t s_rowCols_lp[IMG_HEIGHT];
+
+/*
+ * Row and column projections of bit-packed line masks. Pixel counts and column sums come from popcounts,
+ * so the per pixel work of the line sensor is the detection alone.
+ */
+class LineProjections {
+private:
+  uint32_t m_width;
+  uint32_t m_words;
+
+  static uint32_t popcount(const uint32_t _word) { return _dotpu4(_bitc4(_word), 0x01010101); }
+
+  // line pixels of _row left of _col
+  uint32_t pixelsBefore(const uint32_t _row, const uint32_t _col) const {
+    const uint32_t* restrict mask = s_masks_lp[_row];
+    const uint32_t words = _col / 32 < m_words ? _col / 32 : m_words;
+    uint32_t pixels = 0;
+    for (uint32_t word = 0; word < words; ++word)
+      pixels += popcount(mask[word]);
+    if (words < m_words && _col % 32 != 0)
+      pixels += popcount(mask[words] & ((1u << (_col % 32)) - 1));
+    return pixels;
+  }
+
+  // column of the line in the sampled row nearest to _row among [_begin, _end) going by _step, false without line rows
+  bool lineCol(const int32_t _begin, const int32_t _end, const int32_t _step, const uint32_t _barPixels, uint32_t& _col) const {
+    for (int32_t row = _begin; row != _end; row += _step)
+      if (s_rowCounts_lp[row] > 0 && s_rowCounts_lp[row] < _barPixels) {
+        _col = s_rowCols_lp[row] / s_rowCounts_lp[row];
+        return true;
+      }
+    return false;
+  }
+
+public:
+  LineProjections()
+    : m_width(0)
+    , m_words(0) {}
+
+  void setup(const uint32_t _width) {
+    m_width = _width;
+    m_words = _width / 32;
+  }
+
+  void reset() {
+    memset(s_rowCounts_lp, 0, sizeof(s_rowCounts_lp));
+    memset(s_rowCols_lp, 0, sizeof(s_rowCols_lp));
+  }
+
+  uint32_t* maskRow(const uint32_t _row) const { return s_masks_lp[_row]; }
+
+  // row projection of a mask row filled through maskRow(), _points and _cols get its pixel count and the sum of its pixel columns
+  void addRow(const uint32_t _row, uint32_t& _points, uint32_t& _cols) const {
+    const uint32_t* restrict mask = s_masks_lp[_row];
+    uint32_t points = 0;
+    uint32_t cols = 0;
+    for (uint32_t word = 0; word < m_words; ++word) {
+      const uint32_t bits = mask[word];
+      const uint32_t count = popcount(bits);
+      // sum of set bit positions, bit k of a position is counted by the popcount of the matching stripes
+      const uint32_t positions = popcount(bits & 0xaaaaaaaa) + 2 * popcount(bits & 0xcccccccc) + 4 * popcount(bits & 0xf0f0f0f0) +
+                                 8 * popcount(bits & 0xff00ff00) + 16 * popcount(bits & 0xffff0000);
+      points += count;
+      cols += 32 * word * count + positions;
+    }
+    s_rowCounts_lp[_row] = points;
+    s_rowCols_lp[_row] = cols;
+    _points = points;
+    _cols = cols;
+  }
+
+  /*
+   * Classifies a crossing of the line over the sampled rows in [_rowBegin, _rowEnd), looking from the bottom of the frame.
+   * The longest run of bar rows is the crossing, its sides come from the column projection of the bar rows away from
+   * the line and the stems from line rows above and below it. _width gets the median of non-empty row counts.
+   */
+  trik_line_junction junction(const uint32_t _rowBegin, const uint32_t _rowEnd, const uint32_t _rowStride, uint32_t& _width, uint32_t& _barRow) const {
+    _width = 0;
+    _barRow = 0;
+    if (_rowBegin >= _rowEnd)
+      return TRIK_LINE_JUNCTION_NONE;
+
+    uint16_t histogram[IMG_WIDTH + 1];
+    memset(histogram, 0, sizeof(histogram));
+    uint32_t lineRows = 0;
+    for (uint32_t row = _rowBegin; row < _rowEnd; row += _rowStride)
+      if (s_rowCounts_lp[row] > 0) {
+        ++histogram[s_rowCounts_lp[row]];
+        ++lineRows;
+      }
+    if (lineRows == 0)
+      return TRIK_LINE_JUNCTION_NONE;
+    uint32_t median = 0;
+    for (uint32_t seen = 0; seen * 2 < lineRows; ++median)
+      seen += histogram[median + 1];
+    _width = median;
+
+    const uint32_t barPixels = median * JUNCTION_BAR_FACTOR > median + JUNCTION_MIN_BAR_PIXELS ? median * JUNCTION_BAR_FACTOR : median + JUNCTION_MIN_BAR_PIXELS;
+    uint32_t runBegin = 0;
+    uint32_t runRows = 0;
+    uint32_t barBegin = 0;
+    uint32_t barEnd = 0;
+    uint32_t barRows = 0;
+    for (uint32_t row = _rowBegin; row < _rowEnd; row += _rowStride) {
+      if (s_rowCounts_lp[row] < barPixels) {
+        runRows = 0;
+        continue;
+      }
+      if (runRows++ == 0)
+        runBegin = row;
+      if (runRows > barRows) {
+        barRows = runRows;
+        barBegin = runBegin;
+        barEnd = row + 1;
+      }
+    }
+    if (barRows == 0)
+      return TRIK_LINE_JUNCTION_NONE;
+    _barRow = (barBegin + barEnd) / 2;
+
+    uint32_t rowsAbove = 0;
+    uint32_t rowsBelow = 0;
+    for (uint32_t row = _rowBegin; row < _rowEnd; row += _rowStride)
+      if (s_rowCounts_lp[row] > 0 && s_rowCounts_lp[row] < barPixels) {
+        rowsAbove += row + median < barBegin;
+        rowsBelow += row >= barEnd + median;
+      }
+    const bool above = rowsAbove >= JUNCTION_MIN_STEM_ROWS;
+    const bool below = rowsBelow >= JUNCTION_MIN_STEM_ROWS;
+    if (!below)
+      return TRIK_LINE_JUNCTION_NONE;
+
+    // the stem enters the bar where the nearest line row below it is, a side counts when the bar reaches
+    // two line widths past the stem on average
+    uint32_t stemCol = 0;
+    const int32_t lastRow = _rowBegin + ((_rowEnd - 1 - _rowBegin) / _rowStride) * _rowStride;
+    const int32_t firstBelow = barBegin + ((barEnd - barBegin + _rowStride - 1) / _rowStride) * _rowStride;
+    lineCol(firstBelow, lastRow + _rowStride, _rowStride, barPixels, stemCol);
+    const uint32_t margin = 2 * median;
+    uint32_t leftPixels = 0;
+    uint32_t rightPixels = 0;
+    for (uint32_t row = barBegin; row < barEnd; row += _rowStride) {
+      leftPixels += stemCol > margin ? pixelsBefore(row, stemCol - margin) : 0;
+      rightPixels += s_rowCounts_lp[row] - pixelsBefore(row, stemCol + margin + 1);
+    }
+    const uint32_t sidePixels = barRows * 2 * median;
+    const bool left = leftPixels >= sidePixels;
+    const bool right = rightPixels >= sidePixels;
+
+    if (left && right)
+      return above ? TRIK_LINE_JUNCTION_CROSS : TRIK_LINE_JUNCTION_T;
+    if (left)
+      return above ? TRIK_LINE_JUNCTION_LEFT_BRANCH : TRIK_LINE_JUNCTION_LEFT_TURN;
+    if (right)
+      return above ? TRIK_LINE_JUNCTION_RIGHT_BRANCH : TRIK_LINE_JUNCTION_RIGHT_TURN;
+    return TRIK_LINE_JUNCTION_NONE;
+  }
+};
+
+}
+}
+
+#endif
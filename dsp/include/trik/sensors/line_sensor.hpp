@@ -11,7 +11,12 @@
 #include <cassert>
 #include <cmath>
 
+#include "floor_projection.hpp"
 #include "hsv_range_detector.hpp"
+#include "line_path.hpp"
+#include "lens_undistortion.hpp"
+#include "line_projection.hpp"
+#include "target_tracker.hpp"
 
 namespace trik {
 namespace sensors {
@@ -33,43 +38,40 @@ private:
   int32_t m_targetY;
   uint32_t m_targetPoints;
 
+  TargetTracker m_tracker;
+  LinePath m_path;
+  LineProjections m_projections;
+  FloorProjection m_floor;
+  LensUndistortion m_lens;
+
+  template <bool _preview>
   void proceedImageHsv(ImageBuffer& _outImage) {
-    const uint64_t* restrict rgb888hsvptr = s_rgb888hsv;
     const uint32_t width = m_inImageDesc.m_width;
-    const uint32_t height = m_inImageDesc.m_height;
-    const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
-    const uint64_t u64_hsv_range = m_detectRange;
-    const uint32_t u32_hsv_expect = m_detectExpected;
     uint32_t targetPointsPerRow;
     uint32_t targetPointsCol;
+    RoiSpan spans[TRIK_MAX_ROIS];
 
-    const uint32_t* restrict p_hi2ho = s_hi2ho;
     assert(m_inImageDesc.m_height % 4 == 0); // verified in setup
-#pragma MUST_ITERATE(4, , 4)
-    for (uint32_t srcRow = 0; srcRow < height; ++srcRow) {
-      const uint32_t dstRow = *(p_hi2ho++);
-      uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRow * dstLineLength);
-
+    for (uint32_t srcRow = m_roiRowBegin; srcRow < m_roiRowEnd; ++srcRow) {
       targetPointsPerRow = 0;
       targetPointsCol = 0;
-      const uint32_t* restrict p_wi2wo = s_wi2wo;
-      assert(m_inImageDesc.m_width % 32 == 0); // verified in setup
-#pragma MUST_ITERATE(32, , 32)
-      for (uint32_t srcCol = 0; srcCol < width; ++srcCol) {
-        const uint32_t dstCol = *(p_wi2wo++);
-        const uint64_t rgb888hsv = *rgb888hsvptr++;
-
-        bool det = false;
-        if (srcCol >= 5 && srcCol <= width - 5) {
-          det = detectHsvPixel(_loll(rgb888hsv), u64_hsv_range, u32_hsv_expect);
-          targetPointsPerRow += det;
-          targetPointsCol += det ? srcCol : 0;
-          writeOutputPixel(dstImageRow + dstCol, det ? 0x00ffff : _hill(rgb888hsv));
-        }
-      }
+      if (!isSampledRow(srcRow))
+        continue;
+      const uint32_t spanCount = roiRowSpans(srcRow, spans);
+
+      // detections are packed into one bit per pixel, counts and column sums come from the mask row
+      uint32_t* restrict mask = m_projections.maskRow(srcRow);
+      detectHsvRow<_preview>(_outImage, srcRow, spans, spanCount, m_detectRange, m_detectExpected, mask);
+
+      // columns next to the frame border are never counted
+      mask[0] &= ~0x1fu;
+      mask[width / 32 - 1] &= 0x0fffffffu;
+      m_projections.addRow(srcRow, targetPointsPerRow, targetPointsCol);
+
       m_targetX += targetPointsCol;
       m_targetY += srcRow * targetPointsPerRow;
       m_targetPoints += targetPointsPerRow;
+      m_path.addRow(srcRow, targetPointsPerRow, targetPointsCol);
       if (srcRow >= m_hStart && srcRow <= m_hStop)
         m_crossPoints += targetPointsPerRow;
     }
@@ -79,6 +81,12 @@ public:
   virtual bool setup(const ImageDesc& _inImageDesc, const ImageDesc& _outImageDesc, int8_t* _fastRam, size_t _fastRamSize) {
     if (!commonSetup(_inImageDesc, _outImageDesc, _fastRam, _fastRamSize))
       return false;
+    // the line crosses the whole frame, so windows are column bands
+    m_tracker.setup(m_inImageDesc.m_width, m_inImageDesc.m_height, m_inImageDesc.m_width / 8, m_inImageDesc.m_height);
+    m_path.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
+    m_projections.setup(m_inImageDesc.m_width);
+    m_floor.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
+    m_lens.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
     return true;
   }
 
@@ -90,6 +98,7 @@ public:
     _outImage.m_size = m_outImageDesc.m_height * m_outImageDesc.m_lineLength;
 
     m_targetX = 0;
+    m_targetY = 0;
     m_targetPoints = 0;
     m_crossPoints = 0;
 
@@ -104,6 +113,14 @@ public:
     uint32_t detectValTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_to) * 255) / 100, 255);     // scaling 0..100 to 0..255
     bool autoDetectHsv = static_cast<bool>(_inArgs.auto_detect_hsv);                                              // true or false
 
+    trik_cv_algorithm_in_args inArgs = _inArgs;
+    m_tracker.prepare(inArgs);
+    m_path.reset(inArgs);
+    m_projections.reset();
+    m_floor.configure(inArgs);
+    m_lens.configure(inArgs);
+    setupPreview(inArgs, _outImage);
+
     if (detectHueFrom <= detectHueTo) {
       m_detectRange = _itoll((detectValFrom << 16) | (detectSatFrom << 8) | detectHueFrom, (detectValTo << 16) | (detectSatTo << 8) | detectHueTo);
       m_detectExpected = 0x0;
@@ -117,56 +134,122 @@ public:
     const int hWidth = m_inImageDesc.m_width / 2;
     const int hHeight = m_inImageDesc.m_height / 2;
     const int step = 40;
+    m_hStart = hHeight;
+    m_hStop = hHeight + 2 * step;
 
 #ifdef DEBUG_REPEAT
     for (unsigned repeat = 0; repeat < DEBUG_REPEAT; ++repeat) {
 #endif
 
       if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0) {
+        // calibration samples the frame center, so it converts whole frames
+        if (autoDetectHsv) {
+          resetRois();
+          resetSampling();
+        } else {
+          setupRois(inArgs);
+          setupSampling(inArgs);
+        }
         convertImageYuyvToHsv(_inImage);
 
         if (autoDetectHsv) {
           HsvRangeDetector rangeDetector = HsvRangeDetector(m_inImageDesc.m_width, m_inImageDesc.m_height, step);
           rangeDetector.detect(_outArgs.detect_hue_from, _outArgs.detect_hue_to, _outArgs.detect_sat_from, _outArgs.detect_sat_to, _outArgs.detect_val_from,
             _outArgs.detect_val_to, s_rgb888hsv);
+          setupRois(inArgs);
+          setupSampling(inArgs);
         }
 
-        proceedImageHsv(_outImage);
+        if (m_previewImage) {
+          renderPreviewBackground(_inImage, _outImage, _outArgs.cycles);
+          proceedImageHsv<true>(_outImage);
+        } else
+          proceedImageHsv<false>(_outImage);
       }
 
 #ifdef DEBUG_REPEAT
     } // repeat
 #endif
 
-    drawRgbThinLine(hWidth - step, drawY, _outImage, 0xff00ff);
-    drawRgbThinLine(hWidth + step, drawY, _outImage, 0xff00ff);
-    drawRgbThinLine(hWidth - 2 * step, drawY, _outImage, 0xff00ff);
-    drawRgbThinLine(hWidth + 2 * step, drawY, _outImage, 0xff00ff);
-
-    m_hStart = hHeight;
-    m_hStop = hHeight + 2 * step;
-
-    int crossSize = static_cast<uint32_t>(m_crossPoints * 100) / (m_inImageDesc.m_width * 2 * step);
+    if (m_previewOverlay) {
+      drawRgbThinLine(hWidth - step, drawY, _outImage, 0xff00ff);
+      drawRgbThinLine(hWidth + step, drawY, _outImage, 0xff00ff);
+      drawRgbThinLine(hWidth - 2 * step, drawY, _outImage, 0xff00ff);
+      drawRgbThinLine(hWidth + 2 * step, drawY, _outImage, 0xff00ff);
+      drawRgbHorizontalLine(0, m_hStart, _outImage, 0xff0000);
+      drawRgbHorizontalLine(0, m_hStop, _outImage, 0xff0000);
+      drawRois(_outImage, 0xffff00);
+    }
 
-    drawRgbHorizontalLine(0, m_hStart, _outImage, 0xff0000);
-    drawRgbHorizontalLine(0, m_hStop, _outImage, 0xff0000);
+    // counts of sampled pixels are scaled up to the whole rows, centroids are taken over the samples as they are
+    const uint32_t targetPoints = estimateFullCount(m_targetPoints, m_roiRowBegin, m_roiRowEnd);
+    const uint32_t crossPoints = estimateFullCount(m_crossPoints, m_hStart, m_hStop + 1);
+    int crossSize = static_cast<uint32_t>(crossPoints * 100) / (m_inImageDesc.m_width * 2 * step);
+
+    uint32_t bandPoints[TRIK_MAX_LINE_BANDS];
+    for (uint32_t band = 0; band < m_path.bands(); ++band)
+      bandPoints[band] = estimateFullCount(m_path.bandPoints(band), m_path.bandRowBegin(band), m_path.bandRowBegin(band + 1));
+    trik_cv_algorithm_out_line_path& path = _outArgs.ext.line_path;
+    m_path.fit(bandPoints, m_lens, path);
+
+    uint32_t lineWidth;
+    uint32_t barRow;
+    path.junction = m_projections.junction(firstSampledRow(m_roiRowBegin), m_roiRowEnd, m_sampleStride, lineWidth, barRow);
+    path.width = range<uint32_t>(0, (lineWidth * (m_sampleCheckerboard ? 2 : 1) * 100) / m_inImageDesc.m_width, 100);
+    path.junction_y = path.junction == TRIK_LINE_JUNCTION_NONE ? 0 : (barRow * 100) / m_inImageDesc.m_height;
+    if (path.junction != TRIK_LINE_JUNCTION_NONE && m_previewOverlay)
+      drawRgbHorizontalLine(0, barRow, _outImage, 0x00ff00);
+    // dotted path in the output buffer, a polyline through the same points in a draw list
+    bool prevPoint = false;
+    int32_t prevCol = 0;
+    for (uint32_t row = 0; row < m_inImageDesc.m_height && m_previewOverlay; row += 2) {
+      int32_t col = 0;
+      const bool point = m_path.column(row, col);
+      if (point && m_drawList == NULL)
+        drawOutputPixelBound(col, row, 0, m_inImageDesc.m_width - 1, 0, m_inImageDesc.m_height - 1, _outImage, 0x00ff00);
+      else if (point && prevPoint)
+        drawOutputLine(prevCol, row - 2, col, row, _outImage, 0x00ff00);
+      prevPoint = point;
+      prevCol = col;
+    }
 
     _outArgs.targets[0].x = 0;
     _outArgs.targets[0].y = 0;
     _outArgs.targets[0].size = 0;
 
-    if (m_targetPoints > 10) {
+    const bool found = m_targetPoints > 0 && targetPoints > 10;
+    if (found) {
       const int32_t inImagePixels = m_inImageDesc.m_height * m_inImageDesc.m_width;
       const int32_t targetX = m_targetX / m_targetPoints;
 
       assert(m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0); // more or less safe since no target points would be detected otherwise
 
-      drawRgbTargetCenterLine(targetX, hHeight, _outImage, 0xff0000);
+      if (m_previewOverlay)
+        drawRgbTargetCenterLine(targetX, hHeight, _outImage, 0xff0000);
 
-      _outArgs.targets[0].x = ((targetX - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width);
+      // reported undistorted, the preview and the tracker stay in frame pixels
+      int32_t targetCol = targetX;
+      int32_t targetRow = m_targetY / m_targetPoints;
+      m_lens.undistort(targetCol, targetRow);
+      _outArgs.targets[0].x =
+        range<int32_t>(-100, ((targetCol - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width), 100);
       _outArgs.targets[0].y = crossSize;
-      _outArgs.targets[0].size = static_cast<uint32_t>(m_targetPoints * 100 * m_imageScaleCoeff) / inImagePixels;
+      _outArgs.targets[0].size = static_cast<uint32_t>(targetPoints * 100 * m_imageScaleCoeff) / inImagePixels;
+      m_floor.projectTarget(0, targetCol, targetRow, _outArgs.floor);
     }
+    for (uint32_t band = 0; band < m_path.bands() && m_floor.valid(); ++band) {
+      int32_t col;
+      int32_t row;
+      if (!m_path.centroid(band, col, row))
+        continue;
+      m_lens.undistort(col, row);
+      m_floor.projectPathPoint(band, col, row, _outArgs.floor);
+    }
+
+    // line half width is the mean count of detected pixels per row
+    const uint32_t rows = m_roiRowEnd - m_roiRowBegin;
+    m_tracker.update(inArgs, found, found ? m_targetX / m_targetPoints : 0, found ? m_targetY / m_targetPoints : 0, rows > 0 ? targetPoints / (2 * rows) : 0,
+      m_inImageDesc.m_height, _outArgs.tracker);
 
     return true;
   }
@@ -27,16 +27,81 @@ namespace sensors {
 #define CAMERA_NOISE_S16 0x0A00     /* SQ12.3 */
 #define THRESHOLD_FACTOR_S16 0x31ff /* SQ4.11 */
 
+#define ACTIVITY_PIXEL_NOISE 16 /* luma levels */
+#define ACTIVITY_DEFAULT_COLS 4
+#define ACTIVITY_DEFAULT_ROWS 4
+#define ACTIVITY_DEFAULT_THRESHOLD 5 /* percent of changed pixels */
+
+static uint16_t s_prevLuma_ms[IMG_WIDTH * IMG_HEIGHT / 2]; // two packed luma bytes per yuyv word
+
 class MotionSensorCvAlgorithm : public CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X> {
 private:
   uint64_t m_detectRange;
   uint32_t m_detectExpected;
-  uint32_t m_srcToDstShift;
 
   int32_t m_targetX;
   int32_t m_targetY;
   uint32_t m_targetPoints;
 
+  uint32_t m_activityCols;
+  uint32_t m_activityRows;
+  uint32_t m_activityColStart[TRIK_MAX_ACTIVITY_COLS + 1];
+  uint32_t m_activityRowStart[TRIK_MAX_ACTIVITY_ROWS + 1];
+  uint32_t m_activityPixels[TRIK_MAX_ACTIVITY_ROWS][TRIK_MAX_ACTIVITY_COLS];
+  uint8_t m_activityMask[TRIK_MAX_ACTIVITY_ROWS];
+  bool m_prevLumaValid;
+
+  void setupActivityGrid(const trik_cv_algorithm_in_args& _inArgs) {
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint32_t height = m_inImageDesc.m_height;
+    const uint32_t cols = _inArgs.activity_cols == 0 ? ACTIVITY_DEFAULT_COLS : range<uint32_t>(1, _inArgs.activity_cols, TRIK_MAX_ACTIVITY_COLS);
+    const uint32_t rows = _inArgs.activity_rows == 0 ? ACTIVITY_DEFAULT_ROWS : range<uint32_t>(1, _inArgs.activity_rows, TRIK_MAX_ACTIVITY_ROWS);
+
+    if (cols != m_activityCols || rows != m_activityRows)
+      memset(m_activityMask, 0, sizeof(m_activityMask));
+    m_activityCols = cols;
+    m_activityRows = rows;
+
+    // cells start on even columns since pixels are processed in yuyv pairs, last cell takes the remainder
+    const uint32_t cellWidth = (width / cols) & ~1u;
+    for (uint32_t col = 0; col < cols; ++col)
+      m_activityColStart[col] = col * cellWidth;
+    m_activityColStart[cols] = width;
+
+    const uint32_t cellHeight = height / rows;
+    for (uint32_t row = 0; row < rows; ++row)
+      m_activityRowStart[row] = row * cellHeight;
+    m_activityRowStart[rows] = height;
+
+    memset(m_activityPixels, 0, sizeof(m_activityPixels));
+  }
+
+  void reportActivity(const ImageBuffer& _outImage, const trik_cv_algorithm_in_args& _inArgs, trik_cv_algorithm_out_activity& _activity) {
+    const uint32_t threshold = _inArgs.activity_threshold == 0 ? ACTIVITY_DEFAULT_THRESHOLD : range<uint32_t>(1, _inArgs.activity_threshold, 100);
+
+    memset(&_activity, 0, sizeof(_activity));
+    _activity.cols = m_activityCols;
+    _activity.rows = m_activityRows;
+
+    for (uint32_t row = 0; row < m_activityRows; ++row) {
+      const uint32_t cellHeight = m_activityRowStart[row + 1] - m_activityRowStart[row];
+      for (uint32_t col = 0; col < m_activityCols; ++col) {
+        const uint32_t cellPixels = (m_activityColStart[col + 1] - m_activityColStart[col]) * cellHeight;
+        const uint32_t magnitude = m_prevLumaValid && cellPixels > 0 ? (m_activityPixels[row][col] * 100) / cellPixels : 0;
+        _activity.magnitude[row][col] = magnitude;
+        if (magnitude >= threshold) {
+          _activity.mask[row] |= 1u << col;
+          if (m_previewOverlay)
+            drawOutputRectangle(m_activityColStart[col], m_activityColStart[col + 1] - 1, m_activityRowStart[row], m_activityRowStart[row + 1] - 1,
+              _outImage, 0xff0000);
+        }
+      }
+    }
+
+    _activity.changed = memcmp(_activity.mask, m_activityMask, sizeof(m_activityMask)) != 0;
+    memcpy(m_activityMask, _activity.mask, sizeof(m_activityMask));
+  }
+
   bool testifyRgbPixel(const uint32_t _rgb888, uint32_t& _out_rgb888) const {
     const uint32_t u32_rgb_or16 = _unpkhu4(_rgb888);
     const uint32_t u32_rgb_gb16 = _unpklu4(_rgb888);
@@ -79,18 +144,24 @@ private:
     return true;
   }
 
-  void proceedRgbPixel(const uint32_t _srcRow, const uint32_t _srcCol, uint16_t* restrict _dstImagePix, const uint32_t _rgb888) {
+  // target pixels are highlighted over the preview background
+  template <bool _preview>
+  bool proceedRgbPixel(const uint32_t _srcRow, const uint32_t _srcCol, uint16_t* restrict _dstImagePix, const uint32_t _rgb888) {
     uint32_t out_rgb888 = _rgb888;
-    if (testifyRgbPixel(_rgb888, out_rgb888)) {
-      m_targetX += _srcCol;
-      m_targetY += _srcRow;
-      ++m_targetPoints;
-    }
+    if (!testifyRgbPixel(_rgb888, out_rgb888))
+      return false;
+    m_targetX += _srcCol;
+    m_targetY += _srcRow;
+    ++m_targetPoints;
 
-    writeOutputPixel(_dstImagePix, out_rgb888);
+    if (_preview)
+      writeOutputPixel(_dstImagePix, out_rgb888);
+    return true;
   }
 
-  void proceedTwoYuyvPixels(const uint32_t _srcRow, const uint32_t _srcCol1, const uint32_t _srcCol2, uint16_t* restrict _dstImagePix1,
+  // bit 0 and 1 are set for detected first and second pixels
+  template <bool _preview>
+  uint32_t proceedTwoYuyvPixels(const uint32_t _srcRow, const uint32_t _srcCol1, const uint32_t _srcCol2, uint16_t* restrict _dstImagePix1,
     uint16_t* restrict _dstImagePix2, const uint32_t _yuyv) {
     const int64_t s64_yuyv1 = _mpyu4ll(_yuyv,
       (static_cast<uint32_t>(static_cast<uint8_t>(409 / 4)) << 24) | (static_cast<uint32_t>(static_cast<uint8_t>(298 / 4)) << 16) |
@@ -110,15 +181,86 @@ private:
     const uint32_t u32_rgb_p1 = _spacku4(u32_rgb_p1h, u32_rgb_p1l);
     const uint32_t u32_rgb_p2 = _spacku4(u32_rgb_p2h, u32_rgb_p2l);
 
-    proceedRgbPixel(_srcRow, _srcCol1, _dstImagePix1, u32_rgb_p1);
+    const uint32_t det1 = proceedRgbPixel<_preview>(_srcRow, _srcCol1, _dstImagePix1, u32_rgb_p1);
+    const uint32_t det2 = proceedRgbPixel<_preview>(_srcRow, _srcCol2, _dstImagePix2, u32_rgb_p2);
+    return det1 | (det2 << 1);
+  }
 
-    proceedRgbPixel(_srcRow, _srcCol2, _dstImagePix2, u32_rgb_p2);
+  // activity over every pixel, color target over the sampled ones, with _preview the target is highlighted over the preview background
+  template <bool _preview>
+  void proceedImageYuyv(const ImageBuffer& _inImage, ImageBuffer& _outImage) {
+    const uint32_t height = m_inImageDesc.m_height;
+    const uint32_t srcLineLength = m_inImageDesc.m_lineLength;
+    const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
+
+    assert(m_inImageDesc.m_height % 4 == 0); // verified in setup
+    const uint32_t activityNoise = (ACTIVITY_PIXEL_NOISE << 8) | ACTIVITY_PIXEL_NOISE;
+    uint16_t* restrict prevLuma = s_prevLuma_ms;
+    uint32_t activityRow = 0;
+    for (uint32_t srcRow = 0; srcRow < height; ++srcRow) {
+      const uint32_t dstRow = s_hi2ho[srcRow];
+
+      const uint32_t srcRowOfs = srcRow * srcLineLength;
+      const uint32_t* restrict srcImage = reinterpret_cast<uint32_t*>(_inImage.m_ptr + srcRowOfs);
+
+      const uint32_t dstRowOfs = dstRow * dstLineLength;
+      uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRowOfs);
+
+      while (srcRow >= m_activityRowStart[activityRow + 1])
+        ++activityRow;
+      uint32_t* restrict activityPixels = m_activityPixels[activityRow];
+
+      // activity needs every pixel, the color target only the sampled ones
+      const bool sampledRow = isSampledRow(srcRow);
+      const uint32_t pairOffset = m_sampleCheckerboard ? samplePairOffset(srcRow) : 0;
+      const uint32_t pairMask = m_sampleCheckerboard ? 2 : 0;
+
+      assert(m_inImageDesc.m_width % 32 == 0); // verified in setup
+      uint32_t srcCol = 0;
+      for (uint32_t activityCol = 0; activityCol < m_activityCols; ++activityCol) {
+        const uint32_t activityColEnd = m_activityColStart[activityCol + 1];
+        uint32_t changedPixels = 0;
+        for (; srcCol < activityColEnd; srcCol += 2) {
+          const uint32_t yuyv = *srcImage++;
+
+          // frame difference on luma of both pixels, counted against camera noise
+          const uint32_t luma = _packl4(0, yuyv);
+          const uint32_t changed = _cmpgtu4(_subabs4(luma, *prevLuma), activityNoise);
+          *prevLuma++ = luma;
+          changedPixels += (changed & 0x1) + (changed >> 1);
+
+          const uint32_t dstCol1 = s_wi2wo[srcCol + 0];
+          const uint32_t dstCol2 = s_wi2wo[srcCol + 1];
+          uint16_t* restrict dstImagePix1 = &dstImageRow[dstCol1]; // even if they point the same place, we don't really care
+          uint16_t* restrict dstImagePix2 = &dstImageRow[dstCol2];
+          if (!sampledRow || (srcCol & pairMask) != pairOffset)
+            continue;
+          const uint32_t det = proceedTwoYuyvPixels<_preview>(srcRow, srcCol + 0, srcCol + 1, dstImagePix1, dstImagePix2, yuyv);
+          if (_preview && m_sampleCheckerboard) {
+            // skipped pair next to this one shows the same highlights
+            if (det & 0x1)
+              dstImageRow[s_wi2wo[(srcCol ^ 2) + 0]] = *dstImagePix1;
+            if (det & 0x2)
+              dstImageRow[s_wi2wo[(srcCol ^ 2) + 1]] = *dstImagePix2;
+          }
+        }
+        activityPixels[activityCol] += changedPixels;
+      }
+    }
   }
 
 public:
   virtual bool setup(const ImageDesc& _inImageDesc, const ImageDesc& _outImageDesc, int8_t* _fastRam, size_t _fastRamSize) {
     if (!commonSetup(_inImageDesc, _outImageDesc, _fastRam, _fastRamSize))
       return false;
+
+    if (_inImageDesc.m_width * _inImageDesc.m_height > IMG_WIDTH * IMG_HEIGHT)
+      return false;
+
+    m_activityCols = 0;
+    m_activityRows = 0;
+    memset(m_activityMask, 0, sizeof(m_activityMask));
+    m_prevLumaValid = false;
     return true;
   }
 
@@ -149,36 +291,20 @@ public:
       m_detectExpected = 0x1;
     }
 
+    setupActivityGrid(_inArgs);
+    setupSampling(_inArgs);
+    setupPreview(_inArgs, _outImage);
+
 #ifdef DEBUG_REPEAT
     for (unsigned repeat = 0; repeat < DEBUG_REPEAT; ++repeat) {
 #endif
 
       if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0) {
-        const uint32_t srcToDstShift = m_srcToDstShift;
-        const uint32_t width = m_inImageDesc.m_width;
-        const uint32_t height = m_inImageDesc.m_height;
-        const uint32_t srcLineLength = m_inImageDesc.m_lineLength;
-        const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
-
-        assert(m_inImageDesc.m_height % 4 == 0); // verified in setup
-        for (uint32_t srcRow = 0; srcRow < height; ++srcRow) {
-          const uint32_t dstRow = srcRow >> m_srcToDstShift;
-
-          const uint32_t srcRowOfs = srcRow * srcLineLength;
-          const uint32_t* restrict srcImage = reinterpret_cast<uint32_t*>(_inImage.m_ptr + srcRowOfs);
-
-          const uint32_t dstRowOfs = dstRow * dstLineLength;
-          uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRowOfs);
-
-          assert(m_inImageDesc.m_width % 32 == 0); // verified in setup
-          for (uint32_t srcCol = 0; srcCol < width; srcCol += 2) {
-            const uint32_t dstCol1 = (srcCol + 0) >> srcToDstShift;
-            const uint32_t dstCol2 = (srcCol + 1) >> srcToDstShift;
-            uint16_t* restrict dstImagePix1 = &dstImageRow[dstCol1]; // even if they point the same place, we don't really care
-            uint16_t* restrict dstImagePix2 = &dstImageRow[dstCol2];
-            proceedTwoYuyvPixels(srcRow, srcCol + 0, srcCol + 1, dstImagePix1, dstImagePix2, *srcImage++);
-          }
-        }
+        if (m_previewImage) {
+          renderPreviewBackground(_inImage, _outImage, _outArgs.cycles);
+          proceedImageYuyv<true>(_inImage, _outImage);
+        } else
+          proceedImageYuyv<false>(_inImage, _outImage);
       }
 
 #ifdef DEBUG_REPEAT
@@ -188,11 +314,13 @@ public:
     if (m_targetPoints > 0) {
       const int32_t targetX = m_targetX / m_targetPoints;
       const int32_t targetY = m_targetY / m_targetPoints;
+      const uint32_t targetPoints = estimateFullCount(m_targetPoints, 0, m_inImageDesc.m_height); // sampled pixels scaled up to the frame
 
       assert(m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0); // more or less safe since no target points would be detected otherwise
-      const uint32_t targetRadius = std::ceil(std::sqrt(static_cast<float>(m_targetPoints) / 3.1415927f));
+      const uint32_t targetRadius = std::ceil(std::sqrt(static_cast<float>(targetPoints) / 3.1415927f));
 
-      drawOutputCircle(targetX, targetY, targetRadius, _outImage, 0xffff00);
+      if (m_previewOverlay)
+        drawOutputCircle(targetX, targetY, targetRadius, _outImage, 0xffff00);
 
       _outArgs.targets[0].size = ((targetX - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width);
       _outArgs.targets[0].size = ((targetY - static_cast<int32_t>(m_inImageDesc.m_height) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_height);
@@ -203,6 +331,9 @@ public:
       _outArgs.targets[0].size = 0;
     }
 
+    reportActivity(_outImage, _inArgs, _outArgs.ext.activity);
+    m_prevLumaValid = true;
+
     return true;
   }
 };
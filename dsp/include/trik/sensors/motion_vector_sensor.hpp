@@ -0,0 +1,311 @@
+#ifndef TRIK_SENSORS_MOTION_VECTOR_SENSOR_HPP_
+#define TRIK_SENSORS_MOTION_VECTOR_SENSOR_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <c6x.h>
+#include <cassert>
+
+extern "C" {
+#include <ti/imglib/src/IMG_sad_16x16/IMG_sad_16x16.h>
+}
+
+namespace trik {
+namespace sensors {
+
+#define MV_BLOCK_SIZE 16
+#define MV_SEARCH_RANGE 7
+#define MV_VOTES_SIZE (2 * MV_SEARCH_RANGE + 1)
+
+static uint8_t s_lumaFrames_mv[2][IMG_WIDTH * IMG_HEIGHT] __attribute__((aligned(8)));
+static uint32_t s_block_mv[MV_BLOCK_SIZE * MV_BLOCK_SIZE / sizeof(uint32_t)]; // IMG_sad_16x16 wants a packed 32-bit aligned block
+static int8_t s_blockDx_mv[(IMG_WIDTH / MV_BLOCK_SIZE) * (IMG_HEIGHT / MV_BLOCK_SIZE)];
+static int8_t s_blockDy_mv[(IMG_WIDTH / MV_BLOCK_SIZE) * (IMG_HEIGHT / MV_BLOCK_SIZE)];
+static uint16_t s_votes_mv[MV_VOTES_SIZE][MV_VOTES_SIZE];
+
+class MotionVectorSensorCvAlgorithm : public CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X> {
+private:
+  static const int m_maxSearchSteps = 4;    // large diamond iterations per block
+  static const uint32_t m_staticSad = 512; // 2 levels per pixel, block is taken as static below it
+
+  uint8_t* m_currLuma;
+  uint8_t* m_prevLuma;
+  bool m_prevLumaValid;
+
+  uint32_t m_blockCols;
+  uint32_t m_blockRows;
+
+  int32_t m_globalDx;
+  int32_t m_globalDy;
+  uint32_t m_globalVotes;
+  uint32_t m_searchedBlocks;
+
+  bool __attribute__((always_inline)) isBlockInRois(const uint32_t _blockCol, const uint32_t _blockRow) const {
+    return insideRois(_blockCol * MV_BLOCK_SIZE + MV_BLOCK_SIZE / 2, _blockRow * MV_BLOCK_SIZE + MV_BLOCK_SIZE / 2);
+  }
+
+  bool __attribute__((always_inline)) isCandidateValid(const int32_t _col, const int32_t _row, const int32_t _dx, const int32_t _dy) const {
+    if (_dx < -MV_SEARCH_RANGE || _dx > MV_SEARCH_RANGE || _dy < -MV_SEARCH_RANGE || _dy > MV_SEARCH_RANGE)
+      return false;
+    return _col + _dx >= 0 && _col + _dx <= m_inImageDesc.m_width - MV_BLOCK_SIZE && _row + _dy >= 0 && _row + _dy <= m_inImageDesc.m_height - MV_BLOCK_SIZE;
+  }
+
+  uint32_t __attribute__((always_inline)) candidateSad(const int32_t _col, const int32_t _row, const int32_t _dx, const int32_t _dy) const {
+    const uint8_t* restrict ref = m_prevLuma + (_row + _dy) * m_inImageDesc.m_width + _col + _dx;
+    return IMG_sad_16x16(reinterpret_cast<const unsigned char*>(s_block_mv), ref, m_inImageDesc.m_width);
+  }
+
+  // diamond search of the block at (_col, _row) in the previous frame, returns the block motion
+  void searchBlock(const int32_t _col, const int32_t _row, int8_t& _dx, int8_t& _dy) {
+    static const int8_t s_largeDiamond[8][2] = { { 0, -2 }, { -1, -1 }, { 1, -1 }, { -2, 0 }, { 2, 0 }, { -1, 1 }, { 1, 1 }, { 0, 2 } };
+    static const int8_t s_smallDiamond[4][2] = { { 0, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 } };
+
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint8_t* restrict src = m_currLuma + _row * width + _col;
+    uint8_t* restrict block = reinterpret_cast<uint8_t*>(s_block_mv);
+#pragma MUST_ITERATE(16, 16, 16)
+    for (int r = 0; r < MV_BLOCK_SIZE; ++r) {
+      memcpy(block, src, MV_BLOCK_SIZE);
+      block += MV_BLOCK_SIZE;
+      src += width;
+    }
+
+    int32_t bestDx = 0;
+    int32_t bestDy = 0;
+    uint32_t bestSad = candidateSad(_col, _row, 0, 0);
+
+    if (bestSad > m_staticSad) {
+      // previous global motion is the usual answer, start from it when it beats zero
+      if ((m_globalDx != 0 || m_globalDy != 0) && isCandidateValid(_col, _row, -m_globalDx, -m_globalDy)) {
+        const uint32_t sad = candidateSad(_col, _row, -m_globalDx, -m_globalDy);
+        if (sad < bestSad) {
+          bestSad = sad;
+          bestDx = -m_globalDx;
+          bestDy = -m_globalDy;
+        }
+      }
+
+      for (int step = 0; step < m_maxSearchSteps; ++step) {
+        const int32_t centerDx = bestDx;
+        const int32_t centerDy = bestDy;
+        for (int i = 0; i < 8; ++i) {
+          const int32_t dx = centerDx + s_largeDiamond[i][0];
+          const int32_t dy = centerDy + s_largeDiamond[i][1];
+          if (!isCandidateValid(_col, _row, dx, dy))
+            continue;
+          const uint32_t sad = candidateSad(_col, _row, dx, dy);
+          if (sad < bestSad) {
+            bestSad = sad;
+            bestDx = dx;
+            bestDy = dy;
+          }
+        }
+        if (bestDx == centerDx && bestDy == centerDy)
+          break;
+      }
+
+      const int32_t centerDx = bestDx;
+      const int32_t centerDy = bestDy;
+      for (int i = 0; i < 4; ++i) {
+        const int32_t dx = centerDx + s_smallDiamond[i][0];
+        const int32_t dy = centerDy + s_smallDiamond[i][1];
+        if (!isCandidateValid(_col, _row, dx, dy))
+          continue;
+        const uint32_t sad = candidateSad(_col, _row, dx, dy);
+        if (sad < bestSad) {
+          bestSad = sad;
+          bestDx = dx;
+          bestDy = dy;
+        }
+      }
+    }
+
+    // the match offset points back into the previous frame, motion is the opposite
+    _dx = -bestDx;
+    _dy = -bestDy;
+  }
+
+  void searchImage() {
+    int8_t* restrict blockDx = s_blockDx_mv;
+    int8_t* restrict blockDy = s_blockDy_mv;
+    memset(s_votes_mv, 0, sizeof(s_votes_mv));
+    m_searchedBlocks = 0;
+
+    // blocks centered outside of ROIs are not searched and report no motion
+    for (uint32_t blockRow = 0; blockRow < m_blockRows; ++blockRow) {
+      for (uint32_t blockCol = 0; blockCol < m_blockCols; ++blockCol) {
+        if (isBlockInRois(blockCol, blockRow)) {
+          searchBlock(blockCol * MV_BLOCK_SIZE, blockRow * MV_BLOCK_SIZE, *blockDx, *blockDy);
+          ++s_votes_mv[*blockDy + MV_SEARCH_RANGE][*blockDx + MV_SEARCH_RANGE];
+          ++m_searchedBlocks;
+        } else {
+          *blockDx = 0;
+          *blockDy = 0;
+        }
+        ++blockDx;
+        ++blockDy;
+      }
+    }
+
+    // dominant motion is the mode of the block vectors
+    m_globalDx = 0;
+    m_globalDy = 0;
+    m_globalVotes = 0;
+    for (int dy = 0; dy < MV_VOTES_SIZE; ++dy)
+      for (int dx = 0; dx < MV_VOTES_SIZE; ++dx)
+        if (s_votes_mv[dy][dx] > m_globalVotes) {
+          m_globalVotes = s_votes_mv[dy][dx];
+          m_globalDx = dx - MV_SEARCH_RANGE;
+          m_globalDy = dy - MV_SEARCH_RANGE;
+        }
+  }
+
+  void fillField(trik_cv_algorithm_out_motion_vectors& _motionVectors) const {
+    int16_t sumDx[TRIK_MOTION_FIELD_ROWS][TRIK_MOTION_FIELD_COLS];
+    int16_t sumDy[TRIK_MOTION_FIELD_ROWS][TRIK_MOTION_FIELD_COLS];
+    int16_t blocks[TRIK_MOTION_FIELD_ROWS][TRIK_MOTION_FIELD_COLS];
+    memset(sumDx, 0, sizeof(sumDx));
+    memset(sumDy, 0, sizeof(sumDy));
+    memset(blocks, 0, sizeof(blocks));
+
+    const int8_t* restrict blockDx = s_blockDx_mv;
+    const int8_t* restrict blockDy = s_blockDy_mv;
+    for (uint32_t blockRow = 0; blockRow < m_blockRows; ++blockRow) {
+      const uint32_t fieldRow = (blockRow * TRIK_MOTION_FIELD_ROWS) / m_blockRows;
+      for (uint32_t blockCol = 0; blockCol < m_blockCols; ++blockCol) {
+        const uint32_t fieldCol = (blockCol * TRIK_MOTION_FIELD_COLS) / m_blockCols;
+        const int32_t dx = *blockDx++;
+        const int32_t dy = *blockDy++;
+        if (!isBlockInRois(blockCol, blockRow))
+          continue;
+        sumDx[fieldRow][fieldCol] += dx;
+        sumDy[fieldRow][fieldCol] += dy;
+        ++blocks[fieldRow][fieldCol];
+      }
+    }
+
+    for (int r = 0; r < TRIK_MOTION_FIELD_ROWS; ++r)
+      for (int c = 0; c < TRIK_MOTION_FIELD_COLS; ++c) {
+        _motionVectors.field[r][c].dx = blocks[r][c] ? sumDx[r][c] / blocks[r][c] : 0;
+        _motionVectors.field[r][c].dy = blocks[r][c] ? sumDy[r][c] / blocks[r][c] : 0;
+      }
+  }
+
+  void drawVectors(ImageBuffer& _outImage) const {
+    const int8_t* restrict blockDx = s_blockDx_mv;
+    const int8_t* restrict blockDy = s_blockDy_mv;
+    for (uint32_t blockRow = 0; blockRow < m_blockRows; ++blockRow)
+      for (uint32_t blockCol = 0; blockCol < m_blockCols; ++blockCol) {
+        const int32_t centerCol = blockCol * MV_BLOCK_SIZE + MV_BLOCK_SIZE / 2;
+        const int32_t centerRow = blockRow * MV_BLOCK_SIZE + MV_BLOCK_SIZE / 2;
+        const int32_t dx = *(blockDx++);
+        const int32_t dy = *(blockDy++);
+        if (isBlockInRois(blockCol, blockRow))
+          drawOutputLine(centerCol, centerRow, centerCol + dx, centerRow + dy, _outImage, 0xffff00);
+      }
+    drawRois(_outImage, 0x00ffff);
+
+    const int32_t hWidth = m_inImageDesc.m_width / 2;
+    const int32_t hHeight = m_inImageDesc.m_height / 2;
+    drawOutputLine(hWidth, hHeight, hWidth + 4 * m_globalDx, hHeight + 4 * m_globalDy, _outImage, 0xff0000);
+    drawFatPixel(hWidth + 4 * m_globalDx, hHeight + 4 * m_globalDy, _outImage, 0xff0000);
+  }
+
+public:
+  virtual bool setup(const ImageDesc& _inImageDesc, const ImageDesc& _outImageDesc, int8_t* _fastRam, size_t _fastRamSize) {
+    if (!commonSetup(_inImageDesc, _outImageDesc, _fastRam, _fastRamSize))
+      return false;
+    // rows below the last whole block are left out, binned 160x120 frames have 7.5 block rows
+    if (m_inImageDesc.m_width % MV_BLOCK_SIZE != 0 || m_inImageDesc.m_height < MV_BLOCK_SIZE)
+      return false;
+    if (m_inImageDesc.m_width > IMG_WIDTH || m_inImageDesc.m_height > IMG_HEIGHT)
+      return false;
+
+    m_blockCols = m_inImageDesc.m_width / MV_BLOCK_SIZE;
+    m_blockRows = m_inImageDesc.m_height / MV_BLOCK_SIZE;
+
+    m_currLuma = s_lumaFrames_mv[0];
+    m_prevLuma = s_lumaFrames_mv[1];
+    m_prevLumaValid = false;
+
+    m_globalDx = 0;
+    m_globalDy = 0;
+    m_globalVotes = 0;
+    m_searchedBlocks = 0;
+    return true;
+  }
+
+  virtual bool run(const ImageBuffer& _inImage, ImageBuffer& _outImage, const trik_cv_algorithm_in_args& _inArgs, trik_cv_algorithm_out_args& _outArgs) {
+    if (m_inImageDesc.m_height * m_inImageDesc.m_lineLength > _inImage.m_size)
+      return false;
+    if (m_outImageDesc.m_height * m_outImageDesc.m_lineLength > _outImage.m_size)
+      return false;
+    _outImage.m_size = m_outImageDesc.m_height * m_outImageDesc.m_lineLength;
+
+    trik_cv_algorithm_out_motion_vectors& motionVectors = _outArgs.ext.motion_vectors;
+    memset(&motionVectors, 0, sizeof(motionVectors));
+    setupRois(_inArgs);
+    setupPreview(_inArgs, _outImage);
+
+#ifdef DEBUG_REPEAT
+    for (unsigned repeat = 0; repeat < DEBUG_REPEAT; ++repeat) {
+#endif
+
+      if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0) {
+        // with a preview the chroma planes of the frame come along for its background, unless a sensor run before drew it
+        const bool previewBackground = m_previewImage && previewBackgroundPending();
+        if (previewBackground)
+          convertImageYuyvToPlanar(_inImage, m_currLuma, s_cb_pv, s_cr_pv);
+        else
+          convertImageYuyvToLuma(_inImage, m_currLuma);
+
+        if (m_prevLumaValid) {
+          searchImage();
+          fillField(motionVectors);
+        }
+
+        if (previewBackground)
+          renderPreviewPlanes(m_currLuma, s_cb_pv, s_cr_pv, _outImage, _outArgs.cycles);
+      }
+
+#ifdef DEBUG_REPEAT
+    } // repeat
+#endif
+
+    _outArgs.targets[0].x = 0;
+    _outArgs.targets[0].y = 0;
+    _outArgs.targets[0].size = 0;
+
+    if (m_prevLumaValid) {
+      if (m_previewOverlay)
+        drawVectors(_outImage);
+
+      motionVectors.global.dx = m_globalDx;
+      motionVectors.global.dy = m_globalDy;
+      motionVectors.global_support = m_searchedBlocks > 0 ? (m_globalVotes * 100) / m_searchedBlocks : 0;
+
+      _outArgs.targets[0].x = m_globalDx;
+      _outArgs.targets[0].y = m_globalDy;
+      _outArgs.targets[0].size = motionVectors.global_support;
+    }
+
+    uint8_t* swap = m_prevLuma;
+    m_prevLuma = m_currLuma;
+    m_currLuma = swap;
+    m_prevLumaValid = true;
+
+    return true;
+  }
+};
+
+}
+}
+
+#endif
@@ -66,39 +66,11 @@ private:
     }
   }
 
-  void proceedImageHsv(ImageBuffer& _outImage) {
-    const uint64_t* restrict rgb888hsvptr = s_rgb888hsv;
-    const uint32_t width = m_inImageDesc.m_width;
-    const uint32_t height = m_inImageDesc.m_height;
-    const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
-
-    const uint32_t* restrict p_hi2ho = s_hi2ho;
-    assert(m_inImageDesc.m_height % 4 == 0); // verified in setup
-#pragma MUST_ITERATE(4, , 4)
-    for (uint32_t srcRow = 0; srcRow < height; ++srcRow) {
-      const uint32_t dstRow = *(p_hi2ho++);
-      uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRow * dstLineLength);
-
-      const uint32_t* restrict p_wi2wo = s_wi2wo;
-      assert(m_inImageDesc.m_width % 32 == 0); // verified in setup
-#pragma MUST_ITERATE(32, , 32)
-      for (uint32_t srcCol = 0; srcCol < width; ++srcCol) {
-        const uint32_t dstCol = *(p_wi2wo++);
-        const uint64_t rgb888hsv = *rgb888hsvptr++;
-        writeOutputPixel(dstImageRow + dstCol, _hill(rgb888hsv));
-      }
-    }
-  }
-
+  // cell color box in the cell corner, no larger than the cell so dense grids paint every pixel once
   void __attribute__((always_inline)) fillImage(uint16_t _row, uint16_t _col, const ImageBuffer& _outImage, const uint32_t _rgb888) {
-    const uint16_t widthBot = 0;
-    const uint16_t widthTop = m_inImageDesc.m_width - 1;
-    const uint16_t heightBot = 0;
-    const uint16_t heightTop = m_inImageDesc.m_height - 1;
-
-    for (int row = _row; row < _row + 20; ++row)
-      for (int col = _col; col < _col + 20; ++col)
-        drawOutputPixelBound(col, row, widthBot, widthTop, heightBot, heightTop, _outImage, _rgb888);
+    const int32_t boxWidth = m_widthStep < 20 ? m_widthStep : 20;
+    const int32_t boxHeight = m_heightStep < 20 ? m_heightStep : 20;
+    fillOutputBox(_col, _col + boxWidth, _row, _row + boxHeight, _outImage, _rgb888);
   }
 
   uint32_t __attribute__((always_inline)) GetImgColor(int _rowStart, int _heightStep, int _colStart, int _widthStep) {
@@ -286,6 +258,7 @@ public:
     m_widthN = _inArgs.width_n;
     m_widthStep = m_inImageDesc.m_width / m_widthN;
     m_heightStep = m_inImageDesc.m_height / m_heightM;
+    setupPreview(_inArgs, _outImage);
 
 #ifdef DEBUG_REPEAT
     for (unsigned repeat = 0; repeat < DEBUG_REPEAT; ++repeat) {
@@ -293,7 +266,8 @@ public:
 
       if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0) {
         convertImageYuyvToHsv(_inImage);
-        proceedImageHsv(_outImage);
+        if (m_previewImage)
+          renderPreviewBackground(_inImage, _outImage, _outArgs.cycles);
       }
 
 #ifdef DEBUG_REPEAT
@@ -309,7 +283,8 @@ public:
       int colStart = 0;
       for (int j = 0; j < m_widthN; ++j) {
         resColor = GetImgColor2(rowStart, colStart, m_heightStep, m_widthStep);
-        fillImage(rowStart, colStart, _outImage, resColor);
+        if (m_previewOverlay)
+          fillImage(rowStart, colStart, _outImage, resColor);
         //_outArgs.outColor[counter++] = resColor;
         colStart += m_widthStep;
       }
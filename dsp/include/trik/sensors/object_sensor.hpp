@@ -25,7 +25,10 @@
 
 #include "bitmap_builder.hpp"
 #include "clusterizer.hpp"
+#include "floor_projection.hpp"
 #include "hsv_range_detector.hpp"
+#include "lens_undistortion.hpp"
+#include "target_tracker.hpp"
 
 namespace trik {
 namespace sensors {
@@ -63,36 +66,34 @@ private:
   ImageDesc m_inRgb888HsvImgDesc;
   ImageBuffer m_inRgb888HsvImg;
 
-  void proceedImageHsv(ImageBuffer& _outImage) {
-    const uint64_t* restrict rgb888hsvptr = s_rgb888hsv;
+  TargetTracker m_tracker;
+  FloorProjection m_floor;
+  LensUndistortion m_lens;
 
-    const uint32_t width = m_inImageDesc.m_width;
-    const uint32_t height = m_inImageDesc.m_height;
+  // detected clusters highlighted over the preview background
+  void highlightClusters(ImageBuffer& _outImage) {
     const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
+    RoiSpan spans[TRIK_MAX_ROIS];
 
-    const int32_t* restrict p_hi2ho_out = s_hi2ho_out;
-    const int32_t* restrict p_hi2ho_cstr = s_hi2ho_cstr;
-    assert(m_outImageDesc.m_height % 4 == 0); // verified in setup
-#pragma MUST_ITERATE(4, , 4)
-    for (uint32_t srcRow = 0; srcRow < height; srcRow++) {
-      const uint32_t dstRow = *(p_hi2ho_out++);
-      const uint32_t cstrRow = *(p_hi2ho_cstr++);
+    for (uint32_t srcRow = m_roiRowBegin; srcRow < m_roiRowEnd; srcRow++) {
+      const uint32_t dstRow = s_hi2ho_out[srcRow];
+      const uint32_t cstrRow = s_hi2ho_cstr[srcRow];
 
       uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRow * dstLineLength);
       uint16_t* restrict clustermapRow = reinterpret_cast<uint16_t*>(s_clustermap + cstrRow * m_clustermapDesc.m_width);
 
-      const int32_t* restrict p_wi2wo_out = s_wi2wo_out;
-      const int32_t* restrict p_wi2wo_cstr = s_wi2wo_cstr;
-#pragma MUST_ITERATE(32, , 32)
-      for (uint32_t srcCol = 0; srcCol < width; srcCol++) {
-        const uint32_t dstCol = *(p_wi2wo_out++);
-        const uint32_t cstrCol = *(p_wi2wo_cstr++);
-        const uint64_t rgb888hsv = *rgb888hsvptr++;
-
-        uint16_t clusterNum = m_clusterizer.getMinEqCluster(*(clustermapRow + cstrCol));
-        const bool det = clusterNum;
-
-        writeOutputPixel(dstImageRow + dstCol, det ? 0x00ffff : _hill(rgb888hsv));
+      const uint32_t spanCount = roiRowSpans(srcRow, spans);
+      for (uint32_t span = 0; span < spanCount; ++span) {
+        const int32_t* restrict p_wi2wo_out = s_wi2wo_out + spans[span].m_begin;
+        const int32_t* restrict p_wi2wo_cstr = s_wi2wo_cstr + spans[span].m_begin;
+#pragma MUST_ITERATE(8, , 8)
+        for (uint32_t srcCol = spans[span].m_begin; srcCol < spans[span].m_end; srcCol++) {
+          const uint32_t dstCol = *(p_wi2wo_out++);
+          const uint32_t cstrCol = *(p_wi2wo_cstr++);
+
+          if (m_clusterizer.getMinEqCluster(*(clustermapRow + cstrCol)))
+            writeOutputPixel(dstImageRow + dstCol, 0x00ffff);
+        }
       }
     }
   }
@@ -127,6 +128,10 @@ public:
     m_clustermap.m_ptr = reinterpret_cast<int8_t*>(s_clustermap);
     m_clustermap.m_size = IMG_WIDTH * IMG_HEIGHT * sizeof(uint16_t);
 
+    m_tracker.setup(m_inImageDesc.m_width, m_inImageDesc.m_height, m_inImageDesc.m_width / 8, m_inImageDesc.m_height / 8);
+    m_floor.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
+    m_lens.setup(m_inImageDesc.m_width, m_inImageDesc.m_height);
+
 #define min(x, y) x < y ? x : y;
     const double srcToDstShift =
       min(static_cast<double>(m_outImageDesc.m_width) / m_inImageDesc.m_width, static_cast<double>(m_outImageDesc.m_height) / m_inImageDesc.m_height);
@@ -164,24 +169,39 @@ public:
     memset(s_clustermap, 0x00, m_clustermapDesc.m_width * m_clustermapDesc.m_height * sizeof(uint16_t));
     memset(s_bitmap, 0x00, m_bitmapDesc.m_width * m_bitmapDesc.m_height * sizeof(uint16_t));
 
+    trik_cv_algorithm_in_args inArgs = _inArgs;
+    m_tracker.prepare(inArgs);
+    m_floor.configure(inArgs);
+    m_lens.configure(inArgs);
+    setupPreview(inArgs, _outImage);
+
 #ifdef DEBUG_REPEAT
     for (unsigned repeat = 0; repeat < DEBUG_REPEAT; ++repeat) {
 #endif
 
       if (m_inImageDesc.m_height > 0 && m_inImageDesc.m_width > 0) {
+        // calibration samples the frame center, so it converts whole frames
+        bool autoDetectHsv = static_cast<bool>(_inArgs.auto_detect_hsv); // true or false
+        if (autoDetectHsv)
+          resetRois();
+        else
+          setupRois(inArgs);
         convertImageYuyvToHsv(_inImage);
 
-        bool autoDetectHsv = static_cast<bool>(_inArgs.auto_detect_hsv); // true or false
         if (autoDetectHsv) {
           HsvRangeDetector rangeDetector = HsvRangeDetector(m_inImageDesc.m_width, m_inImageDesc.m_height, m_detectZoneScale);
           rangeDetector.detect(_outArgs.detect_hue_from, _outArgs.detect_hue_to, _outArgs.detect_sat_from, _outArgs.detect_sat_to, _outArgs.detect_val_from,
             _outArgs.detect_val_to, s_rgb888hsv);
+          setupRois(inArgs);
         }
 
-        m_bitmapBuilder.run(m_inRgb888HsvImg, m_bitmap, _inArgs, _outArgs);
-        m_clusterizer.run(m_bitmap, m_clustermap, _inArgs, _outArgs);
+        m_bitmapBuilder.run(m_inRgb888HsvImg, m_bitmap, inArgs, _outArgs);
+        m_clusterizer.run(m_bitmap, m_clustermap, inArgs, _outArgs);
 
-        proceedImageHsv(_outImage);
+        if (m_previewImage) {
+          renderPreviewBackground(_inImage, _outImage, _outArgs.cycles);
+          highlightClusters(_outImage);
+        }
       }
 
 #ifdef DEBUG_REPEAT
@@ -193,15 +213,18 @@ public:
     const int hHeight = m_inImageDesc.m_height / 2;
     const int hWidth = m_inImageDesc.m_width / 2;
 
-    drawRgbTargetCenterLine(hWidth - step, hHeight, _outImage, 0xff00ff);
-    drawRgbTargetCenterLine(hWidth + step, hHeight, _outImage, 0xff00ff);
-    drawRgbTargetCenterLine(hWidth - 2 * step, hHeight, _outImage, 0xff00ff);
-    drawRgbTargetCenterLine(hWidth + 2 * step, hHeight, _outImage, 0xff00ff);
-
-    drawRgbTargetHorizontalCenterLine(hWidth, hHeight - step, _outImage, 0xff00ff);
-    drawRgbTargetHorizontalCenterLine(hWidth, hHeight + step, _outImage, 0xff00ff);
-    drawRgbTargetHorizontalCenterLine(hWidth, hHeight - 2 * step, _outImage, 0xff00ff);
-    drawRgbTargetHorizontalCenterLine(hWidth, hHeight + 2 * step, _outImage, 0xff00ff);
+    if (m_previewOverlay) {
+      drawRgbTargetCenterLine(hWidth - step, hHeight, _outImage, 0xff00ff);
+      drawRgbTargetCenterLine(hWidth + step, hHeight, _outImage, 0xff00ff);
+      drawRgbTargetCenterLine(hWidth - 2 * step, hHeight, _outImage, 0xff00ff);
+      drawRgbTargetCenterLine(hWidth + 2 * step, hHeight, _outImage, 0xff00ff);
+
+      drawRgbTargetHorizontalCenterLine(hWidth, hHeight - step, _outImage, 0xff00ff);
+      drawRgbTargetHorizontalCenterLine(hWidth, hHeight + step, _outImage, 0xff00ff);
+      drawRgbTargetHorizontalCenterLine(hWidth, hHeight - 2 * step, _outImage, 0xff00ff);
+      drawRgbTargetHorizontalCenterLine(hWidth, hHeight + 2 * step, _outImage, 0xff00ff);
+      drawRois(_outImage, 0xffff00);
+    }
 
     // memset(_outArgs.target, 0, 8*sizeof(XDAS_Target));
     m_clustersAmount = m_clusterizer.getClustersAmount();
@@ -216,11 +239,14 @@ public:
         int x = m_clusterizer.getX(i);
         int y = m_clusterizer.getY(i);
 
-        drawFatPixel(x, y, _outImage, 0xff0000);
+        if (m_previewOverlay)
+          drawFatPixel(x, y, _outImage, 0xff0000);
+        m_lens.undistort(x, y);
 
         _outArgs.targets[i].size = size;
-        _outArgs.targets[i].x = ((x - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width);
-        _outArgs.targets[i].y = ((y - static_cast<int32_t>(m_inImageDesc.m_height) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_height);
+        _outArgs.targets[i].x = range<int32_t>(-100, ((x - static_cast<int32_t>(m_inImageDesc.m_width) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_width), 100);
+        _outArgs.targets[i].y = range<int32_t>(-100, ((y - static_cast<int32_t>(m_inImageDesc.m_height) / 2) * 100 * 2) / static_cast<int32_t>(m_inImageDesc.m_height), 100);
+        m_floor.projectTarget(i, x, y, _outArgs.floor);
       }
     }
 
@@ -230,6 +256,11 @@ public:
       _outArgs.targets[0].size = 0;
     }
 
+    // the largest cluster is tracked, clusters are taken as squares of their metapixel count
+    const uint32_t trackedHalfSize = static_cast<uint32_t>(std::sqrt(static_cast<float>(m_clusterizer.getSize(0)))) * METAPIX_SIZE / 2;
+    m_tracker.update(inArgs, !noObjects, noObjects ? 0 : m_clusterizer.getX(0), noObjects ? 0 : m_clusterizer.getY(0), trackedHalfSize, trackedHalfSize,
+      _outArgs.tracker);
+
     return true;
   }
 };
@@ -0,0 +1,161 @@
+#ifndef TRIK_SENSORS_TARGET_TRACKER_HPP_
+#define TRIK_SENSORS_TARGET_TRACKER_HPP_
+
+#ifndef __cplusplus
+#error C++-only header
+#endif
+
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include <stdint.h>
+#include <string.h>
+
+namespace trik {
+namespace sensors {
+
+#define TRACKER_ALPHA_Q8 128       // position gain 0.5
+#define TRACKER_BETA_Q8 43         // velocity gain 1/6, Benedict-Bordner alpha^2 / (2 - alpha) for the alpha above
+#define TRACKER_DEFAULT_MAX_MISSES 5
+
+/*
+ * Alpha-beta filter over the target position in Q8 pixels. While locked it proposes a search window around the
+ * predicted position, the window doubles on every miss and the tracker falls back to full frame scans after
+ * too many misses in a row.
+ */
+class TargetTracker {
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_minHalfWidth;
+  uint32_t m_minHalfHeight;
+
+  int32_t m_x; // Q8 pixels
+  int32_t m_y;
+  int32_t m_vx; // Q8 pixels per frame
+  int32_t m_vy;
+  uint32_t m_halfWidth;
+  uint32_t m_halfHeight;
+  uint32_t m_misses;
+  bool m_locked;
+  bool m_windowed; // current frame is searched in the window
+
+  static uint32_t grow(const uint32_t _half, const uint32_t _limit) { return 2 * _half < _limit ? 2 * _half : _limit; }
+
+public:
+  TargetTracker()
+    : m_width(0)
+    , m_height(0)
+    , m_minHalfWidth(0)
+    , m_minHalfHeight(0) {
+    reset();
+  }
+
+  // windows never get smaller than _minHalfWidth x _minHalfHeight around the prediction
+  void setup(const uint32_t _width, const uint32_t _height, const uint32_t _minHalfWidth, const uint32_t _minHalfHeight) {
+    m_width = _width;
+    m_height = _height;
+    m_minHalfWidth = _minHalfWidth;
+    m_minHalfHeight = _minHalfHeight;
+    reset();
+  }
+
+  void reset() {
+    m_x = 0;
+    m_y = 0;
+    m_vx = 0;
+    m_vy = 0;
+    m_halfWidth = m_minHalfWidth;
+    m_halfHeight = m_minHalfHeight;
+    m_misses = 0;
+    m_locked = false;
+    m_windowed = false;
+  }
+
+  // replaces the ROIs of _inArgs with the window around the predicted position, leaves them alone while unlocked
+  void prepare(trik_cv_algorithm_in_args& _inArgs) {
+    m_windowed = _inArgs.track_target && m_locked;
+    if (!_inArgs.track_target)
+      reset();
+    if (!m_windowed)
+      return;
+
+    const int32_t predictedX = (m_x + m_vx) >> 8;
+    const int32_t predictedY = (m_y + m_vy) >> 8;
+    const int32_t colBegin = range<int32_t>(0, predictedX - static_cast<int32_t>(m_halfWidth), m_width);
+    const int32_t colEnd = range<int32_t>(0, predictedX + static_cast<int32_t>(m_halfWidth), m_width);
+    const int32_t rowBegin = range<int32_t>(0, predictedY - static_cast<int32_t>(m_halfHeight), m_height);
+    const int32_t rowEnd = range<int32_t>(0, predictedY + static_cast<int32_t>(m_halfHeight), m_height);
+
+    _inArgs.roi_count = 1;
+    _inArgs.rois[0].x = colBegin;
+    _inArgs.rois[0].y = rowBegin;
+    _inArgs.rois[0].width = colEnd > colBegin ? colEnd - colBegin : 1;
+    _inArgs.rois[0].height = rowEnd > rowBegin ? rowEnd - rowBegin : 1;
+  }
+
+  // feeds the measurement of the frame searched after prepare(), _halfWidth and _halfHeight are the target extent
+  void update(const trik_cv_algorithm_in_args& _inArgs, const bool _found, const int32_t _x, const int32_t _y, const uint32_t _halfWidth,
+    const uint32_t _halfHeight, trik_cv_algorithm_out_tracker& _out) {
+    memset(&_out, 0, sizeof(_out));
+    if (!_inArgs.track_target)
+      return;
+
+    _out.mode = m_windowed ? TRIK_TRACKER_WINDOW : TRIK_TRACKER_FULL;
+    _out.window = _inArgs.rois[0];
+    if (!m_windowed) {
+      _out.window.x = 0;
+      _out.window.y = 0;
+      _out.window.width = m_width;
+      _out.window.height = m_height;
+    }
+
+    if (_found) {
+      if (m_locked) {
+        const int32_t residualX = (_x << 8) - (m_x + m_vx);
+        const int32_t residualY = (_y << 8) - (m_y + m_vy);
+        m_x += m_vx + ((residualX * TRACKER_ALPHA_Q8) >> 8);
+        m_y += m_vy + ((residualY * TRACKER_ALPHA_Q8) >> 8);
+        m_vx += (residualX * TRACKER_BETA_Q8) >> 8;
+        m_vy += (residualY * TRACKER_BETA_Q8) >> 8;
+      } else {
+        m_x = _x << 8;
+        m_y = _y << 8;
+        m_vx = 0;
+        m_vy = 0;
+        m_locked = true;
+      }
+
+      // room for the target itself plus one frame of motion
+      const uint32_t halfWidth = 2 * _halfWidth + (_abs(m_vx) >> 8);
+      const uint32_t halfHeight = 2 * _halfHeight + (_abs(m_vy) >> 8);
+      m_halfWidth = halfWidth > m_minHalfWidth ? halfWidth : m_minHalfWidth;
+      m_halfHeight = halfHeight > m_minHalfHeight ? halfHeight : m_minHalfHeight;
+      m_misses = 0;
+    } else if (m_locked) {
+      // coast on the prediction with a wider window
+      const uint32_t maxMisses = _inArgs.track_max_misses == 0 ? TRACKER_DEFAULT_MAX_MISSES : _inArgs.track_max_misses;
+      m_x += m_vx;
+      m_y += m_vy;
+      m_halfWidth = grow(m_halfWidth, m_width);
+      m_halfHeight = grow(m_halfHeight, m_height);
+      if (++m_misses > maxMisses) {
+        const uint32_t misses = m_misses;
+        reset();
+        m_misses = misses;
+      }
+    } else
+      ++m_misses;
+
+    _out.misses = m_misses < 255 ? m_misses : 255;
+    _out.locked = m_locked;
+    _out.x = m_x >> 8;
+    _out.y = m_y >> 8;
+    _out.velocity_x = m_vx >> 4;
+    _out.velocity_y = m_vy >> 4;
+  }
+};
+
+}
+}
+
+#endif
@@ -2,6 +2,8 @@
 
 #include <trik/sensors/cv_algorithms.hpp>
 
+#include <xdc/runtime/Timestamp.h>
+
 namespace trik {
 namespace sensors {
 
@@ -12,20 +14,73 @@ EdgeLineSensorCvAlgorithm edgeLineSensorCvAlgorithm;
 ObjectSensorCvAlgorithm objectSensorCvAlgorithm;
 LineSensorCvAlgorithm lineSensorCvAlgorithm;
 MxnSensorCvAlgorithm mxnSensorCvAlgorithm;
+MotionVectorSensorCvAlgorithm motionVectorSensorCvAlgorithm;
+LaneSensorCvAlgorithm laneSensorCvAlgorithm;
+FrameChangeDetector frameChangeDetector;
+Binning2x2 binning;
+bool binnedFrames = false;
+uint32_t previewScale = 1;
 
-extern "C" int trik_init_cv_algorithm(enum trik_cv_algorithm algorithm) {
-  ImageDesc inDesc = {
-    .m_width = IMG_WIDTH,
-    .m_height = IMG_HEIGHT,
-    .m_lineLength = IMG_WIDTH * 2,
-    .m_format = VideoFormat::YUV422,
-  };
-  ImageDesc outDesc = {
-    .m_width = IMG_WIDTH,
-    .m_height = IMG_HEIGHT,
-    .m_lineLength = IMG_WIDTH * 2,
-    .m_format = VideoFormat::RGB565X,
-  };
+// ROIs are given in full frame pixels, halved outwards for binned frames
+static void scaleInArgsToBinned(trik_cv_algorithm_in_args& _inArgs) {
+  for (uint32_t i = 0; i < TRIK_MAX_ROIS; ++i) {
+    trik_cv_algorithm_roi& roi = _inArgs.rois[i];
+    const uint32_t colEnd = (roi.x + roi.width + 1) / 2;
+    const uint32_t rowEnd = (roi.y + roi.height + 1) / 2;
+    roi.x /= 2;
+    roi.y /= 2;
+    roi.width = colEnd - roi.x;
+    roi.height = rowEnd - roi.y;
+  }
+}
+
+// percentages need no scaling, pixel results are doubled back to full frame
+static void scaleOutArgsToFullFrame(enum trik_cv_algorithm _algorithm, trik_cv_algorithm_out_args& _outArgs) {
+  trik_cv_algorithm_out_tracker& tracker = _outArgs.tracker;
+  tracker.x *= 2;
+  tracker.y *= 2;
+  tracker.velocity_x *= 2;
+  tracker.velocity_y *= 2;
+  tracker.window.x *= 2;
+  tracker.window.y *= 2;
+  tracker.window.width *= 2;
+  tracker.window.height *= 2;
+
+  if (_algorithm == TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR) {
+    trik_cv_algorithm_out_motion_vectors& motionVectors = _outArgs.ext.motion_vectors;
+    motionVectors.global.dx *= 2;
+    motionVectors.global.dy *= 2;
+    for (uint32_t row = 0; row < TRIK_MOTION_FIELD_ROWS; ++row)
+      for (uint32_t col = 0; col < TRIK_MOTION_FIELD_COLS; ++col) {
+        motionVectors.field[row][col].dx *= 2;
+        motionVectors.field[row][col].dy *= 2;
+      }
+    _outArgs.targets[0].x = motionVectors.global.dx;
+    _outArgs.targets[0].y = motionVectors.global.dy;
+  } else if (_algorithm == TRIK_CV_ALGORITHM_EDGE_LINE_SENSOR) {
+    trik_cv_algorithm_out_edge_line& edgeLine = _outArgs.ext.edge_line;
+    for (uint32_t i = 0; i < edgeLine.line_count; ++i)
+      edgeLine.lines[i].rho *= 2;
+    for (uint32_t i = 0; i < edgeLine.corner_count; ++i) {
+      edgeLine.corners[i].x *= 2;
+      edgeLine.corners[i].y *= 2;
+    }
+  }
+}
+
+// commands are drawn in binned pixels, the ARM draws them over the full frame
+static void scaleDrawListToFullFrame(trik_cv_algorithm_draw_list& _drawList) {
+  for (uint32_t i = 0; i < _drawList.count; ++i) {
+    trik_cv_algorithm_draw_cmd& cmd = _drawList.cmds[i];
+    cmd.x0 *= 2;
+    cmd.y0 *= 2;
+    cmd.x1 *= 2;
+    cmd.y1 *= 2;
+    cmd.width *= 2;
+  }
+}
+
+static int setupCvAlgorithm(enum trik_cv_algorithm algorithm, const ImageDesc& inDesc, const ImageDesc& outDesc) {
   if (algorithm == TRIK_CV_ALGORITHM_MOTION_SENSOR)
     return motionSensorCvAlgorithm.setup(inDesc, outDesc, fastRam, sizeof(fastRam) / sizeof(fastRam[0]));
   else if (algorithm == TRIK_CV_ALGORITHM_EDGE_LINE_SENSOR)
@@ -36,27 +91,142 @@ extern "C" int trik_init_cv_algorithm(enum trik_cv_algorithm algorithm) {
     return lineSensorCvAlgorithm.setup(inDesc, outDesc, fastRam, sizeof(fastRam) / sizeof(fastRam[0]));
   else if (algorithm == TRIK_CV_ALGORITHM_MXN_SENSOR)
     return mxnSensorCvAlgorithm.setup(inDesc, outDesc, fastRam, sizeof(fastRam) / sizeof(fastRam[0]));
+  else if (algorithm == TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR)
+    return motionVectorSensorCvAlgorithm.setup(inDesc, outDesc, fastRam, sizeof(fastRam) / sizeof(fastRam[0]));
+  else if (algorithm == TRIK_CV_ALGORITHM_LANE_SENSOR)
+    return laneSensorCvAlgorithm.setup(inDesc, outDesc, fastRam, sizeof(fastRam) / sizeof(fastRam[0]));
   else
     return 0;
 }
 
-extern "C" int trik_run_cv_algorithm(enum trik_cv_algorithm algorithm, struct buffer in_buffer, struct buffer out_buffer,
-  struct trik_cv_algorithm_in_args in_args, struct trik_cv_algorithm_out_args* out_args) {
-  ImageBuffer inBuffer = { .m_ptr = (int8_t*) in_buffer.start, .m_size = in_buffer.length };
-  ImageBuffer outBuffer = { .m_ptr = (int8_t*) out_buffer.start, .m_size = out_buffer.length };
+extern "C" int trik_init_cv_algorithm(uint32_t cv_algorithms, bool binned, uint8_t preview_scale) {
+  if (cv_algorithms == 0 || (cv_algorithms & ~TRIK_CV_ALGORITHM_ALL) != 0)
+    return 0;
+  binnedFrames = binned;
+  previewScale = preview_scale > 1 ? preview_scale : 1;
+  /*
+   * Binned sensors render a half size preview into the full frame buffer, upscaled after every run. A reduced preview
+   * is 1/previewScale of the full frame whether frames are binned or not, its rows follow each other and it is never upscaled.
+   */
+  ImageDesc inDesc = {
+    .m_width = static_cast<uint16_t>(binned ? IMG_WIDTH / 2 : IMG_WIDTH),
+    .m_height = static_cast<uint16_t>(binned ? IMG_HEIGHT / 2 : IMG_HEIGHT),
+    .m_lineLength = static_cast<uint32_t>(binned ? IMG_WIDTH : IMG_WIDTH * 2),
+    .m_format = VideoFormat::YUV422,
+  };
+  ImageDesc outDesc = {
+    .m_width = static_cast<uint16_t>(previewScale > 1 ? IMG_WIDTH / previewScale : inDesc.m_width),
+    .m_height = static_cast<uint16_t>(previewScale > 1 ? IMG_HEIGHT / previewScale : inDesc.m_height),
+    .m_lineLength = previewScale > 1 ? IMG_WIDTH / previewScale * 2 : IMG_WIDTH * 2,
+    .m_format = VideoFormat::RGB565X,
+  };
+  for (uint32_t i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i)
+    if ((cv_algorithms & TRIK_CV_ALGORITHM_BIT(i)) != 0 && !setupCvAlgorithm(static_cast<enum trik_cv_algorithm>(i), inDesc, outDesc))
+      return 0;
+  return 1;
+}
+
+static int runCvAlgorithm(enum trik_cv_algorithm algorithm, const ImageBuffer& inBuffer, ImageBuffer& outBuffer, const trik_cv_algorithm_in_args& in_args,
+  trik_cv_algorithm_out_args& out_args) {
   if (algorithm == TRIK_CV_ALGORITHM_MOTION_SENSOR)
-    return motionSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, *out_args);
+    return motionSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
   else if (algorithm == TRIK_CV_ALGORITHM_EDGE_LINE_SENSOR)
-    return edgeLineSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, *out_args);
+    return edgeLineSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
   else if (algorithm == TRIK_CV_ALGORITHM_OBJECT_SENSOR)
-    return objectSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, *out_args);
+    return objectSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
   else if (algorithm == TRIK_CV_ALGORITHM_LINE_SENSOR)
-    return lineSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, *out_args);
+    return lineSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
   else if (algorithm == TRIK_CV_ALGORITHM_MXN_SENSOR)
-    return mxnSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, *out_args);
+    return mxnSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
+  else if (algorithm == TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR)
+    return motionVectorSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
+  else if (algorithm == TRIK_CV_ALGORITHM_LANE_SENSOR)
+    return laneSensorCvAlgorithm.run(inBuffer, outBuffer, in_args, out_args);
   else
     return 0;
 }
 
+/*
+ * Sensors of the set run one after the other on the same camera frame, binned once for all of them. The first one
+ * puts the preview background into the output buffer and the HSV conversion of a frame is shared, see CvAlgorithm.
+ */
+extern "C" int trik_run_cv_algorithm(uint32_t cv_algorithms, uint32_t auto_detect_hsv, struct buffer in_buffer, struct buffer out_buffer,
+  struct trik_cv_algorithm_draw_list* draw_list, struct trik_cv_algorithm_in_args in_args, struct trik_cv_algorithm_results* results) {
+  ImageBuffer inBuffer = { .m_ptr = (int8_t*) in_buffer.start, .m_size = in_buffer.length };
+  ImageBuffer outBuffer = { .m_ptr = (int8_t*) out_buffer.start, .m_size = out_buffer.length };
+  draw_list->count = 0;
+  draw_list->dropped = 0;
+  results->cv_algorithms = 0;
+  CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::setDrawList(draw_list);
+  CvAlgorithm<VideoFormat::YUV422, VideoFormat::RGB565X>::startFrame();
+
+  ImageBuffer frameBuffer = inBuffer;
+  uint32_t binCycles = 0;
+  if (binnedFrames) {
+    ImageDesc inDesc = {
+      .m_width = IMG_WIDTH,
+      .m_height = IMG_HEIGHT,
+      .m_lineLength = IMG_WIDTH * 2,
+      .m_format = VideoFormat::YUV422,
+    };
+    ImageDesc binnedDesc;
+    const uint32_t binStart = Timestamp_get32();
+    if (!binning.bin(inBuffer, inDesc, frameBuffer, binnedDesc))
+      return 0;
+    binCycles = Timestamp_get32() - binStart;
+    scaleInArgsToBinned(in_args);
+  }
+
+  trik_cv_algorithm_out_args* first = NULL;
+  for (uint32_t i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i) {
+    if ((cv_algorithms & TRIK_CV_ALGORITHM_BIT(i)) == 0)
+      continue;
+    const enum trik_cv_algorithm algorithm = static_cast<enum trik_cv_algorithm>(i);
+    trik_cv_algorithm_out_args& out_args = results->out_args[i];
+    memset(&out_args.floor, 0, sizeof(out_args.floor));
+    memset(&out_args.cycles, 0, sizeof(out_args.cycles));
+    in_args.auto_detect_hsv = (auto_detect_hsv & TRIK_CV_ALGORITHM_BIT(i)) != 0;
+    const uint32_t sensorStart = Timestamp_get32();
+    if (!runCvAlgorithm(algorithm, frameBuffer, outBuffer, in_args, out_args))
+      return 0;
+    out_args.cycles.sensor = Timestamp_get32() - sensorStart;
+    if (binnedFrames)
+      scaleOutArgsToFullFrame(algorithm, out_args);
+    if (first == NULL) {
+      first = &out_args;
+      first->cycles.bin = binCycles;
+    }
+  }
+  if (first == NULL)
+    return 0;
+  results->cv_algorithms = cv_algorithms;
+  if (!binnedFrames)
+    return 1;
+
+  scaleDrawListToFullFrame(*draw_list);
+  if (previewScale == 1 && (in_args.preview == TRIK_PREVIEW_FULL || in_args.preview == TRIK_PREVIEW_OVERLAY)) {
+    const uint32_t upscaleStart = Timestamp_get32();
+    outBuffer.m_size = out_buffer.length;
+    binning.upscale(outBuffer, IMG_WIDTH / 2, IMG_HEIGHT / 2, IMG_WIDTH * 2);
+    first->cycles.upscale = Timestamp_get32() - upscaleStart;
+  }
+  return 1;
+}
+
+extern "C" bool trik_detect_frame_change(struct buffer in_buffer, uint32_t threshold) {
+  ImageDesc inDesc = {
+    .m_width = IMG_WIDTH,
+    .m_height = IMG_HEIGHT,
+    .m_lineLength = IMG_WIDTH * 2,
+    .m_format = VideoFormat::YUV422,
+  };
+  ImageBuffer inBuffer = { .m_ptr = (int8_t*) in_buffer.start, .m_size = in_buffer.length };
+  return frameChangeDetector.changed(inBuffer, inDesc, threshold);
+}
+
+extern "C" void trik_reset_frame_change_detector() {
+  frameChangeDetector.reset();
+}
+
 }
 }
@@ -10,6 +10,7 @@
 #include <xdc/std.h>
 
 #include <stdio.h>
+#include <string.h>
 
 #include <ti/ipc/MessageQ.h>
 #include <ti/ipc/MultiProc.h>
@@ -25,6 +26,8 @@
 
 int8_t __attribute__((aligned(128))) out_buff[BUFFER_SIZE];
 int8_t __attribute__((aligned(128))) in_buff[BUFFER_SIZE];
+struct trik_cv_algorithm_draw_list __attribute__((aligned(128))) draw_list;
+struct trik_cv_algorithm_results __attribute__((aligned(128))) results;
 
 typedef struct {
   UInt16 hostProcId;
@@ -34,8 +37,30 @@ typedef struct {
 Registry_Desc Registry_CURDESC;
 static Server_Module Module;
 
-static enum trik_cv_algorithm cv_algorithm = TRIK_CV_ALGORITHM_NONE;
+static uint32_t cv_algorithms = 0; // TRIK_CV_ALGORITHM_BIT mask
 static struct trik_cv_algorithm_in_args in_args;
+static uint32_t cached_results = 0; // TRIK_CV_ALGORITHM_BIT mask of the sensors run since the set was started or the frame last changed
+
+/*
+ * Sensor scheduling. A sensor is released at the start of each of its periods and has to run on one of the frames of
+ * the period. Released sensors are packed into the frame budget by earliest deadline, one which does not fit waits for
+ * a frame with more slack. The most urgent one runs whatever its cost, so a frame takes the budget at most, or the cost
+ * of a single sensor when that is larger. A sensor still waiting when its period ends has missed its deadline.
+ */
+struct trik_sensor_schedule {
+  uint32_t release; // frame the current period started on
+  uint32_t cost;    // expected ticks of a run, the budget or the last measured run, 0 before the first one
+  bool pending;     // released and not run in the current period yet
+};
+
+static struct trik_cv_algorithm_schedule schedule;
+static struct trik_sensor_schedule sensor_schedules[TRIK_CV_ALGORITHM_COUNT];
+static uint32_t schedule_frame = 0;
+static uint32_t hsv_release = 0;
+static uint32_t hsv_pending = 0; // TRIK_CV_ALGORITHM_BIT mask of the sensors detecting ranges which have not run since the last HSV release
+
+// sensors which detect their HSV range with auto_detect_hsv, each one samples its own zones
+#define TRIK_HSV_DETECTING (TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_LINE_SENSOR) | TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_OBJECT_SENSOR))
 
 static struct buffer in_buffer;
 static struct buffer out_buffer;
@@ -51,10 +76,119 @@ enum trik_cv_algorithm trik_cv_algorithm_from_cmd(enum trik_cmd cmd) {
     return TRIK_CV_ALGORITHM_OBJECT_SENSOR;
   else if (cmd == TRIK_CMD_MXN_SENSOR)
     return TRIK_CV_ALGORITHM_MXN_SENSOR;
+  else if (cmd == TRIK_CMD_MOTION_VECTOR_SENSOR)
+    return TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR;
+  else if (cmd == TRIK_CMD_LANE_SENSOR)
+    return TRIK_CV_ALGORITHM_LANE_SENSOR;
   else
     return TRIK_CV_ALGORITHM_NONE;
 }
 
+// heavy sensors whose results can be repeated while the scene is static, a set is gated when all of its sensors are
+static bool trik_cv_algorithms_are_motion_gated(uint32_t cv_algorithms) {
+  const uint32_t gated = TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_OBJECT_SENSOR) | TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_LINE_SENSOR) |
+                         TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_LANE_SENSOR);
+  return (cv_algorithms & ~gated) == 0;
+}
+
+// the reply carries the results of the first sensor of the set
+static enum trik_cv_algorithm trik_first_cv_algorithm(uint32_t cv_algorithms) {
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i)
+    if (cv_algorithms & TRIK_CV_ALGORITHM_BIT(i))
+      return (enum trik_cv_algorithm) i;
+  return TRIK_CV_ALGORITHM_NONE;
+}
+
+static uint32_t trik_schedule_period(uint32_t period) {
+  return period > 1 ? period : 1;
+}
+
+static void trik_reset_schedule(const struct trik_cv_algorithm_schedule* requested) {
+  schedule = *requested;
+  schedule_frame = 0;
+  hsv_release = 0;
+  hsv_pending = TRIK_HSV_DETECTING;
+  memset(results.schedule, 0, sizeof(results.schedule));
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i) {
+    sensor_schedules[i].release = 0;
+    sensor_schedules[i].cost = schedule.budget[i];
+    sensor_schedules[i].pending = true;
+  }
+}
+
+// releases the sensors whose period starts on the frame, counting the deadlines missed, and returns the pending ones
+static uint32_t trik_release_cv_algorithms(void) {
+  uint32_t pending = 0;
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i) {
+    if (!(cv_algorithms & TRIK_CV_ALGORITHM_BIT(i)))
+      continue;
+    struct trik_sensor_schedule* sensor = &sensor_schedules[i];
+    const uint32_t period = trik_schedule_period(schedule.period[i]);
+    if (schedule_frame - sensor->release >= period) {
+      if (sensor->pending)
+        ++results.schedule[i].misses;
+      sensor->release = schedule_frame - (schedule_frame - sensor->release) % period;
+      sensor->pending = true;
+    }
+    if (sensor->pending)
+      pending |= TRIK_CV_ALGORITHM_BIT(i);
+  }
+
+  const uint32_t hsv_period = trik_schedule_period(schedule.auto_detect_hsv_period);
+  if (schedule_frame - hsv_release >= hsv_period) {
+    hsv_release = schedule_frame - (schedule_frame - hsv_release) % hsv_period;
+    hsv_pending = TRIK_HSV_DETECTING;
+  }
+  return pending;
+}
+
+// pending sensors by earliest deadline, each one joins the frame if its cost fits into what is left of the budget
+static uint32_t trik_pack_cv_algorithms(uint32_t pending) {
+  uint32_t packed = 0;
+  uint32_t spent = 0;
+  while (pending != 0) {
+    int next = -1;
+    uint32_t next_deadline = 0;
+    for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i) {
+      if (!(pending & TRIK_CV_ALGORITHM_BIT(i)))
+        continue;
+      const uint32_t deadline = sensor_schedules[i].release + trik_schedule_period(schedule.period[i]);
+      if (next < 0 || deadline - schedule_frame < next_deadline - schedule_frame) {
+        next = i;
+        next_deadline = deadline;
+      }
+    }
+    pending &= ~TRIK_CV_ALGORITHM_BIT(next);
+
+    const uint32_t cost = sensor_schedules[next].cost;
+    if (packed != 0 && schedule.frame_budget > 0 && spent + cost > schedule.frame_budget) {
+      ++results.schedule[next].deferred;
+      continue;
+    }
+    packed |= TRIK_CV_ALGORITHM_BIT(next);
+    spent += cost;
+  }
+  return packed;
+}
+
+// sensors of the frame are done for their period, those reused on a static frame too as their results stand for the frame
+static void trik_complete_cv_algorithms(uint32_t completed, uint32_t ran) {
+  hsv_pending &= ~ran;
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i) {
+    if (!(completed & TRIK_CV_ALGORITHM_BIT(i)))
+      continue;
+    sensor_schedules[i].pending = false;
+    if (!(ran & TRIK_CV_ALGORITHM_BIT(i)))
+      continue;
+    const uint32_t cycles = results.out_args[i].cycles.sensor;
+    ++results.schedule[i].runs;
+    if (schedule.budget[i] == 0)
+      sensor_schedules[i].cost = cycles;
+    else if (cycles > schedule.budget[i])
+      ++results.schedule[i].overruns;
+  }
+}
+
 Int trik_init_dsp_server(Void) {
   Int status = 0;
   MessageQ_Params msgqParams;
@@ -121,6 +255,8 @@ static int trik_handle_init(struct trik_msg* req) {
 
   res->dsp_in_buffer = in_buffer.start;
   res->dsp_out_buffer = out_buffer.start;
+  res->dsp_draw_list = &draw_list;
+  res->dsp_results = &results;
 
   if (trik_res_msg((struct trik_msg*) res) < 0) {
     Log_print0(Diags_INFO, "trik_handle_init(): unable to send ack with buffers");
@@ -130,16 +266,24 @@ static int trik_handle_init(struct trik_msg* req) {
 }
 
 static int trik_handle_sensor(struct trik_req_cv_algorithm_msg* req) {
-  cv_algorithm = trik_cv_algorithm_from_cmd(req->header.cmd);
+  if (req->header.cmd == TRIK_CMD_SENSOR_SET)
+    cv_algorithms = req->cv_algorithms;
+  else {
+    const enum trik_cv_algorithm cv_algorithm = trik_cv_algorithm_from_cmd(req->header.cmd);
+    cv_algorithms = cv_algorithm == TRIK_CV_ALGORITHM_NONE ? 0 : TRIK_CV_ALGORITHM_BIT(cv_algorithm);
+  }
   in_args = req->in_args;
+  cached_results = 0;
+  trik_reset_frame_change_detector();
+  trik_reset_schedule(&req->schedule);
 
   struct trik_msg* res = (struct trik_msg*) req;
 
-  if (!trik_init_cv_algorithm(cv_algorithm)) {
-    Log_print1(Diags_INFO, "trik_handle_sensor(): unable to initialize cv algorithm %x", cv_algorithm);
+  if (!trik_init_cv_algorithm(cv_algorithms, in_args.bin_2x2, in_args.preview_scale)) {
+    Log_print1(Diags_INFO, "trik_handle_sensor(): unable to initialize cv algorithms %x", cv_algorithms);
     return -1;
   }
-  Log_print1(Diags_INFO, "trik_handle_sensor(): Initialized %d algorithm", cv_algorithm);
+  Log_print1(Diags_INFO, "trik_handle_sensor(): Initialized algorithms %x", cv_algorithms);
 
   if (trik_res_msg(res) < 0) {
     Log_print0(Diags_INFO, "trik_handle_sensor(): unable to send ack about setting up motion sensor algo");
@@ -152,10 +296,38 @@ static int trik_handle_sensor(struct trik_req_cv_algorithm_msg* req) {
 static int trik_handle_step(struct trik_msg* req) {
   struct trik_res_step_msg* res = (struct trik_res_step_msg*) req;
 
-  if (!trik_run_cv_algorithm(cv_algorithm, in_buffer, out_buffer, in_args, &(res->out_args))) {
-    Log_print0(Diags_INFO, "trik_handle_step(): unable to run cv algorithm");
+  // preview in out_buffer, draw_list and results are left as is on static frames nothing runs on, so they keep showing the frame the results belong to
+  const bool gated = in_args.static_threshold > 0 && trik_cv_algorithms_are_motion_gated(cv_algorithms);
+  const enum trik_cv_algorithm first = trik_first_cv_algorithm(cv_algorithms);
+  if (first == TRIK_CV_ALGORITHM_NONE) {
+    Log_print0(Diags_INFO, "trik_handle_step(): no cv algorithm to run");
     return -1;
   }
+  // a static frame runs only the due sensors which have no results of the scene yet, deferred or released after the change;
+  // frames of sets which are not gated all count as changed
+  const bool static_frame = gated && !trik_detect_frame_change(in_buffer, in_args.static_threshold);
+  if (!static_frame)
+    cached_results = 0;
+
+  // frames no sensor is due on leave the results and the preview alone like static frames do, reused sensors take no budget
+  const uint32_t released = trik_release_cv_algorithms();
+  const uint32_t reusable = static_frame ? released & cached_results : 0;
+  const uint32_t scheduled = trik_pack_cv_algorithms(released & ~reusable);
+  if (scheduled != 0) {
+    const uint32_t auto_detect_hsv = in_args.auto_detect_hsv ? hsv_pending & scheduled : 0;
+    if (!trik_run_cv_algorithm(scheduled, auto_detect_hsv, in_buffer, out_buffer, &draw_list, in_args, &results)) {
+      Log_print0(Diags_INFO, "trik_handle_step(): unable to run cv algorithm");
+      return -1;
+    }
+  } else
+    results.cv_algorithms = 0;
+  trik_complete_cv_algorithms(reusable | scheduled, scheduled);
+  ++schedule_frame;
+  cached_results |= scheduled;
+
+  for (int i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i)
+    results.out_args[i].reused = !(scheduled & TRIK_CV_ALGORITHM_BIT(i)) && (cached_results & TRIK_CV_ALGORITHM_BIT(i));
+  res->out_args = results.out_args[first];
 
   if (trik_res_msg((struct trik_msg*) res) < 0) {
     Log_print0(Diags_INFO, "trik_handle_step(): unable to send ack about step");
@@ -16,6 +16,9 @@ enum trik_cmd {
   TRIK_CMD_MOTION_SENSOR = 0x05000000,
   TRIK_CMD_MXN_SENSOR = 0x06000000,
   TRIK_CMD_OBJECT_SENSOR = 0x07000000,
+  TRIK_CMD_MOTION_VECTOR_SENSOR = 0x08000000,
+  TRIK_CMD_LANE_SENSOR = 0x09000000,
+  TRIK_CMD_SENSOR_SET = 0x0A000000, // sensors of trik_req_cv_algorithm_msg::cv_algorithms, at the rates of its schedule
   TRIK_CMD_SHUTDOWN = 0xA0000000,
 };
 
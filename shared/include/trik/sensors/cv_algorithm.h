@@ -14,10 +14,17 @@ enum trik_cv_algorithm {
   TRIK_CV_ALGORITHM_EDGE_LINE_SENSOR,
   TRIK_CV_ALGORITHM_LINE_SENSOR,
   TRIK_CV_ALGORITHM_OBJECT_SENSOR,
-  TRIK_CV_ALGORITHM_MXN_SENSOR
+  TRIK_CV_ALGORITHM_MXN_SENSOR,
+  TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR,
+  TRIK_CV_ALGORITHM_LANE_SENSOR
 
 };
 
+// sensor sets are masks of TRIK_CV_ALGORITHM_BIT, sensors of a set run in enum order on one frame
+#define TRIK_CV_ALGORITHM_COUNT 7
+#define TRIK_CV_ALGORITHM_BIT(algorithm) (1u << (algorithm))
+#define TRIK_CV_ALGORITHM_ALL ((1u << TRIK_CV_ALGORITHM_COUNT) - 1)
+
 #if defined(__cplusplus)
 }
 #endif
@@ -8,18 +8,152 @@ extern "C" {
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "cv_algorithm.h"
+
 #define TRIK_MAX_TARGET_COUNT 8
 
+#define TRIK_MOTION_FIELD_COLS 5
+#define TRIK_MOTION_FIELD_ROWS 5
+
+#define TRIK_MAX_ACTIVITY_COLS 8
+#define TRIK_MAX_ACTIVITY_ROWS 8
+
+#define TRIK_MAX_EDGE_LINES 4
+#define TRIK_MAX_CORNERS 16
+
+#define TRIK_MAX_ROIS 4
+
+#define TRIK_MAX_LINE_BANDS 8
+
+#define TRIK_MAX_DRAW_COMMANDS 512
+
+enum trik_preview {
+  TRIK_PREVIEW_FULL = 0,      // sensor renders its preview image
+  TRIK_PREVIEW_NONE = 1,      // nobody looks at the output buffer, skip rendering
+  TRIK_PREVIEW_OVERLAY = 2,   // detections and sensor geometry only, drawn over a black frame
+  TRIK_PREVIEW_DRAW_LIST = 3, // detections and sensor geometry as draw commands, composited over the camera frame by the ARM
+};
+
+enum trik_draw_op {
+  TRIK_DRAW_CROSSHAIR = 0, // arms of x1 columns and y1 rows on each side of x0, y0
+  TRIK_DRAW_CIRCLE = 1,    // radius of x1 pixels around x0, y0
+  TRIK_DRAW_RECTANGLE = 2, // outline of [x0..x1] x [y0..y1], sides width pixels wide centered on the edges
+  TRIK_DRAW_LINE = 3,      // from x0, y0 to x1, y1, polylines are runs of lines sharing their end points
+  TRIK_DRAW_FILL = 4,      // box [x0..x1) x [y0..y1), cells and marker dots
+};
+
+enum trik_tracker_mode {
+  TRIK_TRACKER_OFF = 0,    // tracking disabled
+  TRIK_TRACKER_FULL = 1,   // target searched in the whole frame
+  TRIK_TRACKER_WINDOW = 2, // target searched in the window around the predicted position
+};
+
+// crossings seen by the line sensor, the line comes from the bottom of the frame
+enum trik_line_junction {
+  TRIK_LINE_JUNCTION_NONE = 0,
+  TRIK_LINE_JUNCTION_CROSS = 1,        // +, line goes on past a crossing bar
+  TRIK_LINE_JUNCTION_T = 2,            // T, line ends at a crossing bar
+  TRIK_LINE_JUNCTION_LEFT_TURN = 3,    // L turning left, line ends
+  TRIK_LINE_JUNCTION_RIGHT_TURN = 4,   // L turning right, line ends
+  TRIK_LINE_JUNCTION_LEFT_BRANCH = 5,  // branch to the left, line goes on
+  TRIK_LINE_JUNCTION_RIGHT_BRANCH = 6, // branch to the right, line goes on
+};
+
+// lane boundaries seen by the lane sensor, flags
+enum trik_lane_boundary {
+  TRIK_LANE_LEFT = 1,
+  TRIK_LANE_RIGHT = 2,
+};
+
+// rectangle in full frame pixels, snapped outwards to 8 columns and 4 rows by the DSP
+struct trik_cv_algorithm_roi {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+};
+
+// pixel of the full camera frame
+struct trik_cv_algorithm_image_point {
+  uint16_t x;
+  uint16_t y;
+};
+
+// millimetres on the floor in the robot frame, x ahead of the robot, y to its left
+struct trik_cv_algorithm_floor_point {
+  int16_t x;
+  int16_t y;
+};
+
+// four frame pixels and the floor points seen in them, no three of either on a line
+struct trik_cv_algorithm_floor_calibration {
+  struct trik_cv_algorithm_image_point image[4];
+  struct trik_cv_algorithm_floor_point floor[4];
+};
+
+// radial distortion of the full frame around its center, r_d = r_u (1 + k1 r_u^2 + k2 r_u^4) with radii in focal lengths
+struct trik_cv_algorithm_lens {
+  uint16_t focal; // pixels, 0 disables undistortion
+  int16_t k1;     // 1/10000
+  int16_t k2;     // 1/10000
+};
+
+// full frame pixels, commands may reach outside of the frame and are clipped when drawn
+struct trik_cv_algorithm_draw_cmd {
+  uint8_t op;      // enum trik_draw_op
+  uint8_t width;   // pixels, rectangles only
+  uint16_t rgb565; // color
+  int16_t x0;
+  int16_t y0;
+  int16_t x1;
+  int16_t y1;
+};
+
+// overlay of the last processed frame, shared with the ARM next to the output buffer
+struct trik_cv_algorithm_draw_list {
+  uint16_t count;   // [0..TRIK_MAX_DRAW_COMMANDS]
+  uint16_t dropped; // commands which did not fit into the list
+  struct trik_cv_algorithm_draw_cmd cmds[TRIK_MAX_DRAW_COMMANDS];
+};
+
 struct trik_cv_algorithm_in_args {
-  uint16_t detect_hue_from; // [0..359]
-  uint16_t detect_hue_to;   // [0..359]
-  uint8_t detect_sat_from;  // [0..100]
-  uint8_t detect_sat_to;    // [0..100]
-  uint8_t detect_val_from;  // [0..100]
-  uint8_t detect_val_to;    // [0..100]
-  bool auto_detect_hsv;     // [true|false]
-  uint16_t width_n;         // [1..320]
-  uint16_t height_n;        // [1..240]
+  uint16_t detect_hue_from;   // [0..359]
+  uint16_t detect_hue_to;     // [0..359]
+  uint8_t detect_sat_from;    // [0..100]
+  uint8_t detect_sat_to;      // [0..100]
+  uint8_t detect_val_from;    // [0..100]
+  uint8_t detect_val_to;      // [0..100]
+  bool auto_detect_hsv;       // [true|false]
+  uint16_t width_n;           // [1..320]
+  uint16_t height_n;          // [1..240]
+  uint8_t activity_cols;      // [1..8], 0 for default
+  uint8_t activity_rows;      // [1..8], 0 for default
+  uint8_t activity_threshold; // [1..100] percent of changed pixels to mark a cell active, 0 for default
+  uint8_t static_threshold;   // [0..255] mean luma difference in 1/16 level below which a frame is static, 0 disables gating
+  uint8_t preview;            // enum trik_preview
+  uint8_t preview_scale;      // [1|2|4] preview image is 1/n of the frame in both directions, 0 for full size
+  bool detect_corners;        // [true|false] run the Harris corner stage of the edge line sensor
+  uint8_t roi_count;          // [0..TRIK_MAX_ROIS], 0 processes the whole frame
+  struct trik_cv_algorithm_roi rois[TRIK_MAX_ROIS];
+  bool track_target;        // [true|false] line and object sensors search a window around the predicted target, replacing the ROIs
+  uint8_t track_max_misses; // frames without the target before falling back to full frame scans, 0 for default
+  bool bin_2x2;             // [true|false] sensors run on a 2x2 averaged half resolution frame, pixel results are scaled back
+  uint8_t sample_stride;    // [1..8] line and motion sensors look for the target in every n-th row only, 0 for every row
+  bool sample_checkerboard; // [true|false] sampled rows take every other pixel pair, alternating between rows
+  uint8_t line_bands;       // [1..TRIK_MAX_LINE_BANDS] horizontal bands of the line sensor path, 0 for default
+  struct trik_cv_algorithm_floor_calibration floor; // camera to floor homography of line, lane and object sensors, all zero disables it
+  struct trik_cv_algorithm_lens lens;               // detected points of line, lane, object and edge line sensors are undistorted
+};
+
+/*
+ * Rates and costs of the sensors of a set, periods in camera frames and costs in DSP timestamp ticks like
+ * trik_cv_algorithm_out_cycles. Sensors due on a frame are packed into frame_budget, see dsp_server.c.
+ */
+struct trik_cv_algorithm_schedule {
+  uint32_t frame_budget;                    // ticks of sensor runs per frame, 0 runs every due sensor
+  uint32_t auto_detect_hsv_period;          // frames between HSV range detections with auto_detect_hsv, each sensor detects on its next run, 0 for every run
+  uint32_t period[TRIK_CV_ALGORITHM_COUNT]; // frames between runs of a sensor, by enum trik_cv_algorithm, 0 for every frame
+  uint32_t budget[TRIK_CV_ALGORITHM_COUNT]; // ticks a run of the sensor is expected to take, 0 for its last measured run
 };
 
 struct trik_cv_algorithm_out_target {
@@ -28,6 +162,115 @@ struct trik_cv_algorithm_out_target {
   uint16_t size;
 };
 
+struct trik_cv_algorithm_out_motion_vector {
+  int8_t dx; // pixels per frame
+  int8_t dy; // pixels per frame
+};
+
+struct trik_cv_algorithm_out_motion_vectors {
+  struct trik_cv_algorithm_out_motion_vector global;
+  uint8_t global_support; // [0..100] percent of blocks agreeing with global
+  struct trik_cv_algorithm_out_motion_vector field[TRIK_MOTION_FIELD_ROWS][TRIK_MOTION_FIELD_COLS];
+};
+
+struct trik_cv_algorithm_out_activity {
+  uint8_t cols;
+  uint8_t rows;
+  bool changed;                                                      // mask differs from the previous frame
+  uint8_t mask[TRIK_MAX_ACTIVITY_ROWS];                              // bit c of mask[r] is set for an active cell
+  uint8_t magnitude[TRIK_MAX_ACTIVITY_ROWS][TRIK_MAX_ACTIVITY_COLS]; // [0..100] percent of changed pixels
+};
+
+struct trik_cv_algorithm_out_hough_line {
+  int16_t rho;    // pixels from the image center to the line
+  uint8_t theta;  // [0..179] degrees between the x axis and the line normal, y axis pointing down
+  uint16_t votes; // sampled edge pixels on the line
+};
+
+struct trik_cv_algorithm_out_corner {
+  uint16_t x; // pixels
+  uint16_t y; // pixels
+};
+
+struct trik_cv_algorithm_out_edge_line {
+  uint8_t threshold;     // [0..255] Sobel magnitude of strong edges chosen for the frame, weak edges are above half of it
+  uint8_t line_count;    // [0..TRIK_MAX_EDGE_LINES]
+  uint16_t edge_points;  // sampled edge pixels which voted
+  uint32_t hough_cycles; // timestamp ticks spent in the Hough stage
+  struct trik_cv_algorithm_out_hough_line lines[TRIK_MAX_EDGE_LINES];
+  uint8_t corner_count; // [0..TRIK_MAX_CORNERS], strongest first
+  struct trik_cv_algorithm_out_corner corners[TRIK_MAX_CORNERS];
+};
+
+struct trik_cv_algorithm_out_tracker {
+  uint8_t mode;       // enum trik_tracker_mode the frame was searched in
+  bool locked;        // a target is being tracked, next frame is searched in a window
+  uint8_t misses;     // consecutive frames without the target
+  uint16_t x;         // pixels, filtered target position
+  uint16_t y;         // pixels
+  int16_t velocity_x; // 1/16 pixels per frame
+  int16_t velocity_y; // 1/16 pixels per frame
+  struct trik_cv_algorithm_roi window;
+};
+
+struct trik_cv_algorithm_out_line_band {
+  int8_t x;     // [-100..100] line centroid in the band, same scale as targets[0].x
+  uint8_t size; // [0..100] percent of band pixels on the line
+};
+
+struct trik_cv_algorithm_out_line_path {
+  uint8_t band_count; // bands the frame is split into, top band first
+  uint8_t fit_bands;  // bands with enough line pixels to be fitted, 0 when there is no path
+  struct trik_cv_algorithm_out_line_band bands[TRIK_MAX_LINE_BANDS];
+  int8_t offset;     // [-100..100] fitted path at the bottom row, same scale as targets[0].x
+  int16_t angle;     // 1/10 degrees, path heading at the bottom row, 0 straight up the frame, positive to the right
+  int16_t curvature; // 1/1000 per frame height, positive when the path bends to the right
+  uint8_t width;      // [0..100] line width, percent of frame width
+  uint8_t junction;   // enum trik_line_junction
+  uint8_t junction_y; // [0..100] crossing bar row, percent of frame height from the top
+};
+
+struct trik_cv_algorithm_out_lane_band {
+  uint8_t boundaries; // enum trik_lane_boundary flags, 0 when the band has no lane
+  int8_t left;        // [-100..100] left line in the band, same scale as targets[0].x, valid with TRIK_LANE_LEFT
+  int8_t right;       // [-100..100] right line, valid with TRIK_LANE_RIGHT
+  int8_t center;      // [-100..100] lane center, from the last known lane width when one boundary is missing
+};
+
+struct trik_cv_algorithm_out_lane {
+  uint8_t band_count; // bands the frame is split into, top band first
+  uint8_t boundaries; // enum trik_lane_boundary flags seen in any band
+  struct trik_cv_algorithm_out_lane_band bands[TRIK_MAX_LINE_BANDS];
+  int8_t center; // [-100..100] lane center in the bottom band with a lane
+  uint8_t width; // [0..100] lane width there, percent of frame width
+  int16_t angle; // 1/10 degrees, lane heading over the bands, 0 straight up the frame, positive to the right
+};
+
+// detected points projected onto the floor, only set with a floor calibration
+struct trik_cv_algorithm_out_floor {
+  uint8_t target_mask; // bit i is set when targets[i] lies on the floor
+  uint8_t point_mask;  // bit i is set when points[i] lies on the floor
+  struct trik_cv_algorithm_floor_point targets[TRIK_MAX_TARGET_COUNT];
+  struct trik_cv_algorithm_floor_point points[TRIK_MAX_LINE_BANDS]; // line or lane path, one point per band, top band first
+};
+
+// timestamp ticks spent on the frame by stage
+struct trik_cv_algorithm_out_cycles {
+  uint32_t bin;     // 2x2 averaging of the camera frame, 0 without binning
+  uint32_t sensor;  // sensor run, rendering of its preview included
+  uint32_t upscale; // upscale of a binned preview, 0 without binning or preview
+  uint32_t preview; // preview background demux and conversion, part of sensor, 0 without a preview image
+};
+
+// sensor specific results, only the member of the running algorithm is valid
+union trik_cv_algorithm_out_ext {
+  struct trik_cv_algorithm_out_motion_vectors motion_vectors;
+  struct trik_cv_algorithm_out_activity activity;
+  struct trik_cv_algorithm_out_edge_line edge_line;
+  struct trik_cv_algorithm_out_line_path line_path;
+  struct trik_cv_algorithm_out_lane lane;
+};
+
 struct trik_cv_algorithm_out_args {
   struct trik_cv_algorithm_out_target targets[TRIK_MAX_TARGET_COUNT];
   uint16_t detect_hue_from; // [0..359]
@@ -36,6 +279,29 @@ struct trik_cv_algorithm_out_args {
   uint8_t detect_sat_to;    // [0..100]
   uint8_t detect_val_from;  // [0..100]
   uint8_t detect_val_to;    // [0..100]
+  bool reused;              // not run on the frame, results of an earlier one of the same scene are repeated; neither run nor reused means stale or empty
+  struct trik_cv_algorithm_out_tracker tracker;
+  struct trik_cv_algorithm_out_floor floor;
+  struct trik_cv_algorithm_out_cycles cycles;
+  union trik_cv_algorithm_out_ext ext;
+};
+
+// scheduling counters of a sensor since its set was requested
+struct trik_cv_algorithm_out_schedule {
+  uint32_t runs;     // frames the sensor ran on
+  uint32_t deferred; // frames it was due on and left out of, the frame budget had no room for it
+  uint32_t misses;   // periods which ended before it ran, missed deadlines
+  uint32_t overruns; // runs which took longer than its budget
+};
+
+/*
+ * Results of every sensor of a set run on the last processed frame, shared with the ARM next to the draw list as
+ * they do not fit into one message. Binning and the upscale are counted in the cycles of the first sensor only.
+ */
+struct trik_cv_algorithm_results {
+  uint32_t cv_algorithms; // TRIK_CV_ALGORITHM_BIT mask of the sensors run on the frame, out_args of the others are from earlier frames
+  struct trik_cv_algorithm_out_args out_args[TRIK_CV_ALGORITHM_COUNT]; // by enum trik_cv_algorithm
+  struct trik_cv_algorithm_out_schedule schedule[TRIK_CV_ALGORITHM_COUNT];
 };
 
 #if defined(__cplusplus)
@@ -18,14 +18,19 @@ struct trik_res_init_msg {
 
   void* dsp_in_buffer;
   void* dsp_out_buffer;
+  void* dsp_draw_list;
+  void* dsp_results;
 };
 
 struct trik_req_cv_algorithm_msg {
   struct trik_msg header;
 
   struct trik_cv_algorithm_in_args in_args;
+  uint32_t cv_algorithms; // TRIK_CMD_SENSOR_SET only, TRIK_CV_ALGORITHM_BIT mask
+  struct trik_cv_algorithm_schedule schedule;
 };
 
+// out_args of the first sensor of the set, all of them are in the shared trik_cv_algorithm_results
 struct trik_res_step_msg {
   struct trik_msg header;
 
@@ -0,0 +1,63 @@
+/*
+ * Time per frame of every sensor at full resolution and 2x2 binned, with the full preview rendered. Binned runs are
+ * split into the binning of the camera frame, the sensor run and the upscale of its half size preview.
+ * binning_test compares the results of both paths.
+ */
+#include "pipeline.h"
+
+#define BENCH_FRAMES 20
+
+static const struct {
+  trik_cv_algorithm algorithm;
+  const char* name;
+} s_sensors_t[] = {
+  { TRIK_CV_ALGORITHM_MOTION_SENSOR, "motion" },
+  { TRIK_CV_ALGORITHM_EDGE_LINE_SENSOR, "edge line" },
+  { TRIK_CV_ALGORITHM_LINE_SENSOR, "line" },
+  { TRIK_CV_ALGORITHM_OBJECT_SENSOR, "object" },
+  { TRIK_CV_ALGORITHM_MXN_SENSOR, "mxn" },
+  { TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR, "motion vector" },
+  { TRIK_CV_ALGORITHM_LANE_SENSOR, "lane" },
+};
+
+// a panning texture with a blue blob moving over it, so every sensor finds something
+static void drawFrame(const int _frame) {
+  drawTexture(IMG_WIDTH / 2 + 2 * _frame, IMG_HEIGHT / 2 + _frame);
+  drawBlob(60 + _frame, 80 + 3 * _frame, 50, 40);
+}
+
+int main() {
+  makeTexture();
+  printf("%-14s %10s %10s %8s %8s %8s %7s\n", "sensor", "full ns", "binned ns", "bin", "sensor", "upscale", "ratio");
+  for (uint32_t sensor = 0; sensor < sizeof(s_sensors_t) / sizeof(s_sensors_t[0]); ++sensor) {
+    uint32_t total[2] = { 0, 0 };
+    trik_cv_algorithm_out_cycles cycles = { 0, 0, 0, 0 };
+    for (int bin = 0; bin < 2; ++bin) {
+      trik_init_cv_algorithm(TRIK_CV_ALGORITHM_BIT(s_sensors_t[sensor].algorithm), bin, 0);
+      trik_cv_algorithm_in_args in;
+      clearInArgs(in);
+      in.bin_2x2 = bin;
+      in.detect_corners = true;
+      in.width_n = 4;
+      in.height_n = 3;
+      if (s_sensors_t[sensor].algorithm == TRIK_CV_ALGORITHM_OBJECT_SENSOR)
+        detectBlueAround(in);
+      else
+        detectBlue(in);
+
+      for (int frame = 0; frame < BENCH_FRAMES; ++frame) {
+        drawFrame(frame);
+        trik_cv_algorithm_out_args out;
+        total[bin] += runSensor(s_sensors_t[sensor].algorithm, in, out);
+        if (bin) {
+          cycles.bin += out.cycles.bin;
+          cycles.sensor += out.cycles.sensor;
+          cycles.upscale += out.cycles.upscale;
+        }
+      }
+    }
+    printf("%-14s %10u %10u %8u %8u %8u %6.2fx\n", s_sensors_t[sensor].name, total[0] / BENCH_FRAMES, total[1] / BENCH_FRAMES, cycles.bin / BENCH_FRAMES,
+      cycles.sensor / BENCH_FRAMES, cycles.upscale / BENCH_FRAMES, total[1] ? static_cast<float>(total[0]) / total[1] : 0.0f);
+  }
+  return 0;
+}
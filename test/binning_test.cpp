@@ -0,0 +1,222 @@
+/*
+ * 2x2 binned processing against full resolution: the binning and upscale kernels are checked exactly, sensor results
+ * on the same synthetic frames are compared in the units the sensors report and must stay within the bounds below.
+ *
+ * A binned frame has half the resolution, so the bounds are set by the coarser sampling: line centroids, Hough lines
+ * and motion vectors are found to 2 pixels instead of 1. Object sensor clusters are built from 8 full frame pixel
+ * metapixels instead of 4, and the clusterizer divides coordinate sums by the metapixel count plus one, which pulls
+ * small clusters towards the top left corner. With a quarter of the metapixels the pull grows four times, so binned
+ * object positions are off by up to 10 percent of the half frame on the blobs below (mean about 5), and sizes, which
+ * are quantized to about 3 percent binned, by up to one step.
+ */
+#include <trik/sensors/binning.hpp>
+
+#include "pipeline.h"
+
+#include <stdlib.h>
+
+#define OBJECT_BOUND 10     // percent of the half frame, see above
+#define OBJECT_SIZE_BOUND 3 // percent
+#define LINE_BOUND 2        // percent of the half frame, one binned pixel is 1.25
+#define HOUGH_RHO_BOUND 4   // pixels, rho bins are 2 binned pixels wide
+#define HOUGH_THETA_BOUND 4 // degrees, two theta bins
+#define MOTION_BOUND 1      // pixels, binned vectors are even
+
+using namespace trik::sensors;
+
+static void checkKernels() {
+  // uniform 2x2 blocks come out exactly, chroma pairs of four columns included
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 0; col < IMG_WIDTH; ++col)
+      setPixel(row, col, (row / 2 * 7 + col / 2 * 3) & 0xff, (col / 4 * 11) & 0xff, (col / 4 * 5) & 0xff);
+
+  const ImageDesc inDesc = { IMG_WIDTH, IMG_HEIGHT, IMG_WIDTH * 2, VideoFormat::YUV422 };
+  ImageBuffer in = { reinterpret_cast<int8_t*>(s_frame_t), sizeof(s_frame_t) };
+  ImageDesc binnedDesc;
+  ImageBuffer binned;
+  Binning2x2 binning;
+  CHECK(binning.bin(in, inDesc, binned, binnedDesc), "bin");
+  CHECK(binnedDesc.m_width == IMG_WIDTH / 2 && binnedDesc.m_height == IMG_HEIGHT / 2, "binned size %ux%u", binnedDesc.m_width, binnedDesc.m_height);
+
+  uint32_t mismatches = 0;
+  for (int row = 0; row < IMG_HEIGHT / 2; ++row)
+    for (int col = 0; col < IMG_WIDTH / 2; ++col) {
+      const uint8_t* pixel = reinterpret_cast<const uint8_t*>(binned.m_ptr) + (row * IMG_WIDTH / 2 + col) * 2;
+      mismatches += pixel[0] != ((row * 7 + col * 3) & 0xff);
+      mismatches += pixel[1] != (col % 2 ? (col / 2 * 5) & 0xff : (col / 2 * 11) & 0xff);
+    }
+  CHECK(mismatches == 0, "%u binned samples differ", mismatches);
+
+  uint16_t* out = reinterpret_cast<uint16_t*>(s_output_t);
+  for (int row = 0; row < IMG_HEIGHT / 2; ++row)
+    for (int col = 0; col < IMG_WIDTH / 2; ++col)
+      out[row * IMG_WIDTH + col] = row * 256 + col;
+  ImageBuffer outImage = { reinterpret_cast<int8_t*>(s_output_t), sizeof(s_output_t) };
+  binning.upscale(outImage, IMG_WIDTH / 2, IMG_HEIGHT / 2, IMG_WIDTH * 2);
+  mismatches = 0;
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 0; col < IMG_WIDTH; ++col)
+      mismatches += out[row * IMG_WIDTH + col] != (row / 2) * 256 + col / 2;
+  CHECK(mismatches == 0, "%u upscaled pixels differ", mismatches);
+}
+
+struct Difference {
+  const char* name;
+  int bound;
+  int max;
+  int sum;
+  int count;
+};
+
+static void compare(Difference& _difference, const int _full, const int _binned) {
+  const int difference = abs(_full - _binned);
+  _difference.max = difference > _difference.max ? difference : _difference.max;
+  _difference.sum += difference;
+  ++_difference.count;
+}
+
+static void report(const Difference& _difference) {
+  printf("%-24s max %3d mean %5.2f over %3d, bound %d\n", _difference.name, _difference.max, _difference.count ? static_cast<float>(_difference.sum) / _difference.count : 0.0f,
+    _difference.count, _difference.bound);
+  CHECK(_difference.max <= _difference.bound, "%s differs by %d", _difference.name, _difference.max);
+}
+
+// runs the sensor on the frame at full resolution and binned, restoring the frame drawn by _draw in between
+template <typename _Draw>
+static void runBoth(const trik_cv_algorithm _algorithm, trik_cv_algorithm_in_args& _inArgs, _Draw _draw, trik_cv_algorithm_out_args _outArgs[2]) {
+  for (int bin = 0; bin < 2; ++bin) {
+    trik_init_cv_algorithm(TRIK_CV_ALGORITHM_BIT(_algorithm), bin, 0);
+    _inArgs.bin_2x2 = bin;
+    _draw();
+    CHECK(runSensor(_algorithm, _inArgs, _outArgs[bin]) != 0, "sensor %d binned %d did not run", _algorithm, bin);
+  }
+}
+
+static void compareObjects() {
+  Difference x = { "object x", OBJECT_BOUND, 0, 0, 0 };
+  Difference y = { "object y", OBJECT_BOUND, 0, 0, 0 };
+  Difference size = { "object size", OBJECT_SIZE_BOUND, 0, 0, 0 };
+  trik_cv_algorithm_in_args in;
+  clearInArgs(in);
+  detectBlueAround(in);
+  for (int blob = 0; blob < 40; ++blob) {
+    const int height = 24 + testRandom() % 40;
+    const int width = 24 + testRandom() % 40;
+    const int row = testRandom() % (IMG_HEIGHT - height);
+    const int col = testRandom() % (IMG_WIDTH - width);
+    trik_cv_algorithm_out_args out[2];
+    runBoth(TRIK_CV_ALGORITHM_OBJECT_SENSOR, in,
+      [&]() {
+        fillFrame(200);
+        drawBlob(row, col, height, width);
+      },
+      out);
+    compare(x, static_cast<int16_t>(out[0].targets[0].x), static_cast<int16_t>(out[1].targets[0].x));
+    compare(y, static_cast<int16_t>(out[0].targets[0].y), static_cast<int16_t>(out[1].targets[0].y));
+    compare(size, out[0].targets[0].size, out[1].targets[0].size);
+  }
+  report(x);
+  report(y);
+  report(size);
+}
+
+static void compareLines() {
+  Difference x = { "line x", LINE_BOUND, 0, 0, 0 };
+  Difference size = { "line size", 1, 0, 0, 0 };
+  trik_cv_algorithm_in_args in;
+  clearInArgs(in);
+  detectBlue(in);
+  for (int line = 0; line < 40; ++line) {
+    const int width = 12 + testRandom() % 30;
+    const int col = testRandom() % (IMG_WIDTH - width);
+    trik_cv_algorithm_out_args out[2];
+    runBoth(TRIK_CV_ALGORITHM_LINE_SENSOR, in,
+      [&]() {
+        fillFrame(200);
+        drawBlob(0, col, IMG_HEIGHT, width);
+      },
+      out);
+    compare(x, static_cast<int16_t>(out[0].targets[0].x), static_cast<int16_t>(out[1].targets[0].x));
+    compare(size, out[0].targets[0].size, out[1].targets[0].size);
+  }
+  report(x);
+  report(size);
+}
+
+static void compareEdgeLines() {
+  Difference rho = { "edge line rho", HOUGH_RHO_BOUND, 0, 0, 0 };
+  Difference theta = { "edge line theta", HOUGH_THETA_BOUND, 0, 0, 0 };
+  trik_cv_algorithm_in_args in;
+  clearInArgs(in);
+  for (int frame = 0; frame < 20; ++frame) {
+    // a bright bar and a slanted step, three edges
+    const int barCol = 20 + testRandom() % 200;
+    const int barWidth = 20 + testRandom() % 40;
+    const int stepOffset = 80 + testRandom() % 120;
+    trik_cv_algorithm_out_args out[2];
+    runBoth(TRIK_CV_ALGORITHM_EDGE_LINE_SENSOR, in,
+      [&]() {
+        for (int row = 0; row < IMG_HEIGHT; ++row)
+          for (int col = 0; col < IMG_WIDTH; ++col)
+            setPixel(row, col, (col >= barCol && col < barCol + barWidth) || col > row + stepOffset ? 220 : 40);
+      },
+      out);
+    const trik_cv_algorithm_out_edge_line& full = out[0].ext.edge_line;
+    const trik_cv_algorithm_out_edge_line& binned = out[1].ext.edge_line;
+    // weaker extra lines may show up binned, every line found at full resolution must be found too;
+    // lines are matched by their closest counterpart, both lists are ordered by votes which the resolution changes
+    CHECK(binned.line_count >= full.line_count, "frame %d: %d lines at full resolution, %d binned", frame, full.line_count, binned.line_count);
+    for (int i = 0; i < full.line_count; ++i) {
+      int best = -1;
+      int bestDistance = 0;
+      for (int j = 0; j < binned.line_count; ++j) {
+        const int distance = abs(full.lines[i].rho - binned.lines[j].rho) + abs(full.lines[i].theta - binned.lines[j].theta);
+        if (best < 0 || distance < bestDistance) {
+          best = j;
+          bestDistance = distance;
+        }
+      }
+      if (best >= 0) {
+        compare(rho, full.lines[i].rho, binned.lines[best].rho);
+        compare(theta, full.lines[i].theta, binned.lines[best].theta);
+      }
+    }
+  }
+  report(rho);
+  report(theta);
+}
+
+static void compareMotionVectors() {
+  Difference dx = { "motion vector dx", MOTION_BOUND, 0, 0, 0 };
+  Difference dy = { "motion vector dy", MOTION_BOUND, 0, 0, 0 };
+  trik_cv_algorithm_in_args in;
+  clearInArgs(in);
+  makeTexture();
+  for (int pan = 0; pan < 20; ++pan) {
+    const int stepX = static_cast<int>(testRandom() % 9) - 4;
+    const int stepY = static_cast<int>(testRandom() % 9) - 4;
+    trik_cv_algorithm_out_args out[2];
+    for (int bin = 0; bin < 2; ++bin) {
+      trik_init_cv_algorithm(TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR), bin, 0);
+      in.bin_2x2 = bin;
+      // the first frame has no predecessor, the second one is the pan
+      for (int frame = 0; frame < 2; ++frame) {
+        drawTexture(IMG_WIDTH / 2 + frame * stepX, IMG_HEIGHT / 2 + frame * stepY);
+        runSensor(TRIK_CV_ALGORITHM_MOTION_VECTOR_SENSOR, in, out[bin]);
+      }
+    }
+    compare(dx, out[0].ext.motion_vectors.global.dx, out[1].ext.motion_vectors.global.dx);
+    compare(dy, out[0].ext.motion_vectors.global.dy, out[1].ext.motion_vectors.global.dy);
+  }
+  report(dx);
+  report(dy);
+}
+
+int main() {
+  checkKernels();
+  compareObjects();
+  compareLines();
+  compareEdgeLines();
+  compareMotionVectors();
+  return testResult();
+}
@@ -0,0 +1,84 @@
+/*
+ * Synthetic frames and checks shared by the host tests and benchmarks.
+ */
+#ifndef TRIK_TEST_FRAMES_H_
+#define TRIK_TEST_FRAMES_H_
+
+#include <trik/sensors/cv_algorithm_args.h>
+
+#include <xdc/runtime/Timestamp.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// YUV422 input frame, Y then alternating U and V per pixel
+static uint8_t s_frame_t[IMG_WIDTH * IMG_HEIGHT * 2] __attribute__((aligned(128)));
+static uint8_t s_output_t[IMG_WIDTH * IMG_HEIGHT * 2] __attribute__((aligned(128), unused)); // not every program renders a preview
+static uint32_t s_random_t = 1;
+static uint32_t s_failures_t = 0;
+
+// xorshift, so frames do not depend on the host libc
+static inline uint32_t testRandom() {
+  s_random_t ^= s_random_t << 13;
+  s_random_t ^= s_random_t >> 17;
+  s_random_t ^= s_random_t << 5;
+  return s_random_t;
+}
+
+static inline void setPixel(const int _row, const int _col, const uint8_t _y, const uint8_t _u = 128, const uint8_t _v = 128) {
+  uint8_t* pixel = s_frame_t + (_row * IMG_WIDTH + _col) * 2;
+  pixel[0] = _y;
+  pixel[1] = _col % 2 ? _v : _u;
+}
+
+static inline void fillFrame(const uint8_t _y, const uint8_t _u = 128, const uint8_t _v = 128) {
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 0; col < IMG_WIDTH; ++col)
+      setPixel(row, col, _y, _u, _v);
+}
+
+// smooth random luma texture twice the frame size, drawTexture shows a frame sized part of it
+#define TEXTURE_CELL 8
+static uint8_t s_texture_t[2 * IMG_HEIGHT][2 * IMG_WIDTH];
+
+static inline void makeTexture() {
+  static uint8_t s_grid[2 * IMG_HEIGHT / TEXTURE_CELL + 2][2 * IMG_WIDTH / TEXTURE_CELL + 2];
+  for (int row = 0; row < 2 * IMG_HEIGHT / TEXTURE_CELL + 2; ++row)
+    for (int col = 0; col < 2 * IMG_WIDTH / TEXTURE_CELL + 2; ++col)
+      s_grid[row][col] = testRandom() % 200;
+  for (int row = 0; row < 2 * IMG_HEIGHT; ++row)
+    for (int col = 0; col < 2 * IMG_WIDTH; ++col) {
+      const int gridRow = row / TEXTURE_CELL;
+      const int gridCol = col / TEXTURE_CELL;
+      const int fy = row % TEXTURE_CELL;
+      const int fx = col % TEXTURE_CELL;
+      const int value = s_grid[gridRow][gridCol] * (TEXTURE_CELL - fy) * (TEXTURE_CELL - fx) + s_grid[gridRow + 1][gridCol] * fy * (TEXTURE_CELL - fx) +
+                        s_grid[gridRow][gridCol + 1] * (TEXTURE_CELL - fy) * fx + s_grid[gridRow + 1][gridCol + 1] * fy * fx;
+      s_texture_t[row][col] = value / (TEXTURE_CELL * TEXTURE_CELL) + testRandom() % 8;
+    }
+}
+
+static inline void drawTexture(const int _offsetX, const int _offsetY) {
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 0; col < IMG_WIDTH; ++col)
+      setPixel(row, col, s_texture_t[row + _offsetY][col + _offsetX]);
+}
+
+#define CHECK(_cond, ...)                          \
+  do {                                             \
+    if (!(_cond)) {                                \
+      printf("%s:%d: FAILED ", __FILE__, __LINE__); \
+      printf(__VA_ARGS__);                         \
+      printf("\n");                                \
+      ++s_failures_t;                              \
+    }                                              \
+  } while (0)
+
+static inline int testResult() {
+  if (s_failures_t != 0)
+    printf("%u checks failed\n", s_failures_t);
+  return s_failures_t != 0;
+}
+
+#endif
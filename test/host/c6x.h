@@ -0,0 +1,134 @@
+/*
+ * Portable stand-ins for the C6x intrinsics used by the DSP sensors, so their headers build with a host compiler.
+ * Only the semantics the sensors rely on are modelled.
+ */
+#ifndef TRIK_TEST_HOST_C6X_H_
+#define TRIK_TEST_HOST_C6X_H_
+
+#include <stdint.h>
+
+static inline uint32_t _loll(uint64_t x) { return (uint32_t) x; }
+static inline uint32_t _hill(uint64_t x) { return (uint32_t) (x >> 32); }
+static inline uint64_t _itoll(uint32_t h, uint32_t l) { return ((uint64_t) h << 32) | l; }
+
+static inline uint32_t host_byte(uint32_t x, int i) { return (x >> (8 * i)) & 0xff; }
+
+static inline uint32_t _cmpltu4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    if (host_byte(a, i) < host_byte(b, i))
+      r |= 1u << i;
+  return r;
+}
+static inline uint32_t _cmpgtu4(uint32_t a, uint32_t b) { return _cmpltu4(b, a); }
+static inline uint32_t _cmpeq4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    if (host_byte(a, i) == host_byte(b, i))
+      r |= 1u << i;
+  return r;
+}
+static inline uint32_t _cmpeq2(uint32_t a, uint32_t b) { return ((a & 0xffff) == (b & 0xffff)) | (((a >> 16) == (b >> 16)) << 1); }
+
+static inline uint32_t _packl4(uint32_t a, uint32_t b) { return host_byte(a, 2) << 24 | host_byte(a, 0) << 16 | host_byte(b, 2) << 8 | host_byte(b, 0); }
+static inline uint32_t _packh4(uint32_t a, uint32_t b) { return host_byte(a, 3) << 24 | host_byte(a, 1) << 16 | host_byte(b, 3) << 8 | host_byte(b, 1); }
+static inline uint32_t _pack2(uint32_t a, uint32_t b) { return (a << 16) | (b & 0xffff); }
+static inline uint32_t _packh2(uint32_t a, uint32_t b) { return (a & 0xffff0000) | (b >> 16); }
+static inline uint32_t _packlh2(uint32_t a, uint32_t b) { return (a << 16) | (b >> 16); }
+static inline uint32_t _packhl2(uint32_t a, uint32_t b) { return (a & 0xffff0000) | (b & 0xffff); }
+static inline uint32_t _unpkhu4(uint32_t a) { return host_byte(a, 3) << 16 | host_byte(a, 2); }
+static inline uint32_t _unpklu4(uint32_t a) { return host_byte(a, 1) << 16 | host_byte(a, 0); }
+static inline uint32_t _swap4(uint32_t a) { return ((a & 0x00ff00ffu) << 8) | ((a >> 8) & 0x00ff00ffu); }
+
+static inline uint32_t _maxu4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r |= (host_byte(a, i) > host_byte(b, i) ? host_byte(a, i) : host_byte(b, i)) << (8 * i);
+  return r;
+}
+static inline uint32_t _minu4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r |= (host_byte(a, i) < host_byte(b, i) ? host_byte(a, i) : host_byte(b, i)) << (8 * i);
+  return r;
+}
+static inline uint32_t _avgu4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r |= ((host_byte(a, i) + host_byte(b, i) + 1) >> 1) << (8 * i);
+  return r;
+}
+static inline uint32_t _subabs4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r |= (host_byte(a, i) > host_byte(b, i) ? host_byte(a, i) - host_byte(b, i) : host_byte(b, i) - host_byte(a, i)) << (8 * i);
+  return r;
+}
+static inline uint32_t _dotpu4(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r += host_byte(a, i) * host_byte(b, i);
+  return r;
+}
+static inline int32_t _dotpus4(uint32_t a, uint32_t b) {
+  int32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r += (int32_t) host_byte(a, i) * (int8_t) host_byte(b, i);
+  return r;
+}
+static inline int32_t _dotp2(uint32_t a, uint32_t b) { return (int16_t) (a >> 16) * (int16_t) (b >> 16) + (int16_t) a * (int16_t) b; }
+static inline int32_t _dotpn2(uint32_t a, uint32_t b) { return (int16_t) (a >> 16) * (int16_t) (b >> 16) - (int16_t) a * (int16_t) b; }
+static inline int32_t _mpy(int32_t a, int32_t b) { return (int16_t) a * (int16_t) b; }
+static inline uint64_t _mpyu4ll(uint32_t a, uint32_t b) {
+  uint64_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r |= (uint64_t) (host_byte(a, i) * host_byte(b, i)) << (16 * i);
+  return r;
+}
+static inline uint32_t _add2(uint32_t a, uint32_t b) { return ((a + (b & 0xffff0000)) & 0xffff0000) | ((a + b) & 0xffff); }
+static inline uint32_t _shr2(uint32_t a, uint32_t s) { return ((uint32_t) (uint16_t) ((int16_t) (a >> 16) >> s) << 16) | (uint16_t) ((int16_t) a >> s); }
+static inline uint32_t host_sat8(int16_t v) { return v < 0 ? 0 : v > 255 ? 255 : v; }
+static inline uint32_t _spacku4(uint32_t a, uint32_t b) { return host_sat8(a >> 16) << 24 | host_sat8(a) << 16 | host_sat8(b >> 16) << 8 | host_sat8(b); }
+
+static inline uint32_t _clr(uint32_t a, uint32_t lo, uint32_t hi) {
+  const uint32_t mask = (hi >= 31 ? 0xffffffffu : ((1u << (hi + 1)) - 1)) & ~((1u << lo) - 1);
+  return a & ~mask;
+}
+static inline uint32_t _bitc4(uint32_t a) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    r |= (uint32_t) __builtin_popcount(host_byte(a, i)) << (8 * i);
+  return r;
+}
+static inline uint32_t _xpnd4(uint32_t a) {
+  uint32_t r = 0;
+  for (int i = 0; i < 4; i++)
+    if (a & (1u << i))
+      r |= 0xffu << (8 * i);
+  return r;
+}
+static inline uint32_t _lmbd(uint32_t bit, uint32_t a) {
+  const uint32_t x = bit ? a : ~a;
+  return x ? __builtin_clz(x) : 32;
+}
+static inline uint32_t _rotl(uint32_t a, uint32_t n) {
+  n &= 31;
+  return n ? (a << n) | (a >> (32 - n)) : a;
+}
+static inline int32_t _abs(int32_t a) { return a < 0 ? -a : a; }
+static inline int32_t _sadd(int32_t a, int32_t b) {
+  const int64_t sum = (int64_t) a + b;
+  return sum > INT32_MAX ? INT32_MAX : sum < INT32_MIN ? INT32_MIN : (int32_t) sum;
+}
+
+static inline uint64_t _mem8_const(const void* p) { return *(const uint64_t*) p; }
+static inline uint64_t _amem8_const(const void* p) { return *(const uint64_t*) p; }
+static inline uint32_t _mem4_const(const void* p) { return *(const uint32_t*) p; }
+static inline uint32_t _amem4_const(const void* p) { return *(const uint32_t*) p; }
+#define _amem8(p) (*(uint64_t*) (p))
+#define _amem4(p) (*(uint32_t*) (p))
+#define _mem8(p) (*(uint64_t*) (p))
+#define _mem4(p) (*(uint32_t*) (p))
+#define _nassert(x)
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TRIK_TEST_HOST_MESSAGEQ_H_
+#define TRIK_TEST_HOST_MESSAGEQ_H_
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// a server built for the host gets its messages from the test driving it, see schedule_test.cpp
+typedef struct {
+  uint32_t unused[8];
+} MessageQ_MsgHeader;
+typedef MessageQ_MsgHeader* MessageQ_Msg;
+typedef void* MessageQ_Handle;
+typedef uint32_t MessageQ_QueueId;
+typedef struct {
+  int unused;
+} MessageQ_Params;
+
+#define MessageQ_FOREVER (~0u)
+
+#define MessageQ_Params_init(params) ((void) (params))
+#define MessageQ_create(name, params) ((MessageQ_Handle) 1)
+#define MessageQ_delete(handle) 0
+#define MessageQ_getReplyQueue(msg) ((MessageQ_QueueId) 0)
+
+int MessageQ_get(MessageQ_Handle handle, MessageQ_Msg* msg, uint32_t timeout);
+int MessageQ_put(MessageQ_QueueId queue, MessageQ_Msg msg);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef TRIK_TEST_HOST_MULTIPROC_H_
+#define TRIK_TEST_HOST_MULTIPROC_H_
+
+#include <stdint.h>
+
+#define MultiProc_getId(name) ((uint16_t) 0)
+#define MultiProc_self() ((uint16_t) 1)
+#define MultiProc_getName(id) "DSP"
+
+#endif
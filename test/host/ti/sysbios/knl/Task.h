@@ -0,0 +1,3 @@
+#ifndef TRIK_TEST_HOST_TASK_H_
+#define TRIK_TEST_HOST_TASK_H_
+#endif
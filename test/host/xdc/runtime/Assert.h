@@ -0,0 +1,10 @@
+#ifndef TRIK_TEST_HOST_ASSERT_H_
+#define TRIK_TEST_HOST_ASSERT_H_
+
+#include <assert.h>
+
+typedef void* Assert_Id;
+
+#define Assert_isTrue(cond, id) assert(cond)
+
+#endif
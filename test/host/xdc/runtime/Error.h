@@ -0,0 +1,3 @@
+#ifndef TRIK_TEST_HOST_ERROR_H_
+#define TRIK_TEST_HOST_ERROR_H_
+#endif
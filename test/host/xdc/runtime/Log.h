@@ -0,0 +1,11 @@
+#ifndef TRIK_TEST_HOST_LOG_H_
+#define TRIK_TEST_HOST_LOG_H_
+
+#include <xdc/runtime/Diags.h>
+
+#define Log_print0(mask, fmt) ((void) 0)
+#define Log_print1(mask, fmt, a) ((void) 0)
+#define Log_print2(mask, fmt, a, b) ((void) 0)
+#define Log_error1(fmt, a) ((void) 0)
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef TRIK_TEST_HOST_TIMESTAMP_H_
+#define TRIK_TEST_HOST_TIMESTAMP_H_
+
+#include <stdint.h>
+#include <time.h>
+
+// host nanoseconds stand in for DSP timestamp ticks, only differences are meaningful
+static inline uint32_t Timestamp_get32(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t) (now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef TRIK_TEST_HOST_STD_H_
+#define TRIK_TEST_HOST_STD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int Int;
+typedef void Void;
+typedef int Bool;
+typedef uint16_t UInt16;
+typedef uint32_t UInt32;
+typedef intptr_t IArg;
+
+#define TRUE 1
+#define FALSE 0
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * Edge density against Hough stage time: three known lines plus scattered noise edges at a growing density.
+ * Voting grows with the point count until HOUGH_MAX_POINTS, past it the stride cap keeps the time flat while the
+ * lines are still found. The time of an empty map (counting pass, accumulator clear and peak search) is taken as the
+ * fixed part, the rest divided by the points is the voting cost per point, and "uncapped" extrapolates it to voting
+ * every edge.
+ */
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include "frames.h"
+
+#include <stdlib.h>
+
+using namespace trik::sensors;
+
+static uint8_t s_edges_t[IMG_WIDTH * IMG_HEIGHT];
+
+static const struct {
+  int rho;
+  int theta;
+} s_lines_t[] = { { 40, 0 }, { -60, 90 }, { 30, 136 } };
+static const int s_lineCount_t = sizeof(s_lines_t) / sizeof(s_lines_t[0]);
+
+static void drawEdges(const uint32_t _noisePermille) {
+  memset(s_edges_t, 0, sizeof(s_edges_t));
+  for (int line = 0; line < s_lineCount_t; ++line) {
+    const float theta = s_lines_t[line].theta * 3.1415927f / 180;
+    const float c = std::cos(theta);
+    const float s = std::sin(theta);
+    for (int row = 0; row < IMG_HEIGHT; ++row)
+      for (int col = 0; col < IMG_WIDTH; ++col)
+        if (std::fabs((col - IMG_WIDTH / 2) * c + (row - IMG_HEIGHT / 2) * s - s_lines_t[line].rho) < 0.5f)
+          s_edges_t[row * IMG_WIDTH + col] = 0xff;
+  }
+  for (int pixel = 0; pixel < IMG_WIDTH * IMG_HEIGHT; ++pixel)
+    if (testRandom() % 1000 < _noisePermille)
+      s_edges_t[pixel] = 0xff;
+}
+
+static int foundLines(const trik_cv_algorithm_out_edge_line& _out) {
+  int found = 0;
+  for (int line = 0; line < s_lineCount_t; ++line)
+    for (int i = 0; i < _out.line_count; ++i)
+      if (abs(_out.lines[i].rho - s_lines_t[line].rho) <= 2 && abs(_out.lines[i].theta - s_lines_t[line].theta) <= 2) {
+        ++found;
+        break;
+      }
+  return found;
+}
+
+int main() {
+  ImageDesc imageDesc;
+  imageDesc.m_width = IMG_WIDTH;
+  imageDesc.m_height = IMG_HEIGHT;
+  imageDesc.m_lineLength = IMG_WIDTH;
+  imageDesc.m_format = VideoFormat::YUV422;
+  HoughLineDetector detector;
+  detector.setup(imageDesc);
+
+  static const uint32_t s_repeats = 200;
+  trik_cv_algorithm_out_edge_line out;
+  memset(s_edges_t, 0, sizeof(s_edges_t));
+  uint32_t fixed = ~0u;
+  for (uint32_t repeat = 0; repeat < s_repeats; ++repeat) {
+    detector.run(s_edges_t, out);
+    if (out.hough_cycles < fixed)
+      fixed = out.hough_cycles;
+  }
+  printf("empty map %u ns\n", fixed);
+
+  static const uint32_t s_noise[] = { 0, 5, 10, 20, 40, 60, 100, 200, 400 };
+  printf("noise%%  edges  stride  points  ns/frame  ns/point  uncapped ns  lines\n");
+  for (uint32_t n = 0; n < sizeof(s_noise) / sizeof(s_noise[0]); ++n) {
+    drawEdges(s_noise[n]);
+    uint32_t edges = 0;
+    for (int row = HOUGH_BORDER; row < IMG_HEIGHT - HOUGH_BORDER; ++row)
+      for (int col = HOUGH_BORDER; col < IMG_WIDTH - HOUGH_BORDER; ++col)
+        edges += s_edges_t[row * IMG_WIDTH + col] == 0xff;
+
+    uint32_t best = ~0u;
+    for (uint32_t repeat = 0; repeat < s_repeats; ++repeat) {
+      detector.run(s_edges_t, out);
+      if (out.hough_cycles < best)
+        best = out.hough_cycles;
+    }
+    const uint32_t stride = (edges + HOUGH_MAX_POINTS - 1) / HOUGH_MAX_POINTS;
+    const float perPoint = out.edge_points && best > fixed ? static_cast<float>(best - fixed) / out.edge_points : 0;
+    printf("%5.1f  %6u  %6u  %6u  %8u  %8.1f  %11.0f  %d/%d\n", s_noise[n] / 10.0, edges, stride, out.edge_points, best, perPoint, fixed + perPoint * edges,
+      foundLines(out), s_lineCount_t);
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Grid undistortion against a float reference of the radial model. LensUndistortion solves the inverse model by
+ * Newton steps on the 21x16 nodes of a 20x15 cell grid only, and interpolates points bilinearly in Q4 pixels. The
+ * reference inverts r_d = r_u (1 + k1 r_u^2 + k2 r_u^4) for every pixel by bisection, independently of the Newton
+ * solver, and the grid result must stay within LENS_MAX_ERROR full frame pixels of it over the whole frame, at full
+ * resolution and binned.
+ *
+ * The interpolation error grows with the curvature of the model across a cell, so it is largest in the corners of
+ * strong lenses: up to 0.76 pixels for the strong barrel lens below, with a mean of about 0.15 pixels, and under a
+ * quarter of a pixel for the others.
+ *
+ * A barrel lens moves the frame corners outwards, so their undistorted points fall outside of the frame. The floor
+ * projection calibrated through the lens must still project these points, within FLOOR_CORNER_ERROR of the
+ * homography it was calibrated from.
+ */
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include "frames.h"
+
+#include <cmath>
+
+#define LENS_MAX_ERROR 1.0       // full frame pixels, anywhere in the frame
+#define LENS_MEAN_ERROR 0.2      // full frame pixels, averaged over the frame
+#define LENS_MODEL_TOLERANCE 1e-6 // full frame pixels, the reference against the forward model
+#define FLOOR_CORNER_ERROR 1.5    // millimetres, the rounding of the calibration and of the table terms
+
+using namespace trik::sensors;
+
+static double forwardRadius(const trik_cv_algorithm_lens& _lens, const double _r) {
+  const double r2 = _r * _r;
+  return _r * (1 + _lens.k1 / 10000.0 * r2 + _lens.k2 / 10000.0 * r2 * r2);
+}
+
+// undistorted full frame point of a distorted one, by bisection on the monotonic part of the model
+static void undistortReference(const trik_cv_algorithm_lens& _lens, double& _u, double& _v) {
+  const double centerU = (IMG_WIDTH - 1) / 2.0;
+  const double centerV = (IMG_HEIGHT - 1) / 2.0;
+  const double x = (_u - centerU) / _lens.focal;
+  const double y = (_v - centerV) / _lens.focal;
+  const double distorted = std::sqrt(x * x + y * y);
+  if (distorted == 0)
+    return;
+
+  double low = 0;
+  double high = 4 * distorted + 1;
+  for (int step = 0; step < 200; ++step) {
+    const double middle = (low + high) / 2;
+    if (forwardRadius(_lens, middle) < distorted)
+      low = middle;
+    else
+      high = middle;
+  }
+  const double scale = (low + high) / 2 / distorted;
+  _u = centerU + x * scale * _lens.focal;
+  _v = centerV + y * scale * _lens.focal;
+}
+
+static void distortReference(const trik_cv_algorithm_lens& _lens, double& _u, double& _v) {
+  const double centerU = (IMG_WIDTH - 1) / 2.0;
+  const double centerV = (IMG_HEIGHT - 1) / 2.0;
+  const double x = (_u - centerU) / _lens.focal;
+  const double y = (_v - centerV) / _lens.focal;
+  const double undistorted = std::sqrt(x * x + y * y);
+  const double scale = undistorted > 0 ? forwardRadius(_lens, undistorted) / undistorted : 1;
+  _u = centerU + x * scale * _lens.focal;
+  _v = centerV + y * scale * _lens.focal;
+}
+
+// undistorted full frame pixels to millimetres, the horizon well above the frame
+static void floorReference(const double _u, const double _v, double& _x, double& _y) {
+  const double den = 1 + 0.002 * _v;
+  _x = 2 * (_u - (IMG_WIDTH - 1) / 2.0) / den;
+  _y = 3 * (IMG_HEIGHT + 160 - _v) / den;
+}
+
+// frame corners undistorted by the grid, then projected with a calibration taken through the same lens
+static void checkFloorCorners(const char* _name, const trik_cv_algorithm_lens& _model, const uint32_t _scale) {
+  const uint32_t width = IMG_WIDTH / _scale;
+  const uint32_t height = IMG_HEIGHT / _scale;
+  trik_cv_algorithm_in_args inArgs;
+  memset(&inArgs, 0, sizeof(inArgs));
+  inArgs.lens = _model;
+  static const uint16_t s_calibration[4][2] = { { 20, 20 }, { 300, 20 }, { 20, 220 }, { 300, 220 } };
+  for (uint32_t i = 0; i < 4; ++i) {
+    double u = s_calibration[i][0];
+    double v = s_calibration[i][1];
+    undistortReference(_model, u, v);
+    double x;
+    double y;
+    floorReference(u, v, x, y);
+    inArgs.floor.image[i].x = s_calibration[i][0];
+    inArgs.floor.image[i].y = s_calibration[i][1];
+    inArgs.floor.floor[i].x = std::floor(x + 0.5);
+    inArgs.floor.floor[i].y = std::floor(y + 0.5);
+  }
+
+  LensUndistortion lens;
+  lens.setup(width, height);
+  lens.configure(inArgs);
+  FloorProjection floor;
+  floor.setup(width, height);
+  floor.configure(inArgs);
+  CHECK(floor.valid(), "%s scale %u: calibration rejected", _name, _scale);
+
+  for (uint32_t corner = 0; corner < 4; ++corner) {
+    const int32_t frameCol = corner & 1 ? width - 1 : 0;
+    const int32_t frameRow = corner & 2 ? height - 1 : 0;
+    int32_t col = frameCol;
+    int32_t row = frameRow;
+    lens.undistort(col, row);
+    const bool outside = col < 0 || row < 0 || col >= static_cast<int32_t>(width) || row >= static_cast<int32_t>(height);
+    CHECK(outside, "%s scale %u: corner %d,%d stays in the frame at %d,%d", _name, _scale, frameCol, frameRow, col, row);
+
+    const double u = (col + 0.5) * _scale - 0.5;
+    const double v = (row + 0.5) * _scale - 0.5;
+    double x;
+    double y;
+    floorReference(u, v, x, y);
+    trik_cv_algorithm_floor_point point;
+    const bool projected = floor.project(col, row, point);
+    CHECK(projected, "%s scale %u: corner %d,%d undistorted to %d,%d not projected", _name, _scale, frameCol, frameRow, col, row);
+    if (projected)
+      CHECK(std::hypot(point.x - x, point.y - y) <= FLOOR_CORNER_ERROR, "%s scale %u: corner %d,%d at %d,%d mm, %.1f,%.1f expected", _name, _scale,
+        frameCol, frameRow, point.x, point.y, x, y);
+  }
+}
+
+int main() {
+  static const struct {
+    const char* name;
+    trik_cv_algorithm_lens lens;
+  } s_lenses[] = {
+    { "strong barrel", { 260, -2800, 600 } },
+    { "barrel", { 300, -1500, 0 } },
+    { "pincushion", { 400, 900, 0 } },
+  };
+
+  for (uint32_t l = 0; l < sizeof(s_lenses) / sizeof(s_lenses[0]); ++l)
+    for (int binned = 0; binned < 2; ++binned) {
+      const trik_cv_algorithm_lens& model = s_lenses[l].lens;
+      const uint32_t scale = binned ? 2 : 1;
+      const uint32_t width = IMG_WIDTH / scale;
+      const uint32_t height = IMG_HEIGHT / scale;
+      LensUndistortion lens;
+      lens.setup(width, height);
+      trik_cv_algorithm_in_args inArgs;
+      memset(&inArgs, 0, sizeof(inArgs));
+      inArgs.lens = model;
+      lens.configure(inArgs);
+      CHECK(lens.enabled(), "%s: not enabled", s_lenses[l].name);
+
+      double maxError = 0;
+      double sumError = 0;
+      double maxResidual = 0;
+      for (uint32_t row = 0; row < height; ++row)
+        for (uint32_t col = 0; col < width; ++col) {
+          // pixel centers of the sensor frame in full frame pixels
+          const double u = (col + 0.5) * scale - 0.5;
+          const double v = (row + 0.5) * scale - 0.5;
+          double referenceU = u;
+          double referenceV = v;
+          undistortReference(model, referenceU, referenceV);
+          double backU = referenceU;
+          double backV = referenceV;
+          distortReference(model, backU, backV);
+          maxResidual = std::max(maxResidual, std::hypot(backU - u, backV - v));
+
+          int32_t colQ4 = col * 16;
+          int32_t rowQ4 = row * 16;
+          lens.undistortQ4(colQ4, rowQ4);
+          const double gridU = (colQ4 / 16.0 + 0.5) * scale - 0.5;
+          const double gridV = (rowQ4 / 16.0 + 0.5) * scale - 0.5;
+          const double error = std::hypot(gridU - referenceU, gridV - referenceV);
+          maxError = std::max(maxError, error);
+          sumError += error;
+        }
+
+      const double meanError = sumError / (width * height);
+      printf("%-14s binned %d: max %.3f mean %.3f pixels, reference residual %.1e\n", s_lenses[l].name, binned, maxError, meanError, maxResidual);
+      CHECK(maxResidual < LENS_MODEL_TOLERANCE, "%s: reference off the model by %g", s_lenses[l].name, maxResidual);
+      CHECK(maxError <= LENS_MAX_ERROR, "%s binned %d: grid off by %.3f pixels", s_lenses[l].name, binned, maxError);
+      CHECK(meanError <= LENS_MEAN_ERROR, "%s binned %d: grid off by %.3f pixels on average", s_lenses[l].name, binned, meanError);
+      if (model.k1 < 0)
+        checkFloorCorners(s_lenses[l].name, model, scale);
+    }
+
+  // a lens without distortion leaves points alone
+  LensUndistortion identity;
+  identity.setup(IMG_WIDTH, IMG_HEIGHT);
+  trik_cv_algorithm_in_args inArgs;
+  memset(&inArgs, 0, sizeof(inArgs));
+  identity.configure(inArgs);
+  int32_t col = 17;
+  int32_t row = 33;
+  identity.undistort(col, row);
+  CHECK(!identity.enabled() && col == 17 && row == 33, "disabled lens moved 17,33 to %d,%d", col, row);
+  return testResult();
+}
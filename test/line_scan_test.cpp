@@ -0,0 +1,136 @@
+/*
+ * The line sensor detects pixels through the bit-packed span path of CvAlgorithm::detectHsvRow and takes row counts
+ * and column sums from popcounts of the masks. LineScanReference keeps the per-pixel loop it replaced, counting and
+ * summing every detected pixel as it goes; both must give the same projection for every row, on random scenes with
+ * and without ROIs, row sampling and the checkerboard.
+ */
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include "frames.h"
+
+#include <stdlib.h>
+
+using namespace trik::sensors;
+
+class LineScanReference : public LineSensorCvAlgorithm {
+public:
+  // the line sensor loop before the span path, preview writes left out; ROIs and sampling are the ones of the last run
+  void scan(const trik_cv_algorithm_in_args& _inArgs, uint32_t* _rowPoints, uint32_t* _rowCols) const {
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint32_t detectHueFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_hue_from) * 255) / 359, 255);
+    const uint32_t detectHueTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_hue_to) * 255) / 359, 255);
+    const uint32_t detectSatFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_sat_from) * 255) / 100, 255);
+    const uint32_t detectSatTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_sat_to) * 255) / 100, 255);
+    const uint32_t detectValFrom = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_from) * 255) / 100, 255);
+    const uint32_t detectValTo = range<int32_t>(0, (static_cast<int32_t>(_inArgs.detect_val_to) * 255) / 100, 255);
+    uint64_t u64_hsv_range;
+    uint32_t u32_hsv_expect;
+    if (detectHueFrom <= detectHueTo) {
+      u64_hsv_range = _itoll((detectValFrom << 16) | (detectSatFrom << 8) | detectHueFrom, (detectValTo << 16) | (detectSatTo << 8) | detectHueTo);
+      u32_hsv_expect = 0x0;
+    } else {
+      u64_hsv_range = _itoll((detectValFrom << 16) | (detectSatFrom << 8) | (detectHueTo + 1), (detectValTo << 16) | (detectSatTo << 8) | (detectHueFrom - 1));
+      u32_hsv_expect = 0x1;
+    }
+
+    RoiSpan spans[TRIK_MAX_ROIS];
+    for (uint32_t srcRow = 0; srcRow < m_inImageDesc.m_height; ++srcRow) {
+      uint32_t targetPointsPerRow = 0;
+      uint32_t targetPointsCol = 0;
+      if (srcRow >= m_roiRowBegin && srcRow < m_roiRowEnd && isSampledRow(srcRow)) {
+        const uint32_t spanCount = roiRowSpans(srcRow, spans);
+        const uint32_t pairOffset = samplePairOffset(srcRow);
+        for (uint32_t span = 0; span < spanCount && m_sampleCheckerboard; ++span)
+          for (uint32_t srcCol = spans[span].m_begin + pairOffset; srcCol < spans[span].m_end; srcCol += 4)
+            for (uint32_t pix = 0; pix < 2; ++pix) {
+              const uint32_t col = srcCol + pix;
+              if (col >= 5 && col <= width - 5) {
+                const bool det = detectHsvPixel(_loll(s_rgb888hsv[srcRow * width + col]), u64_hsv_range, u32_hsv_expect);
+                targetPointsPerRow += det;
+                targetPointsCol += det ? col : 0;
+              }
+            }
+
+        for (uint32_t span = 0; span < spanCount && !m_sampleCheckerboard; ++span)
+          for (uint32_t srcCol = spans[span].m_begin; srcCol < spans[span].m_end; ++srcCol)
+            if (srcCol >= 5 && srcCol <= width - 5) {
+              const bool det = detectHsvPixel(_loll(s_rgb888hsv[srcRow * width + srcCol]), u64_hsv_range, u32_hsv_expect);
+              targetPointsPerRow += det;
+              targetPointsCol += det ? srcCol : 0;
+            }
+      }
+      _rowPoints[srcRow] = targetPointsPerRow;
+      _rowCols[srcRow] = targetPointsCol;
+    }
+  }
+};
+
+static LineScanReference s_sensor_t;
+
+// up to three slanted bands of line color and scattered single pixels of it over a gray floor
+static void drawScene() {
+  fillFrame(128);
+  const int bands = 1 + testRandom() % 3;
+  for (int band = 0; band < bands; ++band) {
+    const int col = testRandom() % IMG_WIDTH;
+    const int width = 5 + testRandom() % 40;
+    const int slant = static_cast<int>(testRandom() % 5) - 2;
+    for (int row = 0; row < IMG_HEIGHT; ++row)
+      for (int c = col + slant * row / 4; c < col + slant * row / 4 + width; ++c)
+        if (c >= 0 && c < IMG_WIDTH)
+          setPixel(row, c, 41, 240, 110);
+  }
+  for (int pixel = 0; pixel < 200; ++pixel)
+    setPixel(testRandom() % IMG_HEIGHT, testRandom() % IMG_WIDTH, 41, 240, 110);
+}
+
+int main() {
+  const ImageDesc inDesc = { IMG_WIDTH, IMG_HEIGHT, IMG_WIDTH * 2, VideoFormat::YUV422 };
+  const ImageDesc outDesc = { IMG_WIDTH, IMG_HEIGHT, IMG_WIDTH * 2, VideoFormat::RGB565X };
+  static int8_t s_fastRam[4096];
+  CHECK(s_sensor_t.setup(inDesc, outDesc, s_fastRam, sizeof(s_fastRam)), "setup");
+  ImageBuffer in = { reinterpret_cast<int8_t*>(s_frame_t), sizeof(s_frame_t) };
+
+  static uint32_t s_rowPoints[IMG_HEIGHT];
+  static uint32_t s_rowCols[IMG_HEIGHT];
+  uint32_t rows = 0;
+  uint32_t pixels = 0;
+  for (int scene = 0; scene < 60; ++scene) {
+    drawScene();
+    trik_cv_algorithm_in_args inArgs;
+    memset(&inArgs, 0, sizeof(inArgs));
+    inArgs.detect_hue_from = 200;
+    inArgs.detect_hue_to = 280;
+    inArgs.detect_sat_from = 40;
+    inArgs.detect_sat_to = 100;
+    inArgs.detect_val_from = 10;
+    inArgs.detect_val_to = 100;
+    inArgs.preview = scene % 2 ? TRIK_PREVIEW_FULL : TRIK_PREVIEW_NONE;
+    inArgs.sample_stride = 1 + scene % 3;
+    inArgs.sample_checkerboard = scene % 4 == 3;
+    inArgs.line_bands = 6;
+    if (scene % 5 == 4) {
+      inArgs.roi_count = 2;
+      inArgs.rois[0] = (trik_cv_algorithm_roi){ 30, 20, 100, 90 };
+      inArgs.rois[1] = (trik_cv_algorithm_roi){ 90, 100, 200, 120 };
+    }
+
+    // sampling phases rotate from frame to frame
+    for (int frame = 0; frame < 3; ++frame) {
+      ImageBuffer out = { reinterpret_cast<int8_t*>(s_output_t), sizeof(s_output_t) };
+      trik_cv_algorithm_out_args outArgs;
+      memset(&outArgs, 0, sizeof(outArgs));
+      LineScanReference::startFrame();
+      CHECK(s_sensor_t.run(in, out, inArgs, outArgs), "scene %d frame %d: run", scene, frame);
+      s_sensor_t.scan(inArgs, s_rowPoints, s_rowCols);
+      for (int row = 0; row < IMG_HEIGHT; ++row) {
+        CHECK(s_rowCounts_lp[row] == s_rowPoints[row] && s_rowCols_lp[row] == s_rowCols[row], "scene %d frame %d row %d: %u pixels at %u, reference %u at %u", scene,
+          frame, row, s_rowCounts_lp[row], s_rowCols_lp[row], s_rowPoints[row], s_rowCols[row]);
+        rows += s_rowPoints[row] != 0;
+        pixels += s_rowPoints[row];
+      }
+    }
+  }
+  printf("%u rows with %u line pixels match the per-pixel reference\n", rows, pixels);
+  return testResult();
+}
@@ -0,0 +1,58 @@
+/*
+ * Runs sensors through the C API of dsp/src/cv_algorithms.cpp on the synthetic frames of frames.h.
+ */
+#ifndef TRIK_TEST_PIPELINE_H_
+#define TRIK_TEST_PIPELINE_H_
+
+#include <trik/sensors/cv_algorithms.h>
+
+#include "frames.h"
+
+static trik_cv_algorithm_draw_list s_drawList_t;
+static trik_cv_algorithm_results s_results_t;
+
+static inline void clearInArgs(trik_cv_algorithm_in_args& _inArgs) {
+  memset(&_inArgs, 0, sizeof(_inArgs));
+  _inArgs.width_n = 1;
+  _inArgs.height_n = 1;
+}
+
+// the HSV range of the blue drawn by drawBlob, as bounds for the line sensor
+static inline void detectBlue(trik_cv_algorithm_in_args& _inArgs) {
+  _inArgs.detect_hue_from = 200;
+  _inArgs.detect_hue_to = 280;
+  _inArgs.detect_sat_from = 40;
+  _inArgs.detect_sat_to = 100;
+  _inArgs.detect_val_from = 10;
+  _inArgs.detect_val_to = 100;
+}
+
+// the same range as center and tolerance, the way the object sensor reads it
+static inline void detectBlueAround(trik_cv_algorithm_in_args& _inArgs) {
+  _inArgs.detect_hue_from = 240;
+  _inArgs.detect_hue_to = 40;
+  _inArgs.detect_sat_from = 70;
+  _inArgs.detect_sat_to = 30;
+  _inArgs.detect_val_from = 55;
+  _inArgs.detect_val_to = 45;
+}
+
+static inline void drawBlob(const int _row, const int _col, const int _height, const int _width) {
+  for (int row = _row; row < _row + _height; ++row)
+    for (int col = _col; col < _col + _width; ++col)
+      setPixel(row, col, 41, 240, 110);
+}
+
+// returns the time trik_run_cv_algorithm took in host nanoseconds, 0 when it failed
+static inline uint32_t runSensor(const trik_cv_algorithm _algorithm, const trik_cv_algorithm_in_args& _inArgs, trik_cv_algorithm_out_args& _outArgs) {
+  buffer in = { s_frame_t, sizeof(s_frame_t) };
+  buffer out = { s_output_t, sizeof(s_output_t) };
+  const uint32_t startTime = Timestamp_get32();
+  const uint32_t sensor = TRIK_CV_ALGORITHM_BIT(_algorithm);
+  const int ran = trik_run_cv_algorithm(sensor, _inArgs.auto_detect_hsv ? sensor : 0, in, out, &s_drawList_t, _inArgs, &s_results_t);
+  const uint32_t time = Timestamp_get32() - startTime;
+  _outArgs = s_results_t.out_args[_algorithm];
+  return ran ? (time > 0 ? time : 1) : 0;
+}
+
+#endif
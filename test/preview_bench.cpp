@@ -0,0 +1,120 @@
+/*
+ * FULL preview background before and after IMG_ycbcr422pl_to_rgb565. The sensors used to pack every pixel of
+ * s_rgb888hsv to RGB565 on their own, as the MxN loop kept here does, over the RGB the HSV conversion had left there;
+ * now the frame is demuxed to planes and converted by the kernel, or gathered per output row for a reduced preview.
+ * The per-pixel time leaves the HSV conversion out, sensors needed it anyway. On the host the kernel is its C
+ * reference, slower than the per-pixel loop on a full frame, the DSP runs the hand-scheduled library version.
+ * The largest channel difference between both backgrounds is printed in RGB565 units: both use BT.601 studio range
+ * but round differently, and a reduced preview used to keep the last pixel of every n x n block, now the first.
+ */
+#include <trik/sensors/cv_algorithms.hpp>
+
+#include "frames.h"
+
+#include <stdlib.h>
+
+using namespace trik::sensors;
+
+#define BENCH_REPEATS 50
+
+class PreviewBench : public MxnSensorCvAlgorithm {
+public:
+  void convertHsv(const ImageBuffer& _inImage) {
+    startFrame();
+    convertImageYuyvToHsv(_inImage);
+  }
+
+  // MxN proceedImageHsv before the IMGlib background
+  void renderPerPixel(const ImageBuffer& _outImage) const {
+    const uint64_t* restrict rgb888hsvptr = s_rgb888hsv;
+    const uint32_t width = m_inImageDesc.m_width;
+    const uint32_t height = m_inImageDesc.m_height;
+    const uint32_t dstLineLength = m_outImageDesc.m_lineLength;
+
+    const uint32_t* restrict p_hi2ho = s_hi2ho;
+    for (uint32_t srcRow = 0; srcRow < height; ++srcRow) {
+      const uint32_t dstRow = *(p_hi2ho++);
+      uint16_t* restrict dstImageRow = reinterpret_cast<uint16_t*>(_outImage.m_ptr + dstRow * dstLineLength);
+
+      const uint32_t* restrict p_wi2wo = s_wi2wo;
+      for (uint32_t srcCol = 0; srcCol < width; ++srcCol) {
+        const uint32_t dstCol = *(p_wi2wo++);
+        const uint64_t rgb888hsv = *rgb888hsvptr++;
+        writeOutputPixel(dstImageRow + dstCol, _hill(rgb888hsv));
+      }
+    }
+  }
+
+  void renderImglib(const ImageBuffer& _inImage, const ImageBuffer& _outImage, trik_cv_algorithm_out_cycles& _cycles) {
+    startFrame();
+    renderPreviewBackground(_inImage, _outImage, _cycles);
+  }
+};
+
+static PreviewBench s_bench_t;
+static uint8_t s_reference_t[IMG_WIDTH * IMG_HEIGHT * 2];
+
+// the texture as luma and, shifted by half a frame, as both chroma planes, so every pixel pair gets its own color
+static void drawColorFrame() {
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 0; col < IMG_WIDTH; ++col)
+      setPixel(row, col, 16 + s_texture_t[row][col], 28 + s_texture_t[row + IMG_HEIGHT / 2][col & ~1],
+        28 + s_texture_t[row][(col & ~1) + IMG_WIDTH / 2]);
+}
+
+// largest difference of a color channel over the output rows, in RGB565 units
+static int maxChannelDifference(const ImageDesc& _outDesc) {
+  int worst = 0;
+  for (uint32_t row = 0; row < _outDesc.m_height; ++row) {
+    const uint16_t* a = reinterpret_cast<const uint16_t*>(s_reference_t + row * _outDesc.m_lineLength);
+    const uint16_t* b = reinterpret_cast<const uint16_t*>(s_output_t + row * _outDesc.m_lineLength);
+    for (uint32_t col = 0; col < _outDesc.m_width; ++col) {
+      const int diffs[3] = { abs((a[col] >> 11) - (b[col] >> 11)), abs(((a[col] >> 5) & 0x3f) - ((b[col] >> 5) & 0x3f)),
+        abs((a[col] & 0x1f) - (b[col] & 0x1f)) };
+      for (int channel = 0; channel < 3; ++channel)
+        worst = diffs[channel] > worst ? diffs[channel] : worst;
+    }
+  }
+  return worst;
+}
+
+int main() {
+  makeTexture();
+  drawColorFrame();
+  ImageBuffer in = { reinterpret_cast<int8_t*>(s_frame_t), sizeof(s_frame_t) };
+  ImageBuffer out = { reinterpret_cast<int8_t*>(s_output_t), sizeof(s_output_t) };
+  static int8_t s_fastRam[4096];
+
+  printf("%-8s %12s %10s %7s %9s\n", "preview", "per-pixel ns", "IMGlib ns", "ratio", "max diff");
+  for (uint32_t step = 1; step <= 2; ++step) {
+    const ImageDesc inDesc = { IMG_WIDTH, IMG_HEIGHT, IMG_WIDTH * 2, VideoFormat::YUV422 };
+    const ImageDesc outDesc = { static_cast<uint16_t>(IMG_WIDTH / step), static_cast<uint16_t>(IMG_HEIGHT / step), IMG_WIDTH * 2,
+      VideoFormat::RGB565X };
+    if (!s_bench_t.setup(inDesc, outDesc, s_fastRam, sizeof(s_fastRam))) {
+      printf("setup failed for a %ux%u preview\n", outDesc.m_width, outDesc.m_height);
+      return 1;
+    }
+
+    s_bench_t.convertHsv(in);
+    uint32_t perPixel = ~0u;
+    for (int repeat = 0; repeat < BENCH_REPEATS; ++repeat) {
+      const uint32_t startTime = Timestamp_get32();
+      s_bench_t.renderPerPixel(out);
+      const uint32_t time = Timestamp_get32() - startTime;
+      perPixel = time < perPixel ? time : perPixel;
+    }
+    memcpy(s_reference_t, s_output_t, sizeof(s_reference_t));
+
+    uint32_t imglib = ~0u;
+    for (int repeat = 0; repeat < BENCH_REPEATS; ++repeat) {
+      trik_cv_algorithm_out_cycles cycles;
+      memset(&cycles, 0, sizeof(cycles));
+      s_bench_t.renderImglib(in, out, cycles);
+      imglib = cycles.preview < imglib ? cycles.preview : imglib;
+    }
+
+    printf("%3ux%-4u %12u %10u %7.2f %9d\n", outDesc.m_width, outDesc.m_height, perPixel, imglib, static_cast<double>(perPixel) / imglib,
+      maxChannelDifference(outDesc));
+  }
+  return 0;
+}
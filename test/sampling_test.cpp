@@ -0,0 +1,85 @@
+/*
+ * Row stride and checkerboard sampling of the line sensor and the color target pass of the motion sensor. A known
+ * target is rendered and every phase of strides 1, 2 and 4 is run, with and without the checkerboard; the centroid
+ * and size reported on every frame are compared with the full scan of the same frame.
+ *
+ * Sampling every k-th row moves the centroid of a target by at most the difference between the mean of its sampled
+ * rows and the mean of all of them, under k/2 rows. For the band below, slanted by one column every three rows, that
+ * is under a pixel horizontally, and the checkerboard adds up to two columns more; a percent of the frame width is
+ * 1.6 pixels, so centroids must stay within SAMPLE_CENTROID_BOUND percent. Sizes are estimated from the sampled
+ * pixel count scaled to all rows, which is off by up to a sampled row of the target out of the rows it spans, and by
+ * up to a pixel pair of every row for the checkerboard. That is a few percent of the target, under one step of the
+ * reported size, so sizes must stay within SAMPLE_SIZE_BOUND of the full scan.
+ */
+#include "pipeline.h"
+
+#include <stdlib.h>
+
+#define SAMPLE_CENTROID_BOUND 2 // percent of the frame, see above
+#define SAMPLE_SIZE_BOUND 1     // reported size units, see above
+
+static void drawBand() {
+  fillFrame(128);
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 150 + (row - 120) / 3; col < 185 + (row - 120) / 3; ++col)
+      setPixel(row, col, 41, 240, 110);
+}
+
+static void drawDisc() {
+  fillFrame(128);
+  for (int row = 0; row < IMG_HEIGHT; ++row)
+    for (int col = 0; col < IMG_WIDTH; ++col)
+      if ((col - 200) * (col - 200) + (row - 90) * (row - 90) < 900)
+        setPixel(row, col, 41, 240, 110);
+}
+
+static void checkSampling(const trik_cv_algorithm _algorithm, const char* _name, void (*_draw)()) {
+  trik_cv_algorithm_in_args in;
+  clearInArgs(in);
+  detectBlue(in);
+  in.preview = TRIK_PREVIEW_NONE;
+  _draw();
+
+  trik_init_cv_algorithm(TRIK_CV_ALGORITHM_BIT(_algorithm), false, 0);
+  trik_cv_algorithm_out_args full;
+  runSensor(_algorithm, in, full);
+  const int fullX = static_cast<int16_t>(full.targets[0].x);
+  const int fullY = static_cast<int16_t>(full.targets[0].y);
+  const int fullSize = full.targets[0].size;
+  CHECK(fullSize > 0, "%s: no target at full scan", _name);
+
+  static const int s_strides[] = { 1, 2, 4 };
+  for (int checkerboard = 0; checkerboard < 2; ++checkerboard)
+    for (uint32_t s = 0; s < sizeof(s_strides) / sizeof(s_strides[0]); ++s) {
+      const int stride = s_strides[s];
+      in.sample_stride = stride;
+      in.sample_checkerboard = checkerboard;
+      trik_init_cv_algorithm(TRIK_CV_ALGORITHM_BIT(_algorithm), false, 0);
+      int maxX = 0;
+      int maxY = 0;
+      int maxSize = 0;
+      // the row phase rotates every frame and the checkerboard alternates, 2 * stride frames run every combination
+      for (int phase = 0; phase < 2 * stride; ++phase) {
+        trik_cv_algorithm_out_args out;
+        runSensor(_algorithm, in, out);
+        const int dx = abs(static_cast<int16_t>(out.targets[0].x) - fullX);
+        const int dy = abs(static_cast<int16_t>(out.targets[0].y) - fullY);
+        const int dSize = abs(out.targets[0].size - fullSize);
+        CHECK(dx <= SAMPLE_CENTROID_BOUND && dy <= SAMPLE_CENTROID_BOUND, "%s stride %d checkerboard %d phase %d: centroid %d,%d, full scan %d,%d", _name, stride,
+          checkerboard, phase, static_cast<int16_t>(out.targets[0].x), static_cast<int16_t>(out.targets[0].y), fullX, fullY);
+        CHECK(dSize <= SAMPLE_SIZE_BOUND, "%s stride %d checkerboard %d phase %d: size %d, full scan %d", _name, stride, checkerboard, phase, out.targets[0].size,
+          fullSize);
+        maxX = dx > maxX ? dx : maxX;
+        maxY = dy > maxY ? dy : maxY;
+        maxSize = dSize > maxSize ? dSize : maxSize;
+      }
+      printf("%-8s stride %d checkerboard %d: centroid off by up to %d,%d percent, size by up to %d of %d\n", _name, stride, checkerboard, maxX, maxY, maxSize,
+        fullSize);
+    }
+}
+
+int main() {
+  checkSampling(TRIK_CV_ALGORITHM_LINE_SENSOR, "line", drawBand);
+  checkSampling(TRIK_CV_ALGORITHM_MOTION_SENSOR, "motion", drawDisc);
+  return testResult();
+}
@@ -0,0 +1,237 @@
+/*
+ * Sensor scheduling of dsp_server.c, driven through its message loop. The server is built for the host with the IPC
+ * and sensor entry points stubbed here: trik_run_cv_algorithm records what it is asked to run and reports a fixed
+ * cost per sensor, frames are static or changed as the test says. Every message goes through one call of
+ * trik_start_dsp_server, which returns once the queue is empty.
+ */
+#include <trik/buffer.h>
+
+#include <ti/ipc/MessageQ.h>
+
+#include <trik/sensors/cv_algorithms.h>
+#include <trik/sensors/dsp_server.h>
+#include <trik/sensors/msg.h>
+
+#include "frames.h"
+
+extern "C" struct trik_cv_algorithm_results results;
+
+#define LINE TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_LINE_SENSOR)
+#define OBJECT TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_OBJECT_SENSOR)
+#define MXN TRIK_CV_ALGORITHM_BIT(TRIK_CV_ALGORITHM_MXN_SENSOR)
+
+static union {
+  trik_msg header;
+  trik_req_cv_algorithm_msg request;
+  trik_res_step_msg step;
+} s_message_t;
+static trik_msg* s_queued_t = NULL;
+static uint32_t s_replies_t = 0;
+
+static uint32_t s_costs_t[TRIK_CV_ALGORITHM_COUNT];
+static bool s_changed_t = true;
+static uint32_t s_ran_t = 0;        // sensors run on the last frame
+static uint32_t s_autoDetect_t = 0; // sensors asked to detect their HSV range on it
+
+extern "C" int MessageQ_get(MessageQ_Handle, MessageQ_Msg* _msg, uint32_t) {
+  if (s_queued_t == NULL)
+    return -1;
+  *_msg = reinterpret_cast<MessageQ_Msg>(s_queued_t);
+  s_queued_t = NULL;
+  return 0;
+}
+
+extern "C" int MessageQ_put(MessageQ_QueueId, MessageQ_Msg) {
+  ++s_replies_t;
+  return 0;
+}
+
+extern "C" int trik_init_cv_algorithm(uint32_t, bool, uint8_t) {
+  return 1;
+}
+
+extern "C" int trik_run_cv_algorithm(uint32_t _cvAlgorithms, uint32_t _autoDetectHsv, struct buffer, struct buffer, struct trik_cv_algorithm_draw_list*,
+  struct trik_cv_algorithm_in_args, struct trik_cv_algorithm_results* _results) {
+  s_ran_t = _cvAlgorithms;
+  s_autoDetect_t = _autoDetectHsv;
+  for (uint32_t i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i)
+    if (_cvAlgorithms & TRIK_CV_ALGORITHM_BIT(i))
+      _results->out_args[i].cycles.sensor = s_costs_t[i];
+  _results->cv_algorithms = _cvAlgorithms;
+  return 1;
+}
+
+extern "C" bool trik_detect_frame_change(struct buffer, uint32_t) {
+  return s_changed_t;
+}
+
+extern "C" void trik_reset_frame_change_detector(void) {}
+
+static bool send(const trik_cmd _cmd) {
+  s_message_t.header.cmd = _cmd;
+  s_queued_t = &s_message_t.header;
+  const uint32_t replies = s_replies_t;
+  trik_start_dsp_server();
+  return s_replies_t == replies + 1;
+}
+
+static void startSet(const uint32_t _set, const trik_cv_algorithm_schedule& _schedule, const uint8_t _staticThreshold = 0) {
+  memset(&s_message_t, 0, sizeof(s_message_t));
+  s_message_t.request.cv_algorithms = _set;
+  s_message_t.request.in_args.auto_detect_hsv = true;
+  s_message_t.request.in_args.static_threshold = _staticThreshold;
+  s_message_t.request.schedule = _schedule;
+  CHECK(send(TRIK_CMD_SENSOR_SET), "set %02x not started", _set);
+}
+
+static void step(const int _frame, const bool _changed = true) {
+  s_ran_t = 0;
+  s_autoDetect_t = 0;
+  s_changed_t = _changed;
+  CHECK(send(TRIK_CMD_STEP), "frame %d: no reply", _frame);
+}
+
+static bool reused(const trik_cv_algorithm _algorithm) {
+  return results.out_args[_algorithm].reused;
+}
+
+static const trik_cv_algorithm_out_schedule& stats(const trik_cv_algorithm _algorithm) {
+  return results.schedule[_algorithm];
+}
+
+static trik_cv_algorithm_schedule emptySchedule() {
+  trik_cv_algorithm_schedule schedule;
+  memset(&schedule, 0, sizeof(schedule));
+  return schedule;
+}
+
+// without periods and budget every sensor runs on every frame and detects its HSV range on each of them
+static void checkDefaultSchedule() {
+  startSet(LINE | OBJECT | MXN, emptySchedule());
+  for (int frame = 0; frame < 10; ++frame) {
+    step(frame);
+    CHECK(s_ran_t == (LINE | OBJECT | MXN), "default frame %d: ran %02x", frame, s_ran_t);
+    CHECK(s_autoDetect_t == (LINE | OBJECT), "default frame %d: auto detection for %02x", frame, s_autoDetect_t);
+    CHECK(!reused(TRIK_CV_ALGORITHM_LINE_SENSOR) && !reused(TRIK_CV_ALGORITHM_MXN_SENSOR), "default frame %d: results reused", frame);
+  }
+  for (int i = TRIK_CV_ALGORITHM_LINE_SENSOR; i <= TRIK_CV_ALGORITHM_MXN_SENSOR; ++i) {
+    const trik_cv_algorithm_out_schedule& sensor = stats(static_cast<trik_cv_algorithm>(i));
+    CHECK(sensor.runs == 10 && sensor.deferred == 0 && sensor.misses == 0, "default sensor %d: %u runs %u deferred %u misses", i, sensor.runs,
+      sensor.deferred, sensor.misses);
+  }
+}
+
+/*
+ * Line every frame, object every 5th and mxn every 10th, 100, 200 and 300 ticks into 400 per frame. Mxn does not fit
+ * next to line and object on the frames they share and runs on the next one, inside its period.
+ */
+static void checkDeferral() {
+  trik_cv_algorithm_schedule schedule = emptySchedule();
+  schedule.frame_budget = 400;
+  schedule.period[TRIK_CV_ALGORITHM_OBJECT_SENSOR] = 5;
+  schedule.period[TRIK_CV_ALGORITHM_MXN_SENSOR] = 10;
+  startSet(LINE | OBJECT | MXN, schedule);
+  static const int s_frames = 60;
+  for (int frame = 0; frame < s_frames; ++frame) {
+    step(frame);
+    uint32_t cost = 0;
+    uint32_t sensors = 0;
+    for (uint32_t i = 0; i < TRIK_CV_ALGORITHM_COUNT; ++i)
+      if (s_ran_t & TRIK_CV_ALGORITHM_BIT(i)) {
+        cost += s_costs_t[i];
+        ++sensors;
+      }
+    // costs are unknown before the first runs, later frames keep to the budget unless a single sensor exceeds it
+    CHECK(frame == 0 || sensors == 1 || cost <= schedule.frame_budget, "deferral frame %d: ran %02x for %u ticks", frame, s_ran_t, cost);
+    if (frame % 10 == 0 && frame > 0)
+      CHECK(s_ran_t == (LINE | OBJECT), "deferral frame %d: ran %02x instead of line and object", frame, s_ran_t);
+    if (frame % 10 == 1 && frame > 1)
+      CHECK(s_ran_t == (LINE | MXN), "deferral frame %d: ran %02x instead of line and mxn", frame, s_ran_t);
+  }
+  CHECK(stats(TRIK_CV_ALGORITHM_LINE_SENSOR).runs == s_frames, "deferral: line ran %u times", stats(TRIK_CV_ALGORITHM_LINE_SENSOR).runs);
+  CHECK(stats(TRIK_CV_ALGORITHM_OBJECT_SENSOR).runs == s_frames / 5, "deferral: object ran %u times", stats(TRIK_CV_ALGORITHM_OBJECT_SENSOR).runs);
+  CHECK(stats(TRIK_CV_ALGORITHM_MXN_SENSOR).runs == s_frames / 10, "deferral: mxn ran %u times", stats(TRIK_CV_ALGORITHM_MXN_SENSOR).runs);
+  CHECK(stats(TRIK_CV_ALGORITHM_MXN_SENSOR).deferred == s_frames / 10 - 1, "deferral: mxn deferred %u times", stats(TRIK_CV_ALGORITHM_MXN_SENSOR).deferred);
+  for (int i = TRIK_CV_ALGORITHM_LINE_SENSOR; i <= TRIK_CV_ALGORITHM_MXN_SENSOR; ++i)
+    CHECK(stats(static_cast<trik_cv_algorithm>(i)).misses == 0, "deferral sensor %d: %u misses", i, stats(static_cast<trik_cv_algorithm>(i)).misses);
+}
+
+// object every 5th frame never fits next to line into 250 ticks after its first run, every period it waits through is missed
+static void checkMisses() {
+  trik_cv_algorithm_schedule schedule = emptySchedule();
+  schedule.frame_budget = 250;
+  schedule.period[TRIK_CV_ALGORITHM_OBJECT_SENSOR] = 5;
+  startSet(LINE | OBJECT, schedule);
+  for (int frame = 0; frame < 40; ++frame)
+    step(frame);
+  const trik_cv_algorithm_out_schedule& object = stats(TRIK_CV_ALGORITHM_OBJECT_SENSOR);
+  // periods starting on frames 5 to 30 end before frame 40, the one starting on 35 is still open
+  CHECK(object.runs == 1 && object.misses == 6 && object.deferred == 35, "misses: object %u runs %u deferred %u misses", object.runs, object.deferred,
+    object.misses);
+  CHECK(stats(TRIK_CV_ALGORITHM_LINE_SENSOR).misses == 0, "misses: line missed %u deadlines", stats(TRIK_CV_ALGORITHM_LINE_SENSOR).misses);
+}
+
+/*
+ * A gated line and object set into 250 ticks: after a change only line fits, object then runs on the next static
+ * frame instead of reporting the results of the previous scene as reused, and line is reused on it.
+ */
+static void checkStaticReuse() {
+  trik_cv_algorithm_schedule schedule = emptySchedule();
+  schedule.frame_budget = 250;
+  startSet(LINE | OBJECT, schedule, 10);
+  step(0);
+  CHECK(s_ran_t == (LINE | OBJECT), "static frame 0: ran %02x", s_ran_t);
+  for (int frame = 1; frame < 4; ++frame) {
+    step(frame, false);
+    CHECK(s_ran_t == 0 && results.cv_algorithms == 0, "static frame %d: ran %02x", frame, s_ran_t);
+    CHECK(reused(TRIK_CV_ALGORITHM_LINE_SENSOR) && reused(TRIK_CV_ALGORITHM_OBJECT_SENSOR), "static frame %d: results not reused", frame);
+  }
+
+  step(4);
+  CHECK(s_ran_t == LINE, "changed frame 4: ran %02x", s_ran_t);
+  CHECK(!reused(TRIK_CV_ALGORITHM_OBJECT_SENSOR), "changed frame 4: object results of the previous scene reported as reused");
+  step(5, false);
+  CHECK(s_ran_t == OBJECT, "static frame 5: ran %02x instead of the deferred object sensor", s_ran_t);
+  CHECK(reused(TRIK_CV_ALGORITHM_LINE_SENSOR) && !reused(TRIK_CV_ALGORITHM_OBJECT_SENSOR), "static frame 5: line reused %d, object reused %d",
+    reused(TRIK_CV_ALGORITHM_LINE_SENSOR), reused(TRIK_CV_ALGORITHM_OBJECT_SENSOR));
+  step(6, false);
+  CHECK(s_ran_t == 0 && reused(TRIK_CV_ALGORITHM_LINE_SENSOR) && reused(TRIK_CV_ALGORITHM_OBJECT_SENSOR), "static frame 6: ran %02x", s_ran_t);
+  CHECK(stats(TRIK_CV_ALGORITHM_LINE_SENSOR).runs == 2 && stats(TRIK_CV_ALGORITHM_OBJECT_SENSOR).runs == 2, "static: line %u runs, object %u runs",
+    stats(TRIK_CV_ALGORITHM_LINE_SENSOR).runs, stats(TRIK_CV_ALGORITHM_OBJECT_SENSOR).runs);
+
+  // mxn is not gated, a sensor left out of a frame repeats results of an earlier scene and is not reported as reused
+  schedule.period[TRIK_CV_ALGORITHM_MXN_SENSOR] = 4;
+  startSet(MXN, schedule, 10);
+  for (int frame = 0; frame < 8; ++frame) {
+    step(frame, false);
+    CHECK(s_ran_t == (frame % 4 == 0 ? MXN : 0u), "ungated frame %d: ran %02x", frame, s_ran_t);
+    CHECK(!reused(TRIK_CV_ALGORITHM_MXN_SENSOR), "ungated frame %d: reported as reused", frame);
+  }
+}
+
+// line every frame and object every 7th, HSV ranges every 30 frames: each sensor detects on its first run after a release
+static void checkHsvDetection() {
+  trik_cv_algorithm_schedule schedule = emptySchedule();
+  schedule.period[TRIK_CV_ALGORITHM_OBJECT_SENSOR] = 7;
+  schedule.auto_detect_hsv_period = 30;
+  startSet(LINE | OBJECT, schedule);
+  for (int frame = 0; frame < 60; ++frame) {
+    step(frame);
+    const uint32_t expected = (frame % 30 == 0 ? LINE : 0) | (frame == 0 || frame == 35 ? OBJECT : 0);
+    CHECK(s_autoDetect_t == expected, "hsv frame %d: auto detection for %02x instead of %02x", frame, s_autoDetect_t, expected);
+  }
+}
+
+int main() {
+  s_costs_t[TRIK_CV_ALGORITHM_LINE_SENSOR] = 100;
+  s_costs_t[TRIK_CV_ALGORITHM_OBJECT_SENSOR] = 200;
+  s_costs_t[TRIK_CV_ALGORITHM_MXN_SENSOR] = 300;
+  CHECK(trik_init_dsp_server() == 0, "server not initialized");
+
+  checkDefaultSchedule();
+  checkDeferral();
+  checkMisses();
+  checkStaticReuse();
+  checkHsvDetection();
+  return testResult();
+}